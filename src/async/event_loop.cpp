@@ -0,0 +1,321 @@
+#include "event_loop.h"
+#include "../logging/logger.h"
+#include "../util/tsc_clock.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#else
+#include <sys/event.h>
+#include <sys/time.h>
+#endif
+
+EventLoopPool eventLoops;
+
+namespace {
+
+constexpr int MAX_EVENTS = 256;
+constexpr int STOP_POLL_MS = 10;    ///< Wait granularity while draining for stop()
+
+#ifdef __linux__
+/**
+ * @brief True if fd has a pending socket error (or is not a socket)
+ */
+bool socketFailed(int fd) {
+    int error = 0;
+    socklen_t len = sizeof(error);
+    return getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len) != 0 || error != 0;
+}
+#endif
+
+#ifndef __linux__
+constexpr uintptr_t WAKE_IDENT = 0;  ///< EVFILT_USER identifier used by wake()
+#endif
+
+} // namespace
+
+/**
+ * @brief Fire-and-forget coroutine that owns a spawned Task until it completes
+ */
+struct EventLoop::DetachedTask {
+    struct promise_type {
+        DetachedTask get_return_object() noexcept {
+            return {std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept {}
+    };
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+EventLoop::DetachedTask EventLoop::runDetached(EventLoop* loop, Task<void> task) {
+    try {
+        co_await task;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Event loop task failed: {}", e.what());
+    } catch (...) {
+        LOG_ERROR("Event loop task failed");
+    }
+    loop->liveTasks_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+EventLoop::EventLoop() : timers_(TIMER_TICK_NS, static_cast<int64_t>(steadyClockNs())) {}
+
+EventLoop::~EventLoop() {
+    stop(0);
+}
+
+bool EventLoop::start() {
+    if (thread_.joinable()) {
+        return true;
+    }
+    #ifdef __linux__
+    pollFd_ = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (pollFd_ < 0 || wakeFd_ < 0) {
+        LOG_ERROR("Event loop setup failed: {}", strerror(errno));
+        stop(0);
+        return false;
+    }
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.ptr = nullptr;  // Wake marker
+    epoll_ctl(pollFd_, EPOLL_CTL_ADD, wakeFd_, &ev);
+    #else
+    pollFd_ = kqueue();
+    if (pollFd_ < 0) {
+        LOG_ERROR("Event loop setup failed: {}", strerror(errno));
+        return false;
+    }
+    struct kevent ev;
+    EV_SET(&ev, WAKE_IDENT, EVFILT_USER, EV_ADD | EV_CLEAR, 0, 0, nullptr);
+    kevent(pollFd_, &ev, 1, nullptr, 0, nullptr);
+    #endif
+    stopping_ = false;
+    thread_ = std::thread(&EventLoop::run, this);
+    return true;
+}
+
+void EventLoop::stop(int64_t drainNs) {
+    if (thread_.joinable()) {
+        stopDeadlineNs_.store(static_cast<int64_t>(steadyClockNs()) + drainNs);
+        stopping_ = true;
+        wake();
+        thread_.join();
+        if (liveTasks_ > 0) {
+            LOG_WARN("Event loop stopped with {} tasks still suspended", liveTasks_.load());
+        }
+    }
+    if (wakeFd_ >= 0) {
+        close(wakeFd_);
+        wakeFd_ = -1;
+    }
+    if (pollFd_ >= 0) {
+        close(pollFd_);
+        pollFd_ = -1;
+    }
+}
+
+void EventLoop::spawn(Task<void> task) {
+    if (!task.valid()) {
+        return;
+    }
+    liveTasks_.fetch_add(1, std::memory_order_relaxed);
+    post(runDetached(this, std::move(task)).handle);
+}
+
+void EventLoop::post(std::coroutine_handle<> handle) {
+    {
+        std::lock_guard<std::mutex> lock(postMutex_);
+        posted_.push_back(handle);
+    }
+    wake();
+}
+
+void EventLoop::wake() {
+    #ifdef __linux__
+    if (wakeFd_ >= 0) {
+        const uint64_t one = 1;
+        [[maybe_unused]] ssize_t n = write(wakeFd_, &one, sizeof(one));
+    }
+    #else
+    if (pollFd_ >= 0) {
+        struct kevent ev;
+        EV_SET(&ev, WAKE_IDENT, EVFILT_USER, 0, NOTE_TRIGGER, 0, nullptr);
+        kevent(pollFd_, &ev, 1, nullptr, 0, nullptr);
+    }
+    #endif
+}
+
+void EventLoop::runPosted() {
+    {
+        std::lock_guard<std::mutex> lock(postMutex_);
+        running_.swap(posted_);
+    }
+    for (auto handle : running_) {
+        handle.resume();
+    }
+    running_.clear();
+}
+
+int EventLoop::waitTimeoutMs() {
+    const int cap = stopping_ ? STOP_POLL_MS : -1;
+    const int64_t remainingNs = timers_.nextTimeoutNs(static_cast<int64_t>(steadyClockNs()));
+    if (remainingNs < 0) {
+        return cap;
+    }
+    const int64_t ms = (remainingNs + 999999) / 1000000;
+    return cap >= 0 && ms > cap ? cap : static_cast<int>(ms);
+}
+
+bool EventLoop::arm(IoAwaitable* io) {
+    #ifdef __linux__
+    epoll_event ev{};
+    ev.events = (io->write ? EPOLLOUT : (EPOLLIN | EPOLLRDHUP)) | EPOLLONESHOT;
+    ev.data.ptr = io;
+    if (epoll_ctl(pollFd_, EPOLL_CTL_MOD, io->fd, &ev) == 0) {
+        return true;
+    }
+    return errno == ENOENT && epoll_ctl(pollFd_, EPOLL_CTL_ADD, io->fd, &ev) == 0;
+    #else
+    struct kevent ev;
+    EV_SET(&ev, io->fd, io->write ? EVFILT_WRITE : EVFILT_READ, EV_ADD | EV_ONESHOT, 0, 0, io);
+    return kevent(pollFd_, &ev, 1, nullptr, 0, nullptr) == 0;
+    #endif
+}
+
+void EventLoop::disarm(IoAwaitable* io) {
+    // Removing the registration guarantees no later event refers to io
+    #ifdef __linux__
+    epoll_ctl(pollFd_, EPOLL_CTL_DEL, io->fd, nullptr);
+    #else
+    struct kevent ev;
+    EV_SET(&ev, io->fd, io->write ? EVFILT_WRITE : EVFILT_READ, EV_DELETE, 0, 0, nullptr);
+    kevent(pollFd_, &ev, 1, nullptr, 0, nullptr);
+    #endif
+}
+
+void EventLoop::run() {
+    #ifdef __linux__
+    epoll_event events[MAX_EVENTS];
+    #else
+    struct kevent events[MAX_EVENTS];
+    #endif
+
+    while (true) {
+        if (stopping_ && (liveTasks_ == 0 ||
+                          static_cast<int64_t>(steadyClockNs()) >= stopDeadlineNs_.load())) {
+            break;
+        }
+
+        const int timeoutMs = waitTimeoutMs();
+        #ifdef __linux__
+        const int count = epoll_wait(pollFd_, events, MAX_EVENTS, timeoutMs);
+        #else
+        timespec timeout{timeoutMs / 1000, (timeoutMs % 1000) * 1000000L};
+        const int count = kevent(pollFd_, nullptr, 0, events, MAX_EVENTS, timeoutMs < 0 ? nullptr : &timeout);
+        #endif
+        if (count < 0 && errno != EINTR) {
+            LOG_ERROR("Event loop wait failed: {}", strerror(errno));
+            break;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            #ifdef __linux__
+            auto* io = static_cast<IoAwaitable*>(events[i].data.ptr);
+            if (!io) {
+                uint64_t value;
+                [[maybe_unused]] ssize_t n = read(wakeFd_, &value, sizeof(value));
+                continue;
+            }
+            // A socket with TX timestamps or zerocopy raises EPOLLERR while completions
+            // sit on its error queue; only a pending SO_ERROR is a real failure
+            const bool failed = (events[i].events & EPOLLERR) &&
+                                !(events[i].events & (EPOLLIN | EPOLLOUT | EPOLLRDHUP)) &&
+                                socketFailed(io->fd);
+            #else
+            auto* io = static_cast<IoAwaitable*>(events[i].udata);
+            if (events[i].filter == EVFILT_USER || !io) {
+                continue;
+            }
+            const bool failed = (events[i].flags & EV_ERROR) != 0;
+            #endif
+            io->timer.cancel();
+            io->status = failed ? IoStatus::Error : IoStatus::Ready;
+            io->handle.resume();
+        }
+
+        runPosted();
+        timers_.advance(static_cast<int64_t>(steadyClockNs()));
+    }
+}
+
+bool EventLoop::IoAwaitable::await_suspend(std::coroutine_handle<> awaiting) {
+    handle = awaiting;
+    if (!loop->arm(this)) {
+        status = IoStatus::Error;
+        return false;
+    }
+    if (timeoutNs >= 0) {
+        loop->timers_.schedule(timer, static_cast<int64_t>(steadyClockNs()) + timeoutNs);
+    }
+    return true;
+}
+
+void EventLoop::IoAwaitable::timedOut(void* context) {
+    auto* io = static_cast<IoAwaitable*>(context);
+    io->loop->disarm(io);
+    io->status = IoStatus::Timeout;
+    io->handle.resume();
+}
+
+void EventLoop::SleepAwaitable::await_suspend(std::coroutine_handle<> awaiting) {
+    handle = awaiting;
+    loop->timers_.schedule(timer, static_cast<int64_t>(steadyClockNs()) + delayNs);
+}
+
+void EventLoop::SleepAwaitable::elapsed(void* context) {
+    static_cast<SleepAwaitable*>(context)->handle.resume();
+}
+
+bool EventLoopPool::start(size_t threads) {
+    if (!loops_.empty()) {
+        return true;
+    }
+    for (size_t i = 0; i < std::max<size_t>(threads, 1); ++i) {
+        auto loop = std::make_unique<EventLoop>();
+        if (!loop->start()) {
+            stop(0);
+            return false;
+        }
+        loops_.push_back(std::move(loop));
+    }
+    return true;
+}
+
+void EventLoopPool::stop(int64_t drainNs) {
+    for (auto& loop : loops_) {
+        loop->stop(drainNs);
+    }
+    loops_.clear();
+}
+
+EventLoop& EventLoopPool::next() {
+    return *loops_[next_.fetch_add(1, std::memory_order_relaxed) % loops_.size()];
+}
+
+size_t EventLoopPool::liveTasks() const {
+    size_t total = 0;
+    for (const auto& loop : loops_) {
+        total += loop->liveTasks();
+    }
+    return total;
+}
@@ -0,0 +1,202 @@
+#pragma once
+
+/**
+ * @file event_loop.h
+ * @brief Single-threaded readiness event loop driving coroutine tasks
+ *
+ * Each EventLoop owns one thread blocked in epoll_wait() (kqueue on BSD/macOS).
+ * Coroutines spawned on a loop run only on that thread and suspend on
+ * awaitables instead of polling:
+ *
+ * @code
+ * Task<void> session(EventLoop& loop, int fd) {
+ *     while (...) {
+ *         if (co_await loop.readable(fd, 50'000'000) == IoStatus::Timeout) {
+ *             continue;  // Re-check shutdown flags
+ *         }
+ *         // Non-blocking reads until EAGAIN
+ *     }
+ * }
+ * EventLoop& loop = eventLoops.next();
+ * loop.spawn(session(loop, fd));
+ * @endcode
+ *
+ * Registrations are one-shot and each fd has at most one waiter at a time
+ * (the coroutine that owns it). Timeouts and sleeps live on a TimerWheel with
+ * 1ms ticks; their nodes are part of the awaitable, so arming one allocates
+ * nothing.
+ */
+
+#include "task.h"
+#include "timer_wheel.h"
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Result of waiting for a descriptor
+ */
+enum class IoStatus {
+    Ready,      ///< Readable/writable (or hung up: the next read reports EOF)
+    Timeout,    ///< Deadline passed first
+    Error       ///< Registration failed or the descriptor reported an error
+};
+
+/**
+ * @class EventLoop
+ * @brief Event loop thread with awaitable readiness and timer operations
+ *
+ * Thread safety: start/stop/spawn/post may be called from any thread; the
+ * awaitables must be awaited by coroutines running on this loop.
+ */
+class EventLoop {
+public:
+    static constexpr int64_t TIMER_TICK_NS = 1000000;
+
+    EventLoop();
+    ~EventLoop();
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    /**
+     * @brief Creates the poller and starts the loop thread
+     */
+    bool start();
+
+    /**
+     * @brief Lets running tasks finish for up to drainNs, then stops the thread
+     *
+     * Tasks still suspended afterwards are abandoned (their frames leak).
+     */
+    void stop(int64_t drainNs = 1000000000);
+
+    /**
+     * @brief Starts task on the loop thread; the loop owns it until it completes
+     */
+    void spawn(Task<void> task);
+
+    /**
+     * @brief Resumes handle on the loop thread
+     */
+    void post(std::coroutine_handle<> handle);
+
+    /**
+     * @brief Spawned tasks that have not completed yet
+     */
+    size_t liveTasks() const { return liveTasks_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Awaitable readiness of fd for reading or writing, with optional timeout
+     */
+    struct IoAwaitable {
+        EventLoop* loop;
+        int fd;
+        bool write;
+        int64_t timeoutNs;              ///< < 0 waits indefinitely
+        std::coroutine_handle<> handle;
+        IoStatus status = IoStatus::Ready;
+        TimerNode timer{&IoAwaitable::timedOut, this};
+
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> awaiting);
+        IoStatus await_resume() const noexcept { return status; }
+
+        static void timedOut(void* context);
+    };
+
+    /**
+     * @brief Awaitable that resumes after a delay
+     */
+    struct SleepAwaitable {
+        EventLoop* loop;
+        int64_t delayNs;
+        std::coroutine_handle<> handle;
+        TimerNode timer{&SleepAwaitable::elapsed, this};
+
+        bool await_ready() const noexcept { return delayNs <= 0; }
+        void await_suspend(std::coroutine_handle<> awaiting);
+        void await_resume() const noexcept {}
+
+        static void elapsed(void* context);
+    };
+
+    IoAwaitable readable(int fd, int64_t timeoutNs = -1) { return {this, fd, false, timeoutNs, {}}; }
+    IoAwaitable writable(int fd, int64_t timeoutNs = -1) { return {this, fd, true, timeoutNs, {}}; }
+    SleepAwaitable sleepFor(int64_t delayNs) { return {this, delayNs, {}}; }
+
+    /**
+     * @brief The loop's timer wheel, for timers owned by tasks on this loop
+     *
+     * Loop thread only. Deadlines are steadyClockNs() values; callbacks run
+     * on the loop thread between I/O events.
+     */
+    TimerWheel& timers() { return timers_; }
+
+private:
+    int pollFd_ = -1;                   ///< epoll or kqueue descriptor
+    int wakeFd_ = -1;                   ///< eventfd used by post() (Linux)
+    std::thread thread_;
+    std::atomic<bool> stopping_{false};
+    std::atomic<int64_t> stopDeadlineNs_{0};
+    std::atomic<size_t> liveTasks_{0};
+
+    std::mutex postMutex_;              ///< Guards posted_
+    std::vector<std::coroutine_handle<>> posted_;
+    std::vector<std::coroutine_handle<>> running_;   ///< Loop thread: posted handles being resumed
+
+    TimerWheel timers_;                 ///< Loop thread only
+
+    void run();
+    void wake();
+    void runPosted();
+    bool arm(IoAwaitable* io);
+    void disarm(IoAwaitable* io);
+    int waitTimeoutMs();
+
+    struct DetachedTask;
+    static DetachedTask runDetached(EventLoop* loop, Task<void> task);
+};
+
+/**
+ * @class EventLoopPool
+ * @brief Fixed set of event loops; sessions are spread round-robin
+ */
+class EventLoopPool {
+public:
+    /**
+     * @return false if any loop failed to start (the pool is then stopped)
+     */
+    bool start(size_t threads);
+
+    /**
+     * @brief Stops every loop, giving tasks up to drainNs to finish
+     */
+    void stop(int64_t drainNs = 1000000000);
+
+    bool running() const { return !loops_.empty(); }
+    size_t size() const { return loops_.size(); }
+
+    /**
+     * @brief Next loop in round-robin order (pool must be running)
+     */
+    EventLoop& next();
+
+    /**
+     * @brief Spawned tasks still running across all loops
+     */
+    size_t liveTasks() const;
+
+private:
+    std::vector<std::unique_ptr<EventLoop>> loops_;
+    std::atomic<size_t> next_{0};
+};
+
+/**
+ * @brief Loops used by coroutine sessions (started by main when HFT_COROUTINES is set)
+ */
+extern EventLoopPool eventLoops;
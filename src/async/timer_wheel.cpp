@@ -0,0 +1,159 @@
+#include "timer_wheel.h"
+
+namespace {
+
+constexpr uint64_t SLOT_MASK = TimerWheel::SLOTS - 1;
+constexpr uint64_t SPAN_TICKS = uint64_t{1} << (TimerWheel::SLOT_BITS * TimerWheel::LEVELS);
+
+void makeEmpty(TimerNode*& prev, TimerNode*& next, TimerNode* self) {
+    prev = self;
+    next = self;
+}
+
+} // namespace
+
+void TimerNode::cancel() {
+    if (wheel_) {
+        unlink();
+        --wheel_->size_;
+        wheel_ = nullptr;
+    }
+}
+
+void TimerNode::unlink() {
+    prev_->next_ = next_;
+    next_->prev_ = prev_;
+    prev_ = nullptr;
+    next_ = nullptr;
+}
+
+TimerWheel::TimerWheel(int64_t tickNs, int64_t nowNs)
+    : tickNs_(tickNs > 0 ? tickNs : 1), originNs_(nowNs) {
+    for (auto& level : slots_) {
+        for (auto& slot : level) {
+            makeEmpty(slot.prev_, slot.next_, &slot);
+        }
+    }
+}
+
+TimerWheel::~TimerWheel() {
+    // Detach remaining nodes so their destructors do not touch the wheel
+    for (auto& level : slots_) {
+        for (auto& slot : level) {
+            while (slot.next_ != &slot) {
+                TimerNode* node = slot.next_;
+                node->unlink();
+                node->wheel_ = nullptr;
+            }
+        }
+    }
+}
+
+uint64_t TimerWheel::tickAt(int64_t nowNs) const {
+    return nowNs > originNs_ ? static_cast<uint64_t>((nowNs - originNs_) / tickNs_) : 0;
+}
+
+void TimerWheel::schedule(TimerNode& node, int64_t deadlineNs) {
+    node.cancel();
+
+    // Round up so a timer never fires before its deadline
+    uint64_t tick = 0;
+    if (deadlineNs > originNs_) {
+        tick = static_cast<uint64_t>((deadlineNs - originNs_ + tickNs_ - 1) / tickNs_);
+    }
+    node.deadlineTick_ = tick > currentTick_ ? tick : currentTick_;
+    node.wheel_ = this;
+    ++size_;
+    link(node);
+}
+
+void TimerWheel::link(TimerNode& node) {
+    const uint64_t delta = node.deadlineTick_ - currentTick_;
+
+    // Beyond the span: park in the top level, re-filed on each cascade until in range
+    const uint64_t tick = delta < SPAN_TICKS ? node.deadlineTick_ : currentTick_ + SPAN_TICKS - 1;
+    int level = 0;
+    while (level < LEVELS - 1 && (tick - currentTick_) >= (uint64_t{1} << (SLOT_BITS * (level + 1)))) {
+        ++level;
+    }
+
+    TimerNode& slot = slots_[level][(tick >> (SLOT_BITS * level)) & SLOT_MASK];
+    node.prev_ = slot.prev_;
+    node.next_ = &slot;
+    slot.prev_->next_ = &node;
+    slot.prev_ = &node;
+}
+
+void TimerWheel::cascade(int level) {
+    TimerNode& slot = slots_[level][(currentTick_ >> (SLOT_BITS * level)) & SLOT_MASK];
+    TimerNode* node = slot.next_;
+    makeEmpty(slot.prev_, slot.next_, &slot);
+    while (node != &slot) {
+        TimerNode* next = node->next_;
+        link(*node);
+        node = next;
+    }
+}
+
+size_t TimerWheel::fire(TimerNode& list) {
+    size_t fired = 0;
+    while (list.next_ != &list) {
+        TimerNode* node = list.next_;
+        node->unlink();
+        node->wheel_ = nullptr;
+        --size_;
+        ++fired;
+        if (node->callback_) {
+            node->callback_(node->context_);
+        }
+    }
+    return fired;
+}
+
+size_t TimerWheel::advance(int64_t nowNs) {
+    const uint64_t target = tickAt(nowNs);
+    size_t fired = 0;
+    while (currentTick_ <= target && size_ > 0) {
+        if ((currentTick_ & SLOT_MASK) == 0) {
+            for (int level = 1; level < LEVELS; ++level) {
+                cascade(level);
+                if (((currentTick_ >> (SLOT_BITS * level)) & SLOT_MASK) != 0) {
+                    break;
+                }
+            }
+        }
+
+        // Detach the due slot first: callbacks rescheduling "now" land in the next tick
+        TimerNode due;
+        makeEmpty(due.prev_, due.next_, &due);
+        TimerNode& slot = slots_[0][currentTick_ & SLOT_MASK];
+        if (slot.next_ != &slot) {
+            due.next_ = slot.next_;
+            due.prev_ = slot.prev_;
+            due.next_->prev_ = &due;
+            due.prev_->next_ = &due;
+            makeEmpty(slot.prev_, slot.next_, &slot);
+        }
+        ++currentTick_;
+        fired += fire(due);
+    }
+    if (currentTick_ <= target) {
+        currentTick_ = target + 1;  // No timers left: skip the empty ticks
+    }
+    return fired;
+}
+
+int64_t TimerWheel::nextTimeoutNs(int64_t nowNs) const {
+    if (size_ == 0) {
+        return -1;
+    }
+    for (uint64_t i = 0; i < SLOTS; ++i) {
+        const uint64_t tick = currentTick_ + i;
+        const TimerNode& slot = slots_[0][tick & SLOT_MASK];
+        if ((i > 0 && (tick & SLOT_MASK) == 0) || slot.next_ != &slot) {
+            const int64_t dueNs = originNs_ + static_cast<int64_t>(tick) * tickNs_;
+            return dueNs > nowNs ? dueNs - nowNs : 0;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+/**
+ * @file timer_wheel.h
+ * @brief Hierarchical timing wheel with intrusive, allocation-free timers
+ *
+ * Four levels of 256 slots. Level 0 holds timers due within 256 ticks, one
+ * slot per tick; each higher level covers 256 times the range of the one
+ * below. When level 0 wraps, the next slot of level 1 is cascaded down (and
+ * so on upward), so every timer moves at most three times before it fires.
+ * Insert and cancel are O(1) list splices; advancing one tick touches one
+ * level-0 slot plus, every 256 ticks, one slot per higher level.
+ *
+ * The caller owns each TimerNode (typically inside a coroutine frame or a
+ * connection) and must keep it alive while it is scheduled:
+ *
+ * @code
+ * TimerNode heartbeat{[](void* ctx) { static_cast<Session*>(ctx)->onHeartbeat(); }, session};
+ * wheel.schedule(heartbeat, nowNs + 30'000'000'000);
+ * ...
+ * heartbeat.cancel();                 // Safe whether or not it already fired
+ * @endcode
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+class TimerWheel;
+
+/**
+ * @class TimerNode
+ * @brief One timer, linked into a wheel slot while scheduled
+ *
+ * Not copyable: the wheel points at it. Destroying a scheduled node cancels it.
+ */
+class TimerNode {
+public:
+    using Callback = void (*)(void* context);
+
+    TimerNode() = default;
+    TimerNode(Callback callback, void* context) : callback_(callback), context_(context) {}
+    ~TimerNode() { cancel(); }
+
+    TimerNode(const TimerNode&) = delete;
+    TimerNode& operator=(const TimerNode&) = delete;
+
+    /**
+     * @brief Removes the timer from its wheel (no-op if not scheduled)
+     */
+    void cancel();
+
+    bool scheduled() const { return wheel_ != nullptr; }
+
+private:
+    friend class TimerWheel;
+
+    TimerNode* prev_ = nullptr;
+    TimerNode* next_ = nullptr;
+    TimerWheel* wheel_ = nullptr;   ///< Set while linked into a slot
+    uint64_t deadlineTick_ = 0;
+    Callback callback_ = nullptr;
+    void* context_ = nullptr;
+
+    void unlink();
+};
+
+/**
+ * @class TimerWheel
+ * @brief Timer set driven by advance() from a single thread
+ *
+ * Not thread-safe: schedule, cancel and advance must run on the owning
+ * thread (the EventLoop's). Callbacks run inside advance() and may schedule
+ * or cancel any timer, including the one that fired.
+ */
+class TimerWheel {
+public:
+    static constexpr int LEVELS = 4;
+    static constexpr int SLOT_BITS = 8;
+    static constexpr size_t SLOTS = size_t{1} << SLOT_BITS;
+
+    /**
+     * @param tickNs Resolution; deadlines are rounded up to a tick
+     * @param nowNs Current time on the clock later passed to advance()
+     */
+    TimerWheel(int64_t tickNs, int64_t nowNs);
+    ~TimerWheel();
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    /**
+     * @brief Schedules (or reschedules) node to fire at deadlineNs
+     *
+     * A deadline in the past fires on the next advance(). Deadlines beyond
+     * the wheel's span (~49 days at 1ms ticks) are parked in the top level
+     * and re-filed until due.
+     */
+    void schedule(TimerNode& node, int64_t deadlineNs);
+
+    /**
+     * @brief Fires every timer due at or before nowNs
+     *
+     * @return Number of timers fired
+     */
+    size_t advance(int64_t nowNs);
+
+    /**
+     * @brief Time until the next advance() that can do work, or -1 if no timers
+     *
+     * Exact for timers within 256 ticks; otherwise the time to the next
+     * cascade. Scans at most one level of slots.
+     */
+    int64_t nextTimeoutNs(int64_t nowNs) const;
+
+    size_t size() const { return size_; }
+    int64_t tickNs() const { return tickNs_; }
+
+private:
+    friend class TimerNode;
+
+    const int64_t tickNs_;
+    const int64_t originNs_;            ///< Time of tick 0
+    uint64_t currentTick_ = 0;          ///< Next tick to process
+    size_t size_ = 0;
+    TimerNode slots_[LEVELS][SLOTS];    ///< List sentinels (circular)
+
+    void link(TimerNode& node);
+    void cascade(int level);
+    size_t fire(TimerNode& list);
+    uint64_t tickAt(int64_t nowNs) const;
+};
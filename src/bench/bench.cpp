@@ -0,0 +1,282 @@
+/**
+ * @file bench.cpp
+ * @brief hft-bench: microbenchmarks of the gateway's hot data structures
+ *
+ * Runs in-process against hft-core with no sockets, so results depend only
+ * on the CPU. Name the benchmarks to run on the command line (default: all):
+ *
+ * @code
+ * ./hft-bench            # every benchmark
+ * ./hft-bench timers     # one of them
+ * @endcode
+ *
+ * Benchmarks:
+ * - timers: TimerWheel with a million armed timers (insert, reschedule,
+ *   per-tick advance while none are due, and firing)
+ * - scanner: frame-boundary scanning (scanFrames) and MessageBuffer
+ *   extraction over fixed-stride and mixed-size streams
+ *
+ * Per-operation latencies are recorded in HdrHistograms and printed as
+ * p50/p99/p99.9; throughput figures are totals over wall time.
+ */
+
+#include "../async/timer_wheel.h"
+#include "../network/frame_scanner.h"
+#include "../network/hdr_histogram.h"
+#include "../network/message.h"
+#include "../util/tsc_clock.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int64_t TICK_NS = 1000000;         ///< Event loop wheel resolution
+constexpr size_t TIMER_COUNT = 1000000;
+constexpr size_t IDLE_TICKS = 100000;        ///< Ticks advanced with nothing due (100s of wheel time)
+constexpr uint64_t SEED = 42;
+constexpr size_t STREAM_BYTES = 16 * 1024 * 1024;  ///< Frames generated per scanner stream
+constexpr int SCAN_PASSES = 20;
+constexpr size_t RECV_CHUNK = 64 * 1024;           ///< Bytes handed to MessageBuffer per addData(), like one recv()
+
+/**
+ * @brief Nanoseconds elapsed since startTsc
+ */
+int64_t elapsedNs(uint64_t startTsc) {
+    return static_cast<int64_t>(static_cast<double>(readTsc() - startTsc) / tscTicksPerNs());
+}
+
+void printLatency(const char* name, const HdrHistogram& histogram) {
+    std::printf("  %-28s p50 %6lld ns  p99 %6lld ns  p99.9 %6lld ns  max %8lld ns\n", name,
+                static_cast<long long>(histogram.valueAtPercentile(50.0)),
+                static_cast<long long>(histogram.valueAtPercentile(99.0)),
+                static_cast<long long>(histogram.valueAtPercentile(99.9)),
+                static_cast<long long>(histogram.max()));
+}
+
+void countFired(void* context) {
+    ++*static_cast<size_t*>(context);
+}
+
+/**
+ * @brief A million timers on one wheel, the shape of a loop holding a million idle sessions
+ */
+void benchTimers() {
+    std::printf("timers: %zu timers, %lld ms ticks\n", TIMER_COUNT, static_cast<long long>(TICK_NS / 1000000));
+    std::mt19937_64 random(SEED);
+    size_t fired = 0;
+    std::deque<TimerNode> nodes;  // Nodes cannot move once scheduled
+    for (size_t i = 0; i < TIMER_COUNT; ++i) {
+        nodes.emplace_back(countFired, &fired);
+    }
+
+    // Idle-timeout shape: deadlines 1-2 hours out, so nothing fires during the idle run
+    auto wheel = std::make_unique<TimerWheel>(TICK_NS, 0);
+    std::uniform_int_distribution<int64_t> farDeadline(3600LL * 1000000000, 7200LL * 1000000000);
+    HdrHistogram insert;
+    for (size_t i = 0; i < TIMER_COUNT; ++i) {
+        const int64_t deadlineNs = farDeadline(random);
+        const uint64_t start = readTsc();
+        wheel->schedule(nodes[i], deadlineNs);
+        insert.record(elapsedNs(start));
+    }
+    printLatency("schedule", insert);
+
+    // Activity pushes a session's deadline out: cancel from its slot, re-file it
+    HdrHistogram reschedule;
+    std::uniform_int_distribution<size_t> pick(0, TIMER_COUNT - 1);
+    for (size_t i = 0; i < TIMER_COUNT; ++i) {
+        const size_t index = pick(random);
+        const int64_t deadlineNs = farDeadline(random);
+        const uint64_t start = readTsc();
+        wheel->schedule(nodes[index], deadlineNs);
+        reschedule.record(elapsedNs(start));
+    }
+    printLatency("reschedule", reschedule);
+
+    HdrHistogram tick;
+    int64_t nowNs = 0;
+    for (size_t i = 0; i < IDLE_TICKS; ++i) {
+        nowNs += TICK_NS;
+        const uint64_t start = readTsc();
+        wheel->advance(nowNs);
+        tick.record(elapsedNs(start));
+    }
+    printLatency("advance (none due)", tick);
+    HdrHistogram nextTimeout;
+    for (size_t i = 0; i < IDLE_TICKS; ++i) {
+        const uint64_t start = readTsc();
+        [[maybe_unused]] volatile int64_t timeoutNs = wheel->nextTimeoutNs(nowNs);
+        nextTimeout.record(elapsedNs(start));
+    }
+    printLatency("nextTimeoutNs", nextTimeout);
+    if (fired != 0) {
+        std::printf("  unexpected: %zu timers fired during the idle run\n", fired);
+    }
+
+    // Firing: every timer due within 10s of wheel time, advanced one tick at a time
+    wheel = std::make_unique<TimerWheel>(TICK_NS, 0);
+    std::uniform_int_distribution<int64_t> nearDeadline(TICK_NS, 10LL * 1000000000);
+    for (size_t i = 0; i < TIMER_COUNT; ++i) {
+        wheel->schedule(nodes[i], nearDeadline(random));
+    }
+    fired = 0;
+    nowNs = 0;
+    const uint64_t start = readTsc();
+    while (wheel->size() > 0) {
+        nowNs += TICK_NS;
+        wheel->advance(nowNs);
+    }
+    const int64_t totalNs = elapsedNs(start);
+    std::printf("  %-28s %zu fired in %.1f ms (%.1f ns per timer)\n", "fire", fired,
+                static_cast<double>(totalNs) / 1e6, static_cast<double>(totalNs) / static_cast<double>(fired));
+}
+
+/**
+ * @brief Fills about STREAM_BYTES with BigEndian32Header frames whose payload sizes come from nextSize
+ *
+ * @return Frames written
+ */
+template<typename SizeFn>
+size_t buildStream(std::string& stream, bool correlated, SizeFn nextSize) {
+    stream.clear();
+    size_t frames = 0;
+    char header[BigEndian32Header::HEADER_SIZE + BigEndian32Header::EXTENSION_SIZE];
+    while (stream.size() < STREAM_BYTES) {
+        const size_t length = nextSize();
+        size_t headerBytes = BigEndian32Header::HEADER_SIZE;
+        if (correlated) {
+            BigEndian32Header::encodeCorrelated(header, length, 1, frames + 1);
+            headerBytes += BigEndian32Header::EXTENSION_SIZE;
+        } else {
+            BigEndian32Header::encode(header, length, 0);
+        }
+        stream.append(header, headerBytes);
+        stream.append(length, 'x');
+        ++frames;
+    }
+    return frames;
+}
+
+void printThroughput(const char* name, size_t frames, size_t bytes, int64_t totalNs) {
+    const double seconds = static_cast<double>(totalNs) / 1e9;
+    std::printf("  %-28s %8.1f M frames/s  %6.2f GB/s  %5.2f ns/frame\n", name,
+                static_cast<double>(frames) / seconds / 1e6, static_cast<double>(bytes) / seconds / 1e9,
+                static_cast<double>(totalNs) / static_cast<double>(frames));
+}
+
+/**
+ * @brief scanFrames() alone, FRAME_BATCH spans per call as the receive path indexes them
+ */
+void scanStream(const char* name, const std::string& stream, size_t frames) {
+    FrameSpan spans[MessageBuffer::FRAME_BATCH];
+    size_t scanned = 0;
+    const uint64_t start = readTsc();
+    for (int pass = 0; pass < SCAN_PASSES; ++pass) {
+        size_t pos = 0;
+        while (pos < stream.size()) {
+            const FrameScan scan = scanFrames<BigEndian32Header>(stream.data() + pos, stream.size() - pos,
+                                                                 spans, MessageBuffer::FRAME_BATCH);
+            if (scan.frames == 0) {
+                break;
+            }
+            scanned += scan.frames;
+            pos += scan.bytes;
+        }
+    }
+    const int64_t totalNs = elapsedNs(start);
+    if (scanned != frames * SCAN_PASSES) {
+        std::printf("  unexpected: scanned %zu of %zu frames\n", scanned, frames * SCAN_PASSES);
+    }
+    printThroughput(name, scanned, stream.size() * SCAN_PASSES, totalNs);
+}
+
+/**
+ * @brief The whole receive path after recv(): addData() in RECV_CHUNK pieces, then extractMessage() until empty
+ */
+void extractStream(const char* name, const std::string& stream, size_t frames) {
+    MessageBuffer buffer;
+    std::string message;
+    size_t extracted = 0;
+    const uint64_t start = readTsc();
+    for (int pass = 0; pass < SCAN_PASSES; ++pass) {
+        for (size_t pos = 0; pos < stream.size(); pos += RECV_CHUNK) {
+            buffer.addData(stream.data() + pos, std::min(RECV_CHUNK, stream.size() - pos));
+            while (buffer.extractMessage(message)) {
+                ++extracted;
+            }
+        }
+    }
+    const int64_t totalNs = elapsedNs(start);
+    if (extracted != frames * SCAN_PASSES) {
+        std::printf("  unexpected: extracted %zu of %zu frames\n", extracted, frames * SCAN_PASSES);
+    }
+    printThroughput(name, extracted, stream.size() * SCAN_PASSES, totalNs);
+}
+
+/**
+ * @brief Frame indexing throughput on the stream shapes the gateway sees
+ */
+void benchScanner() {
+    std::printf("scanner: %zu MiB streams, %d passes\n", STREAM_BYTES >> 20, SCAN_PASSES);
+    std::mt19937_64 random(SEED);
+    std::string stream;
+
+    // Quotes: tiny fixed-size frames, the stride fast path's best case
+    size_t frames = buildStream(stream, false, [] { return size_t{32}; });
+    scanStream("scan fixed 32B", stream, frames);
+    extractStream("extract fixed 32B", stream, frames);
+
+    // Load generator requests: fixed size, correlated
+    frames = buildStream(stream, true, [] { return size_t{64}; });
+    scanStream("scan fixed 64B correlated", stream, frames);
+    extractStream("extract fixed 64B correlated", stream, frames);
+
+    // Mixed sizes break every run: one header at a time
+    std::uniform_int_distribution<size_t> size(16, 512);
+    frames = buildStream(stream, false, [&] { return size(random); });
+    scanStream("scan mixed 16-512B", stream, frames);
+    extractStream("extract mixed 16-512B", stream, frames);
+}
+
+struct Benchmark {
+    const char* name;
+    void (*run)();
+};
+
+const Benchmark BENCHMARKS[] = {
+    {"timers", benchTimers},
+    {"scanner", benchScanner},
+};
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        bool known = false;
+        for (const Benchmark& benchmark : BENCHMARKS) {
+            known |= std::strcmp(argv[i], benchmark.name) == 0;
+        }
+        if (!known) {
+            std::fprintf(stderr, "Unknown benchmark \"%s\"\n", argv[i]);
+            return 1;
+        }
+    }
+
+    tscTicksPerNs();  // Calibrate before the first measurement
+    for (const Benchmark& benchmark : BENCHMARKS) {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc; ++i) {
+            selected |= std::strcmp(argv[i], benchmark.name) == 0;
+        }
+        if (selected) {
+            benchmark.run();
+        }
+    }
+    return 0;
+}
@@ -1,6 +1,11 @@
 #include "client.h"
 #include "../network/socket_utils.h"
 #include "../network/message.h"
+#include "../network/multicast.h"
+#include "../network/async_io.h"
+#include "../config/config.h"
+#include "../logging/logger.h"
+#include "../util/tsc_clock.h"
 #include <sys/socket.h>
 #include <sys/poll.h>
 #include <netinet/tcp.h>
@@ -10,11 +15,84 @@
 #include <netinet/in.h>
 #include <chrono>
 #include <algorithm>
+#include <vector>
+
+namespace {
+
+constexpr int64_t SHUTDOWN_CHECK_NS = 50000000;  ///< Coroutine receivers re-check running/connected at least this often
+constexpr int64_t SHM_POLL_NS = 1000000;         ///< Shared-memory ring poll interval for coroutine receivers
+
+sockaddr_in serverAddressFor(const std::string& serverAddr, uint16_t serverPort) {
+    sockaddr_in serverAddress{};
+    serverAddress.sin_family = AF_INET;
+    serverAddress.sin_port = htons(serverPort);
+    if (inet_pton(AF_INET, serverAddr.c_str(), &serverAddress.sin_addr) <= 0) {
+        serverAddress.sin_addr.s_addr = inet_addr("127.0.0.1");
+    }
+    return serverAddress;
+}
+
+/**
+ * @brief Hands a correlated response to its request
+ * 
+ * @return false if the frame is not the response to an outstanding request
+ */
+bool completeRequest(RequestTracker* requests, uint64_t correlationId, const std::string& message) {
+    return requests && correlationId && requests->complete(correlationId, message);
+}
+
+void clientFrameReceived(ClientConnection& conn, const std::string& message, const RxTimestamp* rxTimestamp,
+                         uint64_t correlationId) {
+    LOG_INFO("Client connection {} received {} bytes{}", conn.id, message.size(), conn.shmAttached ? " (shm)" : "");
+    conn.traffic.recordIn(message.size());
+    if (rxTimestamp && rxTimestamp->kernelNs) {
+        conn.rxWakeup.record(rxTimestamp->wakeupDelayNs());
+    }
+    if (completeRequest(conn.requests.get(), correlationId, message)) {
+        return;
+    }
+    receivedMessages.push("Client", "[CLIENT] receives [SERVER] message [\"" + message + "\"]", conn.id);
+}
+
+void clientDisconnected(ClientConnection& conn) {
+    conn.connected = false;
+    LOG_INFO("Client connection {} disconnected", conn.id);
+    receivedMessages.push("System", "Server disconnected", conn.id);
+}
+
+} // namespace
+
+bool prepareClientSocket(int fd) {
+    if (!makeNonBlocking(fd)) {
+        return false;
+    }
+    int opt = 1;
+    #ifdef SO_NOSIGPIPE
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &opt, sizeof(opt));
+    #endif
+    opt = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+    int bufferSize = 64 * 1024;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize));
+    const GatewayConfig& config = gatewayConfig();
+    if (config.rxTimestamps) {
+        enableRxTimestamps(fd);
+    }
+    configureKeepalive(fd, config.tcpKeepaliveIdle, config.tcpKeepaliveInterval,
+                       config.tcpKeepaliveCount, config.tcpUserTimeoutMs);
+    return true;
+}
 
 void clientReceiveThread(SocketPtr clientSocket, 
                         std::atomic<bool>& running, 
                         std::atomic<bool>& connected, 
-                        MessageBuffer& buffer) {
+                        MessageBuffer& buffer,
+                        std::shared_ptr<ShmChannel> shm,
+                        LatencyHistogram* rxWakeup,
+                        int sessionId,
+                        ConnectionMetrics* traffic,
+                        RequestTracker* requests) {
     if (!clientSocket || *clientSocket < 0) {
         connected = false;
         return;
@@ -22,27 +100,59 @@ void clientReceiveThread(SocketPtr clientSocket,
     
     connected = true;
     std::string message;
+    RxTimestamp rxTimestamp;
+    RxTimestamp* rxTimestampOut = (rxWakeup && gatewayConfig().rxTimestamps) ? &rxTimestamp : nullptr;
     
     while (running && connected && clientSocket && *clientSocket >= 0) {
-        if (receiveFramedMessage(*clientSocket, buffer, message)) {
+        if (requests) {
+            requests->expire(static_cast<int64_t>(steadyClockNs()));
+        }
+        
+        if (shm) {
+            // Data flows over shared memory; the socket only signals liveness
+            if (receiveFramedMessage(*shm, message)) {
+                LOG_INFO("Client connection {} received {} bytes (shm)", sessionId, message.size());
+                if (traffic) {
+                    traffic->recordIn(message.size());
+                }
+                receivedMessages.push("Client", "[CLIENT] receives [SERVER] message [\"" + message + "\"]", sessionId);
+            } else if (shm->peerClosed() || socketPeerClosed(*clientSocket)) {
+                connected = false;
+                LOG_INFO("Client connection {} disconnected", sessionId);
+                receivedMessages.push("System", "Server disconnected", sessionId);
+                break;
+            }
+            continue;
+        }
+        
+        if (receiveFramedMessage(*clientSocket, buffer, message, rxTimestampOut)) {
+            LOG_INFO("Client connection {} received {} bytes", sessionId, message.size());
+            if (traffic) {
+                traffic->recordIn(message.size());
+            }
+            if (rxTimestampOut && rxTimestamp.kernelNs) {
+                rxWakeup->record(rxTimestamp.wakeupDelayNs());
+            }
+            if (completeRequest(requests, buffer.correlationId(), message)) {
+                continue;
+            }
             std::string formattedMsg = "[CLIENT] receives [SERVER] message [\"" + message + "\"]";
-            receivedMessages.push("Client", formattedMsg);
+            receivedMessages.push("Client", formattedMsg, sessionId);
         } else {
-            // Check if connection was closed
-            struct pollfd pfd;
-            pfd.fd = *clientSocket;
-            pfd.events = POLLIN;
-            pfd.revents = 0;
-            
-            if (poll(&pfd, 1, 0) < 0 || (pfd.revents & (POLLERR | POLLHUP))) {
+            // Check if connection was closed (EOF, reset, or socket error)
+            if (socketPeerClosed(*clientSocket)) {
                 connected = false;
-                receivedMessages.push("System", "Server disconnected");
+                LOG_INFO("Client connection {} disconnected", sessionId);
+                receivedMessages.push("System", "Server disconnected", sessionId);
                 break;
             }
         }
     }
     
     connected = false;
+    if (requests) {
+        requests->failAll();
+    }
 }
 
 void clientConnectThread(SocketPtr clientSocket, 
@@ -50,36 +160,21 @@ void clientConnectThread(SocketPtr clientSocket,
                         std::atomic<bool>& connectComplete, 
                         bool& connectSuccess,
                         const std::string& serverAddr, 
-                        int timeoutSeconds) {
+                        int timeoutSeconds,
+                        uint16_t serverPort) {
     if (!clientSocket || *clientSocket < 0) {
         connectSuccess = false;
         connectComplete = true;
         return;
     }
     
-    if (!makeNonBlocking(*clientSocket)) {
+    if (!prepareClientSocket(*clientSocket)) {
         connectSuccess = false;
         connectComplete = true;
         return;
     }
     
-    // Configure socket: TCP_NODELAY, 64KB buffers, SO_NOSIGPIPE
-    int opt = 1;
-    #ifdef SO_NOSIGPIPE
-    setsockopt(*clientSocket, SOL_SOCKET, SO_NOSIGPIPE, &opt, sizeof(opt));
-    #endif
-    opt = 1;
-    setsockopt(*clientSocket, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
-    int bufferSize = 64 * 1024;
-    setsockopt(*clientSocket, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
-    setsockopt(*clientSocket, SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize));
-    
-    sockaddr_in serverAddress;
-    serverAddress.sin_family = AF_INET;
-    serverAddress.sin_port = htons(8080);
-    if (inet_pton(AF_INET, serverAddr.c_str(), &serverAddress.sin_addr) <= 0) {
-        serverAddress.sin_addr.s_addr = inet_addr("127.0.0.1");
-    }
+    sockaddr_in serverAddress = serverAddressFor(serverAddr, serverPort);
     
     // Non-blocking connect
     int result = connect(*clientSocket, (struct sockaddr *)&serverAddress, sizeof(serverAddress));
@@ -139,3 +234,115 @@ void clientConnectThread(SocketPtr clientSocket,
     connectSuccess = false;
     connectComplete = true;
 }
+
+Task<void> clientConnectTask(EventLoop& loop,
+                             SocketPtr clientSocket,
+                             std::atomic<bool>& running,
+                             std::atomic<bool>& connectComplete,
+                             bool& connectSuccess,
+                             std::string serverAddr,
+                             int timeoutSeconds,
+                             uint16_t serverPort) {
+    connectSuccess = false;
+    if (clientSocket && *clientSocket >= 0 && running && prepareClientSocket(*clientSocket)) {
+        connectSuccess = co_await asyncConnect(loop, *clientSocket, serverAddressFor(serverAddr, serverPort),
+                                               static_cast<int64_t>(timeoutSeconds) * 1000000000);
+    }
+    connectComplete = true;
+}
+
+Task<void> clientReceiveTask(EventLoop& loop, ClientConnectionPtr conn) {
+    if (!conn || !conn->socket || *conn->socket < 0) {
+        if (conn) {
+            conn->connected = false;
+        }
+        co_return;
+    }
+    
+    conn->connected = true;
+    const int fd = *conn->socket;
+    std::string message;
+    RxTimestamp rxTimestamp;
+    RxTimestamp* rxTimestampOut = gatewayConfig().rxTimestamps ? &rxTimestamp : nullptr;
+    bool woken = false;  // Last wait reported the socket readable
+    
+    while (conn->running && conn->connected) {
+        if (conn->requests) {
+            conn->requests->expire(static_cast<int64_t>(steadyClockNs()));
+        }
+        
+        if (conn->shm) {
+            // Data flows over shared memory; the socket only signals liveness
+            bool received = false;
+            while (receiveFramedMessage(*conn->shm, message, 0)) {
+                clientFrameReceived(*conn, message, nullptr, 0);
+                received = true;
+            }
+            if (!received && (conn->shm->peerClosed() || socketPeerClosed(fd))) {
+                clientDisconnected(*conn);
+                break;
+            }
+            co_await loop.sleepFor(SHM_POLL_NS);
+            continue;
+        }
+        
+        bool received = false;
+        while (conn->running && receiveFramedMessage(fd, conn->buffer, message, rxTimestampOut, 0)) {
+            clientFrameReceived(*conn, message, rxTimestampOut, conn->buffer.correlationId());
+            received = true;
+        }
+        if (!received && woken && socketPeerClosed(fd)) {
+            clientDisconnected(*conn);
+            break;
+        }
+        
+        const IoStatus status = co_await loop.readable(fd, SHUTDOWN_CHECK_NS);
+        if (status == IoStatus::Error) {
+            clientDisconnected(*conn);
+            break;
+        }
+        woken = status == IoStatus::Ready;
+    }
+    
+    conn->connected = false;
+    if (conn->requests) {
+        conn->requests->failAll();
+    }
+}
+
+void marketDataReceiveThread(std::atomic<bool>& running,
+                             const std::string& group,
+                             int port,
+                             const std::string& retransmitHost,
+                             uint16_t retransmitPort) {
+    MulticastReceiver receiver(retransmitHost, retransmitPort);
+    if (!receiver.open(group, port)) {
+        receivedMessages.push("System", "Failed to join market data feed");
+        running = false;
+        return;
+    }
+    
+    std::vector<std::string> updates;
+    uint64_t reportedGaps = 0;
+    uint64_t reportedRestarts = 0;
+    
+    while (running) {
+        updates.clear();
+        if (receiver.receive(updates)) {
+            for (const auto& update : updates) {
+                receivedMessages.push("MarketData", "[MD] update [\"" + update + "\"]");
+            }
+        }
+        if (receiver.gapsDetected() != reportedGaps) {
+            reportedGaps = receiver.gapsDetected();
+            LOG_WARN("Market data gap: recovered {}, lost {}", receiver.packetsRecovered(), receiver.packetsLost());
+            receivedMessages.push("System", "Market data gap detected (recovered " +
+                                  std::to_string(receiver.packetsRecovered()) + ", lost " +
+                                  std::to_string(receiver.packetsLost()) + " packets)");
+        }
+        if (receiver.publisherRestarts() != reportedRestarts) {
+            reportedRestarts = receiver.publisherRestarts();
+            receivedMessages.push("System", "Market data publisher restarted; resynced to its new sequence");
+        }
+    }
+}
@@ -7,18 +7,43 @@
 
 #include "../network/socket_utils.h"
 #include "../network/message.h"
+#include "../network/shm_transport.h"
+#include "../network/latency_histogram.h"
+#include "../network/connection.h"
+#include "../async/event_loop.h"
+#include "../metrics/metrics.h"
 #include <atomic>
 #include <string>
 
+/**
+ * @brief Prepares an outbound socket before connect()
+ * 
+ * Non-blocking mode plus TCP_NODELAY, 64KB buffers, SO_NOSIGPIPE, RX
+ * timestamps (HFT_RX_TIMESTAMPS) and keepalive (HFT_TCP_KEEPALIVE_*).
+ */
+bool prepareClientSocket(int fd);
+
 /**
  * @brief Receives messages from server (runs in dedicated thread)
  * 
  * Pushes messages to receivedMessages queue. Detects disconnections via poll().
+ * When shm is set, receives from the shared-memory channel and uses the
+ * socket only to detect that the server went away. When rxWakeup is set,
+ * records kernel-to-user delay of each frame (needs HFT_RX_TIMESTAMPS).
+ * Messages are tagged with sessionId for the history viewer; frames are
+ * counted in traffic when set. Correlated responses complete their request
+ * in requests (when set) instead of being queued; its overdue requests are
+ * expired here and the rest fail when the connection closes.
  */
 void clientReceiveThread(SocketPtr clientSocket, 
                         std::atomic<bool>& running, 
                         std::atomic<bool>& connected, 
-                        MessageBuffer& buffer);
+                        MessageBuffer& buffer,
+                        std::shared_ptr<ShmChannel> shm = nullptr,
+                        LatencyHistogram* rxWakeup = nullptr,
+                        int sessionId = 0,
+                        ConnectionMetrics* traffic = nullptr,
+                        RequestTracker* requests = nullptr);
 
 /**
  * @brief Non-blocking connection with timeout (runs in dedicated thread)
@@ -30,4 +55,40 @@ void clientConnectThread(SocketPtr clientSocket,
                         std::atomic<bool>& connectComplete, 
                         bool& connectSuccess,
                         const std::string& serverAddr = "127.0.0.1", 
-                        int timeoutSeconds = 5);
+                        int timeoutSeconds = 5,
+                        uint16_t serverPort = 8080);
+
+/**
+ * @brief Coroutine version of clientConnectThread (runs on an event loop)
+ * 
+ * Sets connectSuccess and then connectComplete exactly like the thread, so
+ * the main loop picks up the result the same way.
+ */
+Task<void> clientConnectTask(EventLoop& loop,
+                             SocketPtr clientSocket,
+                             std::atomic<bool>& running,
+                             std::atomic<bool>& connectComplete,
+                             bool& connectSuccess,
+                             std::string serverAddr = "127.0.0.1",
+                             int timeoutSeconds = 5,
+                             uint16_t serverPort = 8080);
+
+/**
+ * @brief Coroutine version of clientReceiveThread for conn (runs on an event loop)
+ * 
+ * Holds conn for its lifetime; records RX wakeup delay and traffic on it
+ * and completes its correlated requests.
+ */
+Task<void> clientReceiveTask(EventLoop& loop, ClientConnectionPtr conn);
+
+/**
+ * @brief Receives multicast market data (runs in dedicated thread)
+ * 
+ * Pushes updates to receivedMessages queue. Sequence gaps are recovered from
+ * the TCP retransmit channel of the gateway at retransmitHost:retransmitPort.
+ */
+void marketDataReceiveThread(std::atomic<bool>& running,
+                             const std::string& group = "239.255.0.1",
+                             int port = 30001,
+                             const std::string& retransmitHost = "127.0.0.1",
+                             uint16_t retransmitPort = 8080);
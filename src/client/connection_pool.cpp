@@ -0,0 +1,389 @@
+#include "connection_pool.h"
+#include "client.h"
+#include "../network/async_io.h"
+#include "../logging/logger.h"
+#include "../util/tsc_clock.h"
+#include <algorithm>
+#include <cerrno>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <utility>
+
+namespace {
+
+constexpr int64_t SHUTDOWN_CHECK_NS = 50000000;        ///< Waits re-check stopping_ at least this often
+constexpr int64_t CONNECT_TIMEOUT_NS = 5000000000;     ///< Same limit as menu connects (option 2)
+constexpr int64_t MIN_BACKOFF_NS = 100000000;          ///< First redial delay after a failure
+constexpr int64_t MAX_BACKOFF_NS = 5000000000;         ///< Redial delay cap
+constexpr int64_t STOP_DRAIN_NS = 1000000000;          ///< Time given to member tasks to wind down
+
+} // namespace
+
+/**
+ * @brief Suspends a member's writer until a frame is queued or the member goes down
+ */
+struct ConnectionPool::WriterWait {
+    ConnectionPool* pool;
+    PoolMember* member;
+
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> awaiting) {
+        std::lock_guard<std::mutex> lock(member->mutex_);
+        if (!member->queue_.empty() || pool->stopping_ || member->state() != PoolMemberState::Healthy) {
+            return false;
+        }
+        member->parkedWriter_ = awaiting;
+        return true;
+    }
+    void await_resume() const noexcept {}
+};
+
+std::vector<PoolTarget> parsePoolTargets(const std::string& targets) {
+    std::vector<PoolTarget> parsed;
+    size_t start = 0;
+    while (start <= targets.size()) {
+        size_t end = targets.find(',', start);
+        if (end == std::string::npos) {
+            end = targets.size();
+        }
+        const std::string entry = targets.substr(start, end - start);
+        start = end + 1;
+        if (entry.empty()) {
+            continue;
+        }
+
+        const size_t colon = entry.rfind(':');
+        const long port = colon == std::string::npos ? 0 : std::strtol(entry.c_str() + colon + 1, nullptr, 10);
+        PoolTarget target;
+        target.name = entry;
+        target.address.sin_family = AF_INET;
+        target.address.sin_port = htons(static_cast<uint16_t>(port));
+        if (port <= 0 || port > 65535 ||
+            inet_pton(AF_INET, entry.substr(0, colon).c_str(), &target.address.sin_addr) != 1) {
+            LOG_WARN("Ignoring pool target '{}' (expected IPv4 host:port)", entry);
+            continue;
+        }
+        parsed.push_back(target);
+    }
+    return parsed;
+}
+
+const char* poolMemberStateName(PoolMemberState state) {
+    switch (state) {
+        case PoolMemberState::Connecting: return "connecting";
+        case PoolMemberState::Healthy: return "healthy";
+        case PoolMemberState::Backoff: return "backoff";
+    }
+    return "unknown";
+}
+
+size_t PoolMember::outstandingBytes() const {
+    const int fd = fd_.load(std::memory_order_acquire);
+    return queuedBytes_.load(std::memory_order_relaxed) + (fd >= 0 ? unacknowledgedBytes(fd) : 0);
+}
+
+int64_t PoolMember::tcpRttNs() const {
+    const int fd = fd_.load(std::memory_order_acquire);
+    return fd >= 0 ? tcpSmoothedRttNs(fd) : -1;
+}
+
+ConnectionPool::~ConnectionPool() {
+    stop();
+}
+
+bool ConnectionPool::start(const std::vector<PoolTarget>& targets, size_t connections, std::atomic<int>& nextId) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!members_.empty() || targets.empty()) {
+        return false;
+    }
+    stopping_ = false;
+    if (!loop_.start()) {
+        return false;
+    }
+    for (size_t i = 0; i < std::max<size_t>(connections, 1); ++i) {
+        members_.push_back(std::make_shared<PoolMember>(nextId++, targets[i % targets.size()]));
+    }
+    for (const auto& member : members_) {
+        loop_.spawn(runMember(member));
+    }
+    LOG_INFO("Connection pool started: {} connections over {} targets", members_.size(), targets.size());
+    return true;
+}
+
+void ConnectionPool::stop() {
+    if (!running()) {
+        return;
+    }
+    stopping_ = true;
+    // Sockets are only touched on the loop thread, so a closing member cannot race a reused fd
+    loop_.spawn([](ConnectionPool* pool) -> Task<void> {
+        for (const auto& member : pool->members()) {
+            pool->memberDown(*member, "pool stopped");
+        }
+        co_return;
+    }(this));
+    loop_.stop(STOP_DRAIN_NS);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    members_.clear();
+    LOG_INFO("Connection pool stopped");
+}
+
+bool ConnectionPool::running() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return !members_.empty();
+}
+
+std::vector<PoolMemberPtr> ConnectionPool::members() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return members_;
+}
+
+size_t ConnectionPool::healthyMembers() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<size_t>(std::count_if(members_.begin(), members_.end(), [](const PoolMemberPtr& member) {
+        return member->state() == PoolMemberState::Healthy;
+    }));
+}
+
+int ConnectionPool::send(std::shared_ptr<const std::string> message) {
+    if (!message || message->empty() || message->size() > MessageBuffer::MAX_PAYLOAD || stopping_) {
+        return 0;
+    }
+    return enqueue({std::move(message), steadyClockNs()}, nullptr);
+}
+
+int ConnectionPool::enqueue(PoolMember::Pending frame, const PoolMember* exclude) {
+    const size_t bytes = frame.message->size();
+    while (true) {
+        PoolMemberPtr best;
+        size_t bestBytes = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            // Ties (typically an idle pool) rotate so sparse traffic still spreads
+            const size_t first = members_.empty() ? 0 : next_++ % members_.size();
+            for (size_t i = 0; i < members_.size(); ++i) {
+                const PoolMemberPtr& member = members_[(first + i) % members_.size()];
+                if (member.get() == exclude || member->state() != PoolMemberState::Healthy) {
+                    continue;
+                }
+                const size_t outstanding = member->outstandingBytes();
+                if (outstanding + bytes > MAX_OUTSTANDING_BYTES) {
+                    continue;
+                }
+                if (!best || outstanding < bestBytes) {
+                    best = member;
+                    bestBytes = outstanding;
+                }
+            }
+        }
+        if (!best) {
+            return 0;
+        }
+        {
+            std::lock_guard<std::mutex> lock(best->mutex_);
+            // runMember() takes a failed member's queue under this lock once its state
+            // has left Healthy; a frame pushed after that would wait for the redial
+            if (best->state() != PoolMemberState::Healthy) {
+                continue;  // Went down since it was picked: choose again
+            }
+            best->queue_.push_back(std::move(frame));
+            best->queuedBytes_.fetch_add(bytes, std::memory_order_relaxed);
+        }
+        wakeWriter(*best);
+        return best->id;
+    }
+}
+
+void ConnectionPool::wakeWriter(PoolMember& member) {
+    std::coroutine_handle<> writer;
+    {
+        std::lock_guard<std::mutex> lock(member.mutex_);
+        writer = std::exchange(member.parkedWriter_, {});
+    }
+    if (writer) {
+        loop_.post(writer);
+    }
+}
+
+void ConnectionPool::memberDown(PoolMember& member, const char* reason) {
+    // Loop thread only
+    PoolMemberState expected = PoolMemberState::Healthy;
+    if (!member.state_.compare_exchange_strong(expected, PoolMemberState::Backoff)) {
+        return;
+    }
+    // Wakes both the reader (EOF) and a writer blocked on a full socket (EPIPE)
+    const int fd = member.fd_.load(std::memory_order_relaxed);
+    if (fd >= 0) {
+        shutdown(fd, SHUT_RDWR);
+    }
+    wakeWriter(member);
+    if (stopping_) {
+        return;
+    }
+    member.failures.fetch_add(1, std::memory_order_relaxed);
+    LOG_WARN("Pool member {} lost {}: {}", member.id, member.target.name, reason);
+    receivedMessages.push("System", "Pool member " + std::to_string(member.id) + " lost " +
+                          member.target.name + " (" + reason + "), redialing", member.id);
+}
+
+Task<void> ConnectionPool::runMember(PoolMemberPtr member) {
+    int64_t backoffNs = MIN_BACKOFF_NS;
+    while (!stopping_) {
+        member->state_ = PoolMemberState::Connecting;
+        SocketPtr socket = co_await connectMember(member);
+        // Writes go through a duplicate descriptor so the writer and the
+        // reader can each wait on the loop (one waiter per descriptor)
+        const int writeFd = socket ? dup(*socket) : -1;
+
+        if (writeFd >= 0) {
+            backoffNs = MIN_BACKOFF_NS;
+            member->buffer_.clear();
+            member->readerActive_ = true;
+            member->fd_.store(*socket, std::memory_order_release);
+            member->state_.store(PoolMemberState::Healthy, std::memory_order_release);
+            if (member->connects.fetch_add(1, std::memory_order_relaxed) > 0) {
+                receivedMessages.push("System", "Pool member " + std::to_string(member->id) +
+                                      " reconnected to " + member->target.name, member->id);
+            }
+            metrics.add(Counter::ClientConnects);
+            LOG_INFO("Pool member {} connected to {} (fd {})", member->id, member->target.name, *socket);
+
+            loop_.spawn(receiveMember(member, *socket));
+            co_await writeMember(member, writeFd);
+
+            memberDown(*member, "send failed");  // No-op if the reader or stop() got there first
+            while (member->readerActive_) {
+                co_await loop_.sleepFor(EventLoop::TIMER_TICK_NS);
+            }
+            member->fd_.store(-1, std::memory_order_release);
+            close(writeFd);
+            socket.reset();
+
+            // Frames not yet written move to the remaining members
+            std::deque<PoolMember::Pending> unsent;
+            {
+                std::lock_guard<std::mutex> lock(member->mutex_);
+                unsent.swap(member->queue_);
+                member->queuedBytes_.store(0, std::memory_order_relaxed);
+            }
+            size_t dropped = 0;
+            for (auto& frame : unsent) {
+                if (stopping_ || !enqueue(std::move(frame), member.get())) {
+                    ++dropped;
+                }
+            }
+            if (dropped && !stopping_) {
+                LOG_WARN("Pool member {} dropped {} unsent frames (no healthy member)", member->id, dropped);
+            }
+        } else {
+            member->state_ = PoolMemberState::Backoff;
+            member->failures.fetch_add(1, std::memory_order_relaxed);
+            LOG_WARN("Pool member {} could not connect to {}, retrying in {}ms",
+                     member->id, member->target.name, backoffNs / 1000000);
+        }
+
+        for (int64_t waitedNs = 0; waitedNs < backoffNs && !stopping_; waitedNs += SHUTDOWN_CHECK_NS) {
+            co_await loop_.sleepFor(std::min(SHUTDOWN_CHECK_NS, backoffNs - waitedNs));
+        }
+        if (writeFd < 0) {
+            backoffNs = std::min(backoffNs * 2, MAX_BACKOFF_NS);
+        }
+    }
+}
+
+Task<SocketPtr> ConnectionPool::connectMember(PoolMemberPtr member) {
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        co_return nullptr;
+    }
+    SocketPtr socket(new int(fd), [](int* s) {
+        if (s && *s >= 0) {
+            close(*s);
+        }
+        delete s;
+    });
+    if (!prepareClientSocket(fd)) {
+        co_return nullptr;
+    }
+
+    const uint64_t startNs = steadyClockNs();
+    sockaddr_in address = member->target.address;
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        if (errno != EINPROGRESS) {
+            co_return nullptr;
+        }
+        // Short waits so stop() is not held up by a target that never answers
+        IoStatus status = IoStatus::Timeout;
+        while (status == IoStatus::Timeout) {
+            if (stopping_ || steadyClockNs() - startNs >= static_cast<uint64_t>(CONNECT_TIMEOUT_NS)) {
+                co_return nullptr;
+            }
+            status = co_await loop_.writable(fd, SHUTDOWN_CHECK_NS);
+        }
+        int error = 0;
+        socklen_t len = sizeof(error);
+        if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len) != 0 || error != 0) {
+            co_return nullptr;
+        }
+    }
+    member->connectLatency.record(static_cast<int64_t>(steadyClockNs() - startNs));
+    co_return socket;
+}
+
+Task<void> ConnectionPool::receiveMember(PoolMemberPtr member, int fd) {
+    std::string message;
+    bool woken = false;  // Last wait reported the socket readable
+
+    while (!stopping_ && member->state() == PoolMemberState::Healthy) {
+        bool received = false;
+        while (receiveFramedMessage(fd, member->buffer_, message, nullptr, 0)) {
+            member->traffic.recordIn(message.size());
+            LOG_INFO("Pool member {} received {} bytes", member->id, message.size());
+            receivedMessages.push("Pool", "[POOL " + std::to_string(member->id) + "] receives [" +
+                                  member->target.name + "] message [\"" + message + "\"]", member->id);
+            received = true;
+        }
+        if (!received && woken && socketPeerClosed(fd)) {
+            memberDown(*member, "upstream closed the connection");
+            break;
+        }
+
+        const IoStatus status = co_await loop_.readable(fd, SHUTDOWN_CHECK_NS);
+        if (status == IoStatus::Error) {
+            memberDown(*member, "socket error");
+            break;
+        }
+        woken = status == IoStatus::Ready;
+    }
+    member->readerActive_ = false;
+}
+
+Task<void> ConnectionPool::writeMember(PoolMemberPtr member, int writeFd) {
+    while (!stopping_ && member->state() == PoolMemberState::Healthy) {
+        PoolMember::Pending frame;
+        {
+            std::lock_guard<std::mutex> lock(member->mutex_);
+            if (!member->queue_.empty()) {
+                frame = std::move(member->queue_.front());
+                member->queue_.pop_front();
+            }
+        }
+        if (!frame.message) {
+            co_await WriterWait{this, member.get()};
+            continue;
+        }
+
+        const size_t bytes = frame.message->size();
+        if (!co_await asyncSendFrame(loop_, writeFd, *frame.message)) {
+            // Back at the head of the queue: runMember() moves it to another member with the rest
+            std::lock_guard<std::mutex> lock(member->mutex_);
+            member->queue_.push_front(std::move(frame));
+            break;
+        }
+        member->queuedBytes_.fetch_sub(bytes, std::memory_order_relaxed);
+        member->traffic.recordOut(bytes);
+        member->queueLatency.record(static_cast<int64_t>(steadyClockNs() - frame.enqueuedNs));
+    }
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+/**
+ * @file connection_pool.h
+ * @brief Pool of outbound connections to upstream gateways on one event loop
+ *
+ * The pool dials HFT_POOL_CONNECTIONS connections spread round-robin over the
+ * HFT_POOL_TARGETS upstreams. Every member's connect, receive and send run as
+ * coroutines on the pool's own EventLoop, so N upstream links cost one thread
+ * whether or not HFT_COROUTINES is set.
+ *
+ * send() may be called from any thread. It queues the frame on the healthy
+ * member with the fewest outstanding bytes (queued in the pool plus written
+ * but not yet acknowledged by the peer's TCP stack) and wakes that member's
+ * writer. A member whose connect, send or receive fails leaves the rotation
+ * at once: its unsent frames move to the other members (or are dropped if
+ * none is healthy) and it redials with exponential backoff.
+ */
+
+#include "../network/socket_utils.h"
+#include "../network/message.h"
+#include "../network/latency_histogram.h"
+#include "../async/event_loop.h"
+#include "../metrics/metrics.h"
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <netinet/in.h>
+
+/**
+ * @struct PoolTarget
+ * @brief One upstream the pool connects to
+ */
+struct PoolTarget {
+    std::string name;       ///< "host:port" as configured
+    sockaddr_in address{};
+};
+
+/**
+ * @brief Parses comma-separated IPv4 "host:port" targets (invalid entries are skipped)
+ */
+std::vector<PoolTarget> parsePoolTargets(const std::string& targets);
+
+/**
+ * @brief Life cycle of a pool member's connection
+ */
+enum class PoolMemberState {
+    Connecting,  ///< Dialing its target
+    Healthy,     ///< Connected and taking sends
+    Backoff      ///< Last attempt failed; waiting before redialing
+};
+
+const char* poolMemberStateName(PoolMemberState state);
+
+/**
+ * @class PoolMember
+ * @brief One pooled connection and its statistics
+ *
+ * Statistics may be read from any thread; the connection itself is driven
+ * only by the pool's loop.
+ */
+class PoolMember {
+public:
+    PoolMember(int memberId, const PoolTarget& memberTarget) : id(memberId), target(memberTarget) {}
+
+    const int id;
+    const PoolTarget target;
+
+    LatencyHistogram connectLatency;    ///< connect() to established (ns)
+    LatencyHistogram queueLatency;      ///< send() to frame written to the socket (ns)
+    ConnectionMetrics traffic;
+    std::atomic<uint64_t> connects{0};  ///< Successful connects (the first plus reconnects)
+    std::atomic<uint64_t> failures{0};  ///< Failed connects and dropped connections
+
+    PoolMemberState state() const { return state_.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Bytes queued in the pool plus bytes the peer has not acknowledged
+     */
+    size_t outstandingBytes() const;
+
+    /**
+     * @brief Kernel smoothed RTT of the current connection (ns), or -1
+     */
+    int64_t tcpRttNs() const;
+
+private:
+    friend class ConnectionPool;
+
+    struct Pending {
+        std::shared_ptr<const std::string> message;
+        uint64_t enqueuedNs = 0;
+    };
+
+    std::atomic<PoolMemberState> state_{PoolMemberState::Connecting};
+    std::atomic<int> fd_{-1};               ///< Connected socket, -1 while down
+    std::atomic<size_t> queuedBytes_{0};    ///< Payload bytes queued or being written
+
+    std::mutex mutex_;                      ///< Guards queue_ and parkedWriter_
+    std::deque<Pending> queue_;
+    std::coroutine_handle<> parkedWriter_;  ///< Writer waiting for frames
+
+    // Loop thread only
+    MessageBuffer buffer_;
+    bool readerActive_ = false;
+};
+
+using PoolMemberPtr = std::shared_ptr<PoolMember>;
+
+/**
+ * @class ConnectionPool
+ * @brief Load-balanced set of outbound connections with automatic redial
+ *
+ * Thread safety: all public methods may be called from any thread.
+ */
+class ConnectionPool {
+public:
+    static constexpr size_t MAX_OUTSTANDING_BYTES = 4 * 1024 * 1024;  ///< Members past this are skipped by send()
+
+    ~ConnectionPool();
+
+    /**
+     * @brief Starts the loop and dials connections members over targets
+     *
+     * Member ids are taken from nextId so they do not clash with menu
+     * connections in the message history.
+     *
+     * @return false if already running, targets is empty or the loop failed to start
+     */
+    bool start(const std::vector<PoolTarget>& targets, size_t connections, std::atomic<int>& nextId);
+
+    /**
+     * @brief Closes every member and stops the loop; queued frames are discarded
+     */
+    void stop();
+
+    bool running() const;
+
+    /**
+     * @brief Queues message on the healthy member with the fewest outstanding bytes
+     *
+     * @return Id of the chosen member, or 0 if no member is healthy and below
+     *         MAX_OUTSTANDING_BYTES (or message is empty or too large)
+     */
+    int send(std::shared_ptr<const std::string> message);
+
+    /**
+     * @brief Snapshot of the members, for statistics
+     */
+    std::vector<PoolMemberPtr> members() const;
+
+    size_t healthyMembers() const;
+
+private:
+    struct WriterWait;
+
+    EventLoop loop_;
+    std::atomic<bool> stopping_{false};
+    mutable std::mutex mutex_;              ///< Guards members_
+    std::vector<PoolMemberPtr> members_;
+    size_t next_ = 0;                       ///< Rotates ties between members (guarded by mutex_)
+
+    int enqueue(PoolMember::Pending frame, const PoolMember* exclude);
+    void wakeWriter(PoolMember& member);
+    void memberDown(PoolMember& member, const char* reason);
+
+    Task<void> runMember(PoolMemberPtr member);
+    Task<SocketPtr> connectMember(PoolMemberPtr member);
+    Task<void> receiveMember(PoolMemberPtr member, int fd);
+    Task<void> writeMember(PoolMemberPtr member, int writeFd);
+};
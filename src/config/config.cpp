@@ -0,0 +1,147 @@
+#include "config.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+
+bool envFlag(const char* name, bool defaultValue) {
+    const char* value = std::getenv(name);
+    if (!value || !*value) {
+        return defaultValue;
+    }
+    return std::strcmp(value, "1") == 0 || strcasecmp(value, "true") == 0 ||
+           strcasecmp(value, "on") == 0 || strcasecmp(value, "yes") == 0;
+}
+
+long envInt(const char* name, long defaultValue) {
+    const char* value = std::getenv(name);
+    if (!value || !*value) {
+        return defaultValue;
+    }
+    char* end = nullptr;
+    const long parsed = std::strtol(value, &end, 10);
+    return (end && *end == '\0') ? parsed : defaultValue;
+}
+
+std::string envString(const char* name, const std::string& defaultValue) {
+    const char* value = std::getenv(name);
+    return (value && *value) ? std::string(value) : defaultValue;
+}
+
+std::vector<ListenerConfig> parseListenerTable(const std::string& table) {
+    std::vector<ListenerConfig> listeners;
+    size_t entryStart = 0;
+    while (entryStart <= table.size()) {
+        size_t entryEnd = table.find(';', entryStart);
+        if (entryEnd == std::string::npos) {
+            entryEnd = table.size();
+        }
+        const std::string entry = table.substr(entryStart, entryEnd - entryStart);
+        entryStart = entryEnd + 1;
+        
+        ListenerConfig listener;
+        size_t fieldStart = 0;
+        while (fieldStart < entry.size()) {
+            size_t fieldEnd = entry.find(',', fieldStart);
+            if (fieldEnd == std::string::npos) {
+                fieldEnd = entry.size();
+            }
+            const std::string field = entry.substr(fieldStart, fieldEnd - fieldStart);
+            fieldStart = fieldEnd + 1;
+            const size_t eq = field.find('=');
+            if (eq == std::string::npos) {
+                continue;
+            }
+            const std::string key = field.substr(0, eq);
+            const std::string value = field.substr(eq + 1);
+            const long number = std::strtol(value.c_str(), nullptr, 10);
+            if (key == "name") {
+                listener.name = value;
+            } else if (key == "bind") {
+                listener.bindAddress = value;
+            } else if (key == "port" && number > 0 && number <= 65535) {
+                listener.port = static_cast<uint16_t>(number);
+            } else if (key == "path") {
+                listener.unixPath = value;
+            } else if (key == "buffer" && number > 0) {
+                listener.bufferBytes = static_cast<int>(number);
+            } else if (key == "max" && number > 0) {
+                listener.maxConnections = static_cast<size_t>(number);
+            } else if (key == "loops" && number >= 0) {
+                listener.loopThreads = static_cast<size_t>(number);
+            }
+        }
+        if (listener.port == 0 && listener.unixPath.empty()) {
+            continue;
+        }
+        if (listener.name.empty()) {
+            listener.name = listener.unixPath.empty() ? "tcp" + std::to_string(listener.port) : "unix";
+        }
+        listeners.push_back(listener);
+    }
+    return listeners;
+}
+
+const GatewayConfig& gatewayConfig() {
+    // Function-local static: initialized once, thread-safe
+    static const GatewayConfig config = [] {
+        GatewayConfig c;
+        c.rxTimestamps = envFlag("HFT_RX_TIMESTAMPS", c.rxTimestamps);
+        c.txTimestamps = envFlag("HFT_TX_TIMESTAMPS", c.txTimestamps);
+        const long threshold = envInt("HFT_ZEROCOPY_THRESHOLD", 0);
+        c.zeroCopyThreshold = threshold > 0 ? static_cast<size_t>(threshold) : 0;
+        c.logFile = envString("HFT_LOG_FILE", c.logFile);
+        c.logLevel = envString("HFT_LOG_LEVEL", c.logLevel);
+        const long historyCapacity = envInt("HFT_HISTORY_CAPACITY", static_cast<long>(c.historyCapacity));
+        c.historyCapacity = historyCapacity > 0 ? static_cast<size_t>(historyCapacity) : c.historyCapacity;
+        c.historyFile = envString("HFT_HISTORY_FILE", c.historyFile);
+        c.throttleMessagesPerSec = static_cast<double>(std::max(envInt("HFT_THROTTLE_MSGS", 0), 0L));
+        c.throttleBytesPerSec = static_cast<double>(std::max(envInt("HFT_THROTTLE_BYTES", 0), 0L));
+        c.throttlePolicy = envString("HFT_THROTTLE_POLICY", c.throttlePolicy);
+        c.adminSocket = envString("HFT_ADMIN_SOCKET", c.adminSocket);
+        if (c.adminSocket == "off") {
+            c.adminSocket.clear();
+        }
+        const long adminPort = envInt("HFT_ADMIN_PORT", 0);
+        c.adminPort = (adminPort > 0 && adminPort <= 65535) ? static_cast<int>(adminPort) : 0;
+        c.conflate = envFlag("HFT_CONFLATE", c.conflate);
+        const std::string transport = envString("HFT_TRANSPORT", "tcp");
+        c.shmTransport = transport == "shm" || transport == "SHM";
+        const long maxSubscriptions = envInt("HFT_MAX_SUBSCRIPTIONS", static_cast<long>(c.maxSubscriptionsPerSession));
+        c.maxSubscriptionsPerSession = maxSubscriptions > 0 ? static_cast<size_t>(maxSubscriptions) : c.maxSubscriptionsPerSession;
+        const long maxSymbols = envInt("HFT_MAX_SYMBOLS", static_cast<long>(c.maxSymbols));
+        c.maxSymbols = maxSymbols > 0 ? static_cast<size_t>(maxSymbols) : c.maxSymbols;
+        c.coroutines = envFlag("HFT_COROUTINES", c.coroutines);
+        const long loopThreads = envInt("HFT_EVENT_LOOP_THREADS", static_cast<long>(c.eventLoopThreads));
+        c.eventLoopThreads = loopThreads > 0 ? static_cast<size_t>(loopThreads) : c.eventLoopThreads;
+        c.tcpKeepaliveIdle = static_cast<int>(std::max(envInt("HFT_TCP_KEEPALIVE_IDLE", 0), 0L));
+        const long keepaliveInterval = envInt("HFT_TCP_KEEPALIVE_INTERVAL", c.tcpKeepaliveInterval);
+        c.tcpKeepaliveInterval = keepaliveInterval > 0 ? static_cast<int>(keepaliveInterval) : c.tcpKeepaliveInterval;
+        const long keepaliveCount = envInt("HFT_TCP_KEEPALIVE_COUNT", c.tcpKeepaliveCount);
+        c.tcpKeepaliveCount = keepaliveCount > 0 ? static_cast<int>(keepaliveCount) : c.tcpKeepaliveCount;
+        c.tcpUserTimeoutMs = static_cast<int>(std::max(envInt("HFT_TCP_USER_TIMEOUT", 0), 0L));
+        c.idleTimeoutMs = std::max(envInt("HFT_IDLE_TIMEOUT_MS", 0), 0L);
+        c.drainTimeoutMs = std::max(envInt("HFT_DRAIN_TIMEOUT_MS", c.drainTimeoutMs), 0L);
+        c.sendTimeoutMs = std::max(envInt("HFT_SEND_TIMEOUT_MS", c.sendTimeoutMs), 0L);
+        c.handoffSocket = envString("HFT_HANDOFF_SOCKET", c.handoffSocket);
+        if (c.handoffSocket == "off") {
+            c.handoffSocket.clear();
+        }
+        c.takeover = envFlag("HFT_TAKEOVER", c.takeover);
+        c.handoffSessions = envFlag("HFT_HANDOFF_SESSIONS", c.handoffSessions);
+        c.listeners = parseListenerTable(envString("HFT_LISTENERS", ""));
+        if (c.listeners.empty()) {
+            // The original pair: TCP on every interface plus the local Unix socket (DEFAULT_UNIX_SOCKET_PATH)
+            c.listeners = parseListenerTable("name=tcp,port=8080;name=unix,path=/tmp/hft-gateway.sock");
+        }
+        c.poolTargets = envString("HFT_POOL_TARGETS", c.poolTargets);
+        const long poolConnections = envInt("HFT_POOL_CONNECTIONS", static_cast<long>(c.poolConnections));
+        c.poolConnections = poolConnections > 0 ? static_cast<size_t>(poolConnections) : c.poolConnections;
+        c.requestTimeoutMs = std::max(envInt("HFT_REQUEST_TIMEOUT_MS", 0), 0L);
+        c.retransmitHost = envString("HFT_RETRANSMIT_HOST", c.retransmitHost);
+        const long retransmitPort = envInt("HFT_RETRANSMIT_PORT", c.retransmitPort);
+        c.retransmitPort = retransmitPort > 0 && retransmitPort <= 65535 ? static_cast<uint16_t>(retransmitPort) : c.retransmitPort;
+        return c;
+    }();
+    return config;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @file config.h
+ * @brief Process-wide gateway settings read from the environment
+ * 
+ * Loaded once on first use. Every setting is optional and defaults to the
+ * gateway's original behavior.
+ */
+
+/**
+ * @struct ListenerConfig
+ * @brief One entry of the server's listener table (HFT_LISTENERS)
+ * 
+ * Each listener gets its own accept thread, connection limit and socket
+ * buffers and, in coroutine mode, optionally its own event loop threads, so
+ * a connection burst on one class of traffic does not hold up the others.
+ */
+struct ListenerConfig {
+    std::string name;              ///< Label for logs and metrics
+    std::string bindAddress;       ///< IPv4 address of the interface to bind (empty = all)
+    uint16_t port = 0;             ///< TCP port (0 for a Unix domain listener)
+    std::string unixPath;          ///< Unix domain socket path (empty for TCP)
+    int bufferBytes = 64 * 1024;   ///< SO_RCVBUF/SO_SNDBUF of the listener and its sessions
+    size_t maxConnections = 1000;  ///< Sessions admitted at once through this listener
+    size_t loopThreads = 0;        ///< Dedicated event loop threads with HFT_COROUTINES (0 = shared eventLoops)
+};
+
+/**
+ * @struct GatewayConfig
+ * @brief Optional features toggled per deployment
+ */
+struct GatewayConfig {
+    bool rxTimestamps = false;  ///< HFT_RX_TIMESTAMPS: kernel/hardware RX timestamps on sessions
+    bool txTimestamps = false;  ///< HFT_TX_TIMESTAMPS: send-to-wire latency via TX timestamps
+    size_t zeroCopyThreshold = 0;  ///< HFT_ZEROCOPY_THRESHOLD: min frame bytes for MSG_ZEROCOPY (0 = off)
+    std::string logFile = "hft-gateway.log";  ///< HFT_LOG_FILE: async log destination ("-" = stderr)
+    std::string logLevel = "info";            ///< HFT_LOG_LEVEL: debug, info, warn or error
+    size_t historyCapacity = 1000;  ///< HFT_HISTORY_CAPACITY: messages kept for the history viewer
+    std::string historyFile;        ///< HFT_HISTORY_FILE: mmap'd history file (empty = in memory)
+    double throttleMessagesPerSec = 0;  ///< HFT_THROTTLE_MSGS: inbound messages/sec per session (0 = off)
+    double throttleBytesPerSec = 0;     ///< HFT_THROTTLE_BYTES: inbound bytes/sec per session (0 = off)
+    std::string throttlePolicy = "reject";  ///< HFT_THROTTLE_POLICY: reject, delay or disconnect
+    std::string adminSocket = "/tmp/hft-gateway-admin.sock";  ///< HFT_ADMIN_SOCKET: metrics Unix socket ("off" = none)
+    int adminPort = 0;  ///< HFT_ADMIN_PORT: metrics TCP port on 127.0.0.1 (0 = off)
+    bool conflate = false;  ///< HFT_CONFLATE: sessions keep only the latest unsent update per symbol
+    bool shmTransport = false;  ///< HFT_TRANSPORT: "shm" moves option 2 connections onto a shared-memory ring pair ("tcp" = off)
+    size_t maxSubscriptionsPerSession = 256;  ///< HFT_MAX_SUBSCRIPTIONS: symbols one session may subscribe to
+    size_t maxSymbols = 10000;  ///< HFT_MAX_SYMBOLS: distinct symbols with at least one subscriber
+    bool coroutines = false;  ///< HFT_COROUTINES: run sessions as coroutines on event loops instead of threads
+    size_t eventLoopThreads = 2;  ///< HFT_EVENT_LOOP_THREADS: event loop threads when coroutines are on
+    int tcpKeepaliveIdle = 0;      ///< HFT_TCP_KEEPALIVE_IDLE: seconds idle before keepalive probes (0 = off)
+    int tcpKeepaliveInterval = 5;  ///< HFT_TCP_KEEPALIVE_INTERVAL: seconds between probes
+    int tcpKeepaliveCount = 3;     ///< HFT_TCP_KEEPALIVE_COUNT: unanswered probes before the kernel drops the connection
+    int tcpUserTimeoutMs = 0;      ///< HFT_TCP_USER_TIMEOUT: ms unacknowledged data may wait before the kernel drops the connection (0 = off)
+    int64_t idleTimeoutMs = 0;     ///< HFT_IDLE_TIMEOUT_MS: server sessions with no inbound frame for this long are reaped (0 = off)
+    int64_t drainTimeoutMs = 1000; ///< HFT_DRAIN_TIMEOUT_MS: time allowed to flush and log out sessions when the server stops
+    int64_t sendTimeoutMs = 1000;  ///< HFT_SEND_TIMEOUT_MS: coroutine sessions drop a peer that accepts no reply bytes for this long (0 = off)
+    std::string handoffSocket = "/tmp/hft-gateway-handoff.sock";  ///< HFT_HANDOFF_SOCKET: hot restart rendezvous while the server runs ("off" = none)
+    bool takeover = false;         ///< HFT_TAKEOVER: option 1 inherits the listeners of the gateway on handoffSocket
+    bool handoffSessions = false;  ///< HFT_HANDOFF_SESSIONS: hand live sessions to the successor too, instead of logging them out
+    std::vector<ListenerConfig> listeners;  ///< HFT_LISTENERS: server listener table (default: TCP 8080 and /tmp/hft-gateway.sock)
+    std::string poolTargets = "127.0.0.1:8080";  ///< HFT_POOL_TARGETS: comma-separated host:port upstreams of the connection pool
+    size_t poolConnections = 4;    ///< HFT_POOL_CONNECTIONS: pooled connections, spread over the targets
+    int64_t requestTimeoutMs = 0;  ///< HFT_REQUEST_TIMEOUT_MS: option 4 sends correlated requests that fail after this long (0 = plain frames)
+    std::string retransmitHost = "127.0.0.1";  ///< HFT_RETRANSMIT_HOST: gateway (IPv4) the option 9 feed asks for missed multicast packets
+    uint16_t retransmitPort = 8080;            ///< HFT_RETRANSMIT_PORT: its TCP port
+};
+
+/**
+ * @brief Returns the configuration, reading environment variables on first call
+ */
+const GatewayConfig& gatewayConfig();
+
+/**
+ * @brief Parses a listener table
+ * 
+ * Entries are separated by ';', fields by ',':
+ * "name=orders,bind=10.0.0.5,port=8080,max=500,loops=2;name=local,path=/tmp/x.sock".
+ * Fields: name, bind, port, path, buffer (bytes), max (connections),
+ * loops (event loop threads). Entries with neither port nor path are skipped.
+ */
+std::vector<ListenerConfig> parseListenerTable(const std::string& table);
+
+/**
+ * @brief Reads a boolean environment variable ("1", "true", "on", "yes")
+ */
+bool envFlag(const char* name, bool defaultValue);
+
+/**
+ * @brief Reads an integer environment variable
+ */
+long envInt(const char* name, long defaultValue);
+
+/**
+ * @brief Reads a string environment variable
+ */
+std::string envString(const char* name, const std::string& defaultValue);
@@ -0,0 +1,130 @@
+#include "load_profile.h"
+#include "../config/config.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <strings.h>
+
+bool SizeDistribution::parse(const std::string& spec) {
+    const size_t colon = spec.find(':');
+    if (colon == std::string::npos) {
+        return false;
+    }
+    const std::string kind = spec.substr(0, colon);
+    const std::string args = spec.substr(colon + 1);
+    char* end = nullptr;
+    const double first = std::strtod(args.c_str(), &end);
+    if (end == args.c_str() || first <= 0) {
+        return false;
+    }
+
+    if (kind == "fixed" && *end == '\0') {
+        kind_ = Kind::Fixed;
+        a_ = b_ = first;
+        return true;
+    }
+    if ((kind == "uniform" && *end == '-') || (kind == "lognormal" && *end == ',')) {
+        const char* secondStart = end + 1;
+        const double second = std::strtod(secondStart, &end);
+        if (end == secondStart || *end != '\0' || second <= 0) {
+            return false;
+        }
+        if (kind == "uniform") {
+            kind_ = Kind::Uniform;
+            a_ = std::min(first, second);
+            b_ = std::max(first, second);
+        } else {
+            kind_ = Kind::LogNormal;
+            a_ = first;
+            b_ = second;
+        }
+        return true;
+    }
+    return false;
+}
+
+size_t SizeDistribution::sample(std::mt19937_64& rng, size_t maxBytes) const {
+    double size = a_;
+    switch (kind_) {
+        case Kind::Fixed:
+            break;
+        case Kind::Uniform:
+            size = std::uniform_real_distribution<double>(a_, b_ + 1)(rng);
+            break;
+        case Kind::LogNormal:
+            // Median of a lognormal is exp(mu)
+            size = std::lognormal_distribution<double>(std::log(a_), b_)(rng);
+            break;
+    }
+    return std::clamp<size_t>(static_cast<size_t>(size), 1, maxBytes);
+}
+
+std::string SizeDistribution::describe() const {
+    char text[64];
+    switch (kind_) {
+        case Kind::Fixed:
+            std::snprintf(text, sizeof(text), "fixed %.0fB", a_);
+            break;
+        case Kind::Uniform:
+            std::snprintf(text, sizeof(text), "uniform %.0f-%.0fB", a_, b_);
+            break;
+        case Kind::LogNormal:
+            std::snprintf(text, sizeof(text), "lognormal median %.0fB sigma %.2f", a_, b_);
+            break;
+    }
+    return text;
+}
+
+LoadProfile loadProfileFromEnvironment() {
+    LoadProfile p;
+    p.target = envString("HFT_LOADGEN_TARGET", p.target);
+    const long port = envInt("HFT_LOADGEN_PORT", p.port);
+    p.port = port > 0 && port <= 65535 ? static_cast<uint16_t>(port) : p.port;
+    const long connections = envInt("HFT_LOADGEN_CONNECTIONS", static_cast<long>(p.connections));
+    p.connections = connections > 0 ? static_cast<size_t>(connections) : p.connections;
+    const long threads = envInt("HFT_LOADGEN_THREADS", static_cast<long>(p.threads));
+    p.threads = threads > 0 ? static_cast<size_t>(threads) : p.threads;
+    p.threads = std::min(p.threads, p.connections);
+    const long rate = envInt("HFT_LOADGEN_RATE", static_cast<long>(p.rate));
+    p.rate = rate > 0 ? static_cast<double>(rate) : p.rate;
+    p.durationMs = std::max(envInt("HFT_LOADGEN_DURATION_MS", static_cast<long>(p.durationMs)), 1L);
+    p.drainMs = std::max(envInt("HFT_LOADGEN_DRAIN_MS", static_cast<long>(p.drainMs)), 0L);
+    p.warmupMs = std::clamp(envInt("HFT_LOADGEN_WARMUP_MS", 0), 0L, static_cast<long>(p.durationMs));
+    p.arrivals = strcasecmp(envString("HFT_LOADGEN_ARRIVALS", "poisson").c_str(), "bursty") == 0
+                     ? ArrivalKind::Bursty : ArrivalKind::Poisson;
+    p.burstSize = static_cast<double>(std::max(envInt("HFT_LOADGEN_BURST", static_cast<long>(p.burstSize)), 1L));
+    const std::string sizes = envString("HFT_LOADGEN_SIZES", "");
+    if (!sizes.empty() && !p.sizes.parse(sizes)) {
+        std::fprintf(stderr, "Ignoring invalid HFT_LOADGEN_SIZES \"%s\"\n", sizes.c_str());
+    }
+    p.type = static_cast<uint8_t>(std::clamp(envInt("HFT_LOADGEN_TYPE", p.type), 0L, 255L));
+    p.seed = static_cast<uint64_t>(envInt("HFT_LOADGEN_SEED", static_cast<long>(p.seed)));
+    p.spectrumPrefix = envString("HFT_LOADGEN_SPECTRUM", "");
+    return p;
+}
+
+const char* arrivalKindName(ArrivalKind kind) {
+    return kind == ArrivalKind::Bursty ? "bursty" : "poisson";
+}
+
+ArrivalSchedule::ArrivalSchedule(ArrivalKind kind, double rate, double burstSize, uint64_t seed, int64_t startNs)
+    : kind_(kind),
+      rng_(seed),
+      // Bursts come burstSize times less often so the mean rate stays the same
+      gapNs_((kind == ArrivalKind::Bursty ? rate / burstSize : rate) / 1e9),
+      extraInBurst_(1.0 / burstSize),
+      nextNs_(static_cast<double>(startNs)) {}
+
+int64_t ArrivalSchedule::next() {
+    if (burstLeft_ > 0) {
+        // Rest of the burst is due at the same instant
+        --burstLeft_;
+        return static_cast<int64_t>(nextNs_);
+    }
+    nextNs_ += gapNs_(rng_);
+    if (kind_ == ArrivalKind::Bursty) {
+        burstLeft_ = extraInBurst_(rng_);
+    }
+    return static_cast<int64_t>(nextNs_);
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+/**
+ * @file load_profile.h
+ * @brief Arrival processes and message size distributions for hft-loadgen
+ *
+ * The load generator is open-loop: every message gets an intended send time
+ * from its arrival schedule before anything is sent, and a sender that falls
+ * behind (full socket, slow gateway) keeps the schedule rather than waiting
+ * for responses. Latency measured from the intended time therefore includes
+ * the queuing a real counterparty would see (no coordinated omission).
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+
+/**
+ * @brief How message arrivals are spaced in time
+ */
+enum class ArrivalKind {
+    Poisson,  ///< Exponential gaps at the configured rate
+    Bursty    ///< Bursts arrive as a Poisson process; each sends a geometric number of messages at once
+};
+
+/**
+ * @class SizeDistribution
+ * @brief Payload sizes: "fixed:N", "uniform:MIN-MAX" or "lognormal:MEDIAN,SIGMA"
+ */
+class SizeDistribution {
+public:
+    /**
+     * @brief Parses spec; returns false (leaving fixed 64 bytes) if it is malformed
+     */
+    bool parse(const std::string& spec);
+
+    /**
+     * @brief Draws a size clamped to 1..maxBytes
+     */
+    size_t sample(std::mt19937_64& rng, size_t maxBytes) const;
+
+    std::string describe() const;
+
+private:
+    enum class Kind { Fixed, Uniform, LogNormal };
+
+    Kind kind_ = Kind::Fixed;
+    double a_ = 64;  ///< Fixed size, uniform minimum or lognormal median
+    double b_ = 64;  ///< Uniform maximum or lognormal sigma
+};
+
+/**
+ * @struct LoadProfile
+ * @brief Load generator settings, read from HFT_LOADGEN_* environment variables
+ */
+struct LoadProfile {
+    std::string target = "127.0.0.1";  ///< HFT_LOADGEN_TARGET: gateway IPv4 address
+    uint16_t port = 8080;              ///< HFT_LOADGEN_PORT: gateway TCP port
+    size_t connections = 100;          ///< HFT_LOADGEN_CONNECTIONS: sessions opened against the gateway
+    size_t threads = 2;                ///< HFT_LOADGEN_THREADS: sender/receiver thread pairs, each owning a share of the connections
+    double rate = 10000;               ///< HFT_LOADGEN_RATE: aggregate messages per second
+    int64_t durationMs = 10000;        ///< HFT_LOADGEN_DURATION_MS: length of the send schedule
+    int64_t drainMs = 2000;            ///< HFT_LOADGEN_DRAIN_MS: wait for outstanding responses after the schedule ends
+    int64_t warmupMs = 0;              ///< HFT_LOADGEN_WARMUP_MS: messages intended this early in the schedule are not recorded
+    ArrivalKind arrivals = ArrivalKind::Poisson;  ///< HFT_LOADGEN_ARRIVALS: poisson or bursty
+    double burstSize = 50;             ///< HFT_LOADGEN_BURST: mean messages per burst (bursty)
+    SizeDistribution sizes;            ///< HFT_LOADGEN_SIZES: payload size distribution (default fixed:64)
+    uint8_t type = 1;                  ///< HFT_LOADGEN_TYPE: message type on every request
+    uint64_t seed = 1;                 ///< HFT_LOADGEN_SEED: random seed, so runs are repeatable
+    std::string spectrumPrefix;        ///< HFT_LOADGEN_SPECTRUM: write <prefix>-corrected.hgrm and <prefix>-uncorrected.hgrm
+};
+
+/**
+ * @brief Reads the profile from the environment (invalid values keep defaults)
+ */
+LoadProfile loadProfileFromEnvironment();
+
+const char* arrivalKindName(ArrivalKind kind);
+
+/**
+ * @class ArrivalSchedule
+ * @brief Intended send times of one sender, independent of when sends complete
+ */
+class ArrivalSchedule {
+public:
+    /**
+     * @param rate Messages per second for this sender
+     * @param startNs steadyClockNs() of the first possible arrival
+     */
+    ArrivalSchedule(ArrivalKind kind, double rate, double burstSize, uint64_t seed, int64_t startNs);
+
+    /**
+     * @brief Intended send time of the next message (non-decreasing)
+     */
+    int64_t next();
+
+    std::mt19937_64& rng() { return rng_; }
+
+private:
+    ArrivalKind kind_;
+    std::mt19937_64 rng_;
+    std::exponential_distribution<double> gapNs_;       ///< Gap between messages (Poisson) or bursts (bursty)
+    std::geometric_distribution<int64_t> extraInBurst_;  ///< Messages in a burst after the first
+    double nextNs_;
+    int64_t burstLeft_ = 0;
+};
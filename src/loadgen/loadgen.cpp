@@ -0,0 +1,421 @@
+/**
+ * @file loadgen.cpp
+ * @brief hft-loadgen: synthetic order flow against a gateway on loopback
+ *
+ * Opens HFT_LOADGEN_CONNECTIONS sessions with clientConnectThread (in
+ * batches, so thousands of connects do not need thousands of threads at
+ * once) and splits them over HFT_LOADGEN_THREADS workers. Each worker's
+ * sender follows an open-loop ArrivalSchedule and sends every message as a
+ * correlated frame whose correlation id is its intended send time; the
+ * gateway's ACK echoes the id, so the worker's receiver can measure latency
+ * from the intended time without keeping per-message state. A FIFO of
+ * actual send times per connection, keyed by the same id, gives the
+ * uncorrected (service) latency alongside, which shows how much the
+ * corrected figure owes to queuing.
+ *
+ * Each thread records into its own HdrHistograms (3 significant digits);
+ * they are merged for the report, which prints the corrected percentile
+ * spectrum and, with HFT_LOADGEN_SPECTRUM, writes .hgrm files.
+ *
+ * Architecture:
+ * - Main thread: connects, starts workers, prints the report
+ * - Sender thread per worker: waits for each intended time and sends
+ * - Receiver thread per worker: polls its connections and matches ACKs
+ */
+
+#include "load_profile.h"
+#include "../client/client.h"
+#include "../network/message.h"
+#include "../network/hdr_histogram.h"
+#include "../config/config.h"
+#include "../logging/logger.h"
+#include "../util/tsc_clock.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t CONNECT_BATCH = 256;       ///< clientConnectThread threads alive at once
+constexpr int CONNECT_TIMEOUT_SECONDS = 5;
+constexpr int64_t SPIN_NS = 50000;          ///< Senders sleep until this close to the intended time, then spin
+constexpr size_t MAX_PAYLOAD = 64 * 1024;   ///< Upper clamp of sampled sizes
+
+/**
+ * @struct SentRequest
+ * @brief A request awaiting its ACK
+ */
+struct SentRequest {
+    uint64_t intendedNs;  ///< Correlation id (the intended send time)
+    int64_t sentNs;       ///< Actual send time
+};
+
+/**
+ * @struct LoadConnection
+ * @brief One session against the gateway
+ */
+struct LoadConnection {
+    SocketPtr socket;
+    MessageBuffer buffer;                    ///< Receiver thread only
+    std::mutex mutex;                        ///< Guards sent
+    std::deque<SentRequest> sent;            ///< Unanswered requests in send order (non-decreasing ids)
+    std::atomic<bool> alive{false};
+};
+
+/**
+ * @struct WorkerLatency
+ * @brief Latencies of one worker; sendLag belongs to its sender, the rest to its receiver
+ */
+struct WorkerLatency {
+    HdrHistogram corrected;      ///< Intended send time to ACK (ns)
+    HdrHistogram uncorrected;    ///< Actual send time to ACK (ns)
+    HdrHistogram sendLag;        ///< Actual minus intended send time (ns)
+};
+
+/**
+ * @struct LoadResults
+ * @brief Totals shared by all workers
+ */
+struct LoadResults {
+    std::atomic<uint64_t> sent{0};
+    std::atomic<uint64_t> acked{0};
+    std::atomic<uint64_t> sendFailures{0};
+    std::atomic<uint64_t> payloadBytes{0};
+    std::atomic<uint64_t> disconnects{0};
+};
+
+SocketPtr makeSocket() {
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return nullptr;
+    }
+    return SocketPtr(new int(fd), [](int* s) {
+        if (s && *s >= 0) {
+            close(*s);
+        }
+        delete s;
+    });
+}
+
+/**
+ * @brief Raises the descriptor limit to its hard maximum for large connection counts
+ */
+void raiseDescriptorLimit() {
+    rlimit limit{};
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+/**
+ * @brief Connects every connection, CONNECT_BATCH at a time
+ *
+ * @return Number connected
+ */
+size_t connectAll(std::vector<std::unique_ptr<LoadConnection>>& connections, const std::string& target,
+                  uint16_t port) {
+    std::atomic<bool> running(true);
+    size_t connected = 0;
+    for (size_t batchStart = 0; batchStart < connections.size(); batchStart += CONNECT_BATCH) {
+        const size_t batchEnd = std::min(batchStart + CONNECT_BATCH, connections.size());
+        const size_t batchSize = batchEnd - batchStart;
+        std::vector<std::thread> threads;
+        std::unique_ptr<std::atomic<bool>[]> complete(new std::atomic<bool>[batchSize]);
+        std::unique_ptr<bool[]> success(new bool[batchSize]());
+        for (size_t i = 0; i < batchSize; ++i) {
+            complete[i] = false;
+            LoadConnection& conn = *connections[batchStart + i];
+            conn.socket = makeSocket();
+            threads.emplace_back(clientConnectThread, conn.socket, std::ref(running), std::ref(complete[i]),
+                                 std::ref(success[i]), target, CONNECT_TIMEOUT_SECONDS, port);
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        for (size_t i = 0; i < batchSize; ++i) {
+            if (success[i]) {
+                connections[batchStart + i]->alive = true;
+                ++connected;
+            }
+        }
+    }
+    return connected;
+}
+
+/**
+ * @brief Builds a printable payload of the given size ("ORDER <seq> xxx...")
+ */
+void fillPayload(std::string& payload, uint64_t sequence, size_t size) {
+    payload = "ORDER " + std::to_string(sequence) + " ";
+    payload.resize(size, 'x');
+}
+
+/**
+ * @brief Sends this worker's share of the schedule until endNs
+ */
+void senderThread(std::vector<LoadConnection*> connections, const LoadProfile& profile, double rate,
+                  uint64_t seed, int64_t startNs, int64_t recordFromNs, int64_t endNs,
+                  HdrHistogram& sendLag, LoadResults& results) {
+    ArrivalSchedule schedule(profile.arrivals, rate, profile.burstSize, seed, startNs);
+    std::string payload;
+    size_t next = 0;
+    uint64_t sequence = 0;
+
+    for (int64_t intendedNs = schedule.next(); intendedNs < endNs; intendedNs = schedule.next()) {
+        // Sleep most of the way, spin the rest; a late sender never skips ahead
+        int64_t nowNs = static_cast<int64_t>(steadyClockNs());
+        if (intendedNs - nowNs > SPIN_NS) {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(intendedNs - nowNs - SPIN_NS));
+        }
+        while ((nowNs = static_cast<int64_t>(steadyClockNs())) < intendedNs) {
+        }
+
+        // Round-robin over live connections
+        LoadConnection* conn = nullptr;
+        for (size_t tried = 0; tried < connections.size() && !conn; ++tried) {
+            LoadConnection* candidate = connections[next++ % connections.size()];
+            if (candidate->alive.load(std::memory_order_relaxed)) {
+                conn = candidate;
+            }
+        }
+        if (!conn) {
+            results.sendFailures.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        fillPayload(payload, ++sequence, profile.sizes.sample(schedule.rng(), MAX_PAYLOAD));
+        {
+            // Recorded before sending: the ACK may arrive before send() returns
+            std::lock_guard<std::mutex> lock(conn->mutex);
+            conn->sent.push_back({static_cast<uint64_t>(intendedNs), nowNs});
+        }
+        if (intendedNs >= recordFromNs) {
+            sendLag.record(nowNs - intendedNs);
+        }
+        if (sendFramedMessage(*conn->socket, payload, nullptr, profile.type, static_cast<uint64_t>(intendedNs))) {
+            results.sent.fetch_add(1, std::memory_order_relaxed);
+            results.payloadBytes.fetch_add(payload.size(), std::memory_order_relaxed);
+        } else {
+            std::lock_guard<std::mutex> lock(conn->mutex);
+            conn->sent.pop_back();
+            conn->alive = false;
+            results.sendFailures.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * @brief Matches ACKs on this worker's connections until stop is set
+ *
+ * Messages intended before recordFromNs (warmup) are counted but not recorded.
+ */
+void receiverThread(std::vector<LoadConnection*> connections, const std::atomic<bool>& stop,
+                    int64_t recordFromNs, WorkerLatency& latency, LoadResults& results) {
+    std::vector<pollfd> fds(connections.size());
+    std::string message;
+
+    while (!stop.load(std::memory_order_relaxed)) {
+        for (size_t i = 0; i < connections.size(); ++i) {
+            fds[i].fd = connections[i]->alive ? *connections[i]->socket : -1;
+            fds[i].events = POLLIN;
+            fds[i].revents = 0;
+        }
+        if (poll(fds.data(), fds.size(), 10) <= 0) {
+            continue;
+        }
+
+        for (size_t i = 0; i < connections.size(); ++i) {
+            if (!fds[i].revents) {
+                continue;
+            }
+            LoadConnection& conn = *connections[i];
+            bool received = false;
+            while (receiveFramedMessage(fds[i].fd, conn.buffer, message, nullptr, 0)) {
+                received = true;
+                const int64_t nowNs = static_cast<int64_t>(steadyClockNs());
+                const uint64_t intendedNs = conn.buffer.correlationId();
+                if (!intendedNs) {
+                    continue;  // Not an ACK (e.g. a throttle notice)
+                }
+                int64_t sentNs = 0;
+                {
+                    // Earlier ids were never answered (dropped or throttled); they must not shift later samples
+                    std::lock_guard<std::mutex> lock(conn.mutex);
+                    while (!conn.sent.empty() && conn.sent.front().intendedNs < intendedNs) {
+                        conn.sent.pop_front();
+                    }
+                    if (!conn.sent.empty() && conn.sent.front().intendedNs == intendedNs) {
+                        sentNs = conn.sent.front().sentNs;
+                        conn.sent.pop_front();
+                    }
+                }
+                if (static_cast<int64_t>(intendedNs) >= recordFromNs) {
+                    latency.corrected.record(nowNs - static_cast<int64_t>(intendedNs));
+                    if (sentNs) {
+                        latency.uncorrected.record(nowNs - sentNs);
+                    }
+                }
+                results.acked.fetch_add(1, std::memory_order_relaxed);
+            }
+            if (!received && socketPeerClosed(fds[i].fd)) {
+                conn.alive = false;
+                results.disconnects.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+}
+
+void printLatency(const char* label, const HdrHistogram& histogram) {
+    if (histogram.count() == 0) {
+        std::printf("  %-22s no samples\n", label);
+        return;
+    }
+    std::printf("  %-22s p50 %9.1f  p90 %9.1f  p99 %9.1f  p99.9 %9.1f  p99.99 %9.1f  max %9.1f us\n", label,
+                histogram.valueAtPercentile(50) / 1000.0, histogram.valueAtPercentile(90) / 1000.0,
+                histogram.valueAtPercentile(99) / 1000.0, histogram.valueAtPercentile(99.9) / 1000.0,
+                histogram.valueAtPercentile(99.99) / 1000.0, histogram.max() / 1000.0);
+}
+
+/**
+ * @brief Writes histogram's percentile spectrum (microseconds) to path
+ */
+bool writeSpectrum(const std::string& path, const HdrHistogram& histogram) {
+    std::ofstream file(path);
+    file << histogram.percentileSpectrum(1000.0);
+    return static_cast<bool>(file);
+}
+
+void printReport(const LoadProfile& profile, size_t connected, int64_t elapsedNs, const LoadResults& results,
+                 const WorkerLatency& latency) {
+    const uint64_t sent = results.sent.load();
+    const uint64_t acked = results.acked.load();
+    const double seconds = static_cast<double>(profile.durationMs) / 1000.0;
+
+    std::printf("\n[Load Generator Report]\n");
+    std::printf("========================================\n");
+    std::printf("Target:        %s:%u\n", profile.target.c_str(), static_cast<unsigned>(profile.port));
+    std::printf("Connections:   %zu of %zu connected, %llu dropped during the run\n", connected,
+                profile.connections, static_cast<unsigned long long>(results.disconnects.load()));
+    std::printf("Arrivals:      %s, %.0f msg/s offered", arrivalKindName(profile.arrivals), profile.rate);
+    if (profile.arrivals == ArrivalKind::Bursty) {
+        std::printf(" (mean burst %.0f)", profile.burstSize);
+    }
+    std::printf("\nSizes:         %s\n", profile.sizes.describe().c_str());
+    std::printf("Schedule:      %.1fs, %llu sent (%.0f msg/s, %.2f MB/s), %llu failed to send\n", seconds,
+                static_cast<unsigned long long>(sent), sent / seconds,
+                results.payloadBytes.load() / seconds / 1e6,
+                static_cast<unsigned long long>(results.sendFailures.load()));
+    std::printf("Responses:     %llu acked, %llu missing after %.1fs\n", static_cast<unsigned long long>(acked),
+                static_cast<unsigned long long>(sent > acked ? sent - acked : 0), elapsedNs / 1e9);
+    if (profile.warmupMs > 0) {
+        std::printf("Warmup:        first %.1fs not recorded\n", profile.warmupMs / 1000.0);
+    }
+    std::printf("Latency (from intended send time, coordinated omission corrected):\n");
+    printLatency("Corrected", latency.corrected);
+    printLatency("Uncorrected (service)", latency.uncorrected);
+    printLatency("Send lag", latency.sendLag);
+    if (latency.corrected.count() > 0) {
+        std::printf("p99.9 corrected: %.1fus over %llu responses%s\n", latency.corrected.valueAtPercentile(99.9) / 1000.0,
+                    static_cast<unsigned long long>(latency.corrected.count()),
+                    latency.corrected.count() < 1000 ? " (too few samples for p99.9)" : "");
+        std::printf("\nCorrected latency percentile spectrum (us):\n%s",
+                    latency.corrected.percentileSpectrum(1000.0, 1).c_str());
+    }
+    if (!profile.spectrumPrefix.empty()) {
+        const std::string correctedPath = profile.spectrumPrefix + "-corrected.hgrm";
+        const std::string uncorrectedPath = profile.spectrumPrefix + "-uncorrected.hgrm";
+        if (writeSpectrum(correctedPath, latency.corrected) && writeSpectrum(uncorrectedPath, latency.uncorrected)) {
+            std::printf("Spectra written to %s and %s\n", correctedPath.c_str(), uncorrectedPath.c_str());
+        } else {
+            std::printf("[Error] Cannot write spectra to %s-*.hgrm\n", profile.spectrumPrefix.c_str());
+        }
+    }
+    std::printf("========================================\n");
+}
+
+} // namespace
+
+int main() {
+    const LoadProfile profile = loadProfileFromEnvironment();
+    asyncLogger.setLevel(LogLevel::Warn);
+    asyncLogger.start(gatewayConfig().logFile);
+    raiseDescriptorLimit();
+
+    std::printf("Connecting %zu sessions to %s:%u...\n", profile.connections, profile.target.c_str(),
+                static_cast<unsigned>(profile.port));
+    std::vector<std::unique_ptr<LoadConnection>> connections;
+    for (size_t i = 0; i < profile.connections; ++i) {
+        connections.push_back(std::make_unique<LoadConnection>());
+    }
+    const size_t connected = connectAll(connections, profile.target, profile.port);
+    if (connected == 0) {
+        std::printf("[Error] No connection to %s:%u; is the gateway server running (option 1)?\n",
+                    profile.target.c_str(), static_cast<unsigned>(profile.port));
+        asyncLogger.stop();
+        return 1;
+    }
+
+    // Worker i owns connections i, i + threads, ...
+    std::vector<std::vector<LoadConnection*>> shares(profile.threads);
+    for (size_t i = 0; i < connections.size(); ++i) {
+        shares[i % profile.threads].push_back(connections[i].get());
+    }
+
+    LoadResults results;
+    std::atomic<bool> stopReceivers(false);
+    const int64_t startNs = static_cast<int64_t>(steadyClockNs());
+    const int64_t recordFromNs = startNs + profile.warmupMs * 1000000;
+    const int64_t endNs = startNs + profile.durationMs * 1000000;
+    std::printf("Sending %s arrivals at %.0f msg/s for %.1fs...\n", arrivalKindName(profile.arrivals),
+                profile.rate, profile.durationMs / 1000.0);
+
+    std::vector<std::unique_ptr<WorkerLatency>> workers;
+    std::vector<std::thread> senders;
+    std::vector<std::thread> receivers;
+    for (size_t i = 0; i < profile.threads; ++i) {
+        WorkerLatency& latency = *workers.emplace_back(std::make_unique<WorkerLatency>());
+        // Superposed Poisson processes are Poisson at the summed rate
+        senders.emplace_back(senderThread, shares[i], std::cref(profile), profile.rate / profile.threads,
+                             profile.seed + i, startNs, recordFromNs, endNs, std::ref(latency.sendLag),
+                             std::ref(results));
+        receivers.emplace_back(receiverThread, shares[i], std::cref(stopReceivers), recordFromNs,
+                               std::ref(latency), std::ref(results));
+    }
+    for (auto& sender : senders) {
+        sender.join();
+    }
+
+    // Late responses still count; the drain ends early once everything is answered
+    const int64_t drainEndNs = static_cast<int64_t>(steadyClockNs()) + profile.drainMs * 1000000;
+    while (results.acked.load() < results.sent.load() && static_cast<int64_t>(steadyClockNs()) < drainEndNs) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    stopReceivers = true;
+    for (auto& receiver : receivers) {
+        receiver.join();
+    }
+
+    WorkerLatency total;
+    for (const auto& worker : workers) {
+        total.corrected.add(worker->corrected);
+        total.uncorrected.add(worker->uncorrected);
+        total.sendLag.add(worker->sendLag);
+    }
+    printReport(profile, connected, static_cast<int64_t>(steadyClockNs()) - startNs, results, total);
+    connections.clear();
+    asyncLogger.stop();
+    return 0;
+}
@@ -0,0 +1,265 @@
+#include "logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <ctime>
+#include <strings.h>
+
+AsyncLogger asyncLogger;
+
+namespace {
+
+/**
+ * @brief Marks the owning thread's ring orphaned when the thread exits
+ *
+ * The writer drains what is left and then forgets the ring.
+ */
+struct ThreadRingOwner {
+    std::shared_ptr<void> ring;
+    std::atomic<bool>* orphaned = nullptr;
+
+    ~ThreadRingOwner() {
+        if (orphaned) {
+            orphaned->store(true, std::memory_order_release);
+        }
+    }
+};
+
+thread_local ThreadRingOwner threadRingOwner;
+
+const char* levelName(LogLevel level) {
+    switch (level) {
+        case LogLevel::Debug: return "DEBUG";
+        case LogLevel::Info:  return "INFO ";
+        case LogLevel::Warn:  return "WARN ";
+        case LogLevel::Error: return "ERROR";
+    }
+    return "?????";
+}
+
+void appendArg(std::string& line, const LogRecord& record, size_t i) {
+    char scratch[32];
+    int length = 0;
+    const uint64_t value = record.values[i];
+    switch (record.types[i]) {
+        case LogArgType::Int:
+            length = std::snprintf(scratch, sizeof(scratch), "%lld", static_cast<long long>(value));
+            break;
+        case LogArgType::UInt:
+            length = std::snprintf(scratch, sizeof(scratch), "%llu", static_cast<unsigned long long>(value));
+            break;
+        case LogArgType::Double: {
+            double d;
+            std::memcpy(&d, &value, sizeof(d));
+            length = std::snprintf(scratch, sizeof(scratch), "%g", d);
+            break;
+        }
+        case LogArgType::Bool:
+            line += value ? "true" : "false";
+            return;
+        case LogArgType::Char:
+            line += static_cast<char>(value);
+            return;
+        case LogArgType::String:
+            line.append(record.text + (value >> 16), value & 0xFFFF);
+            return;
+        case LogArgType::Pointer:
+            length = std::snprintf(scratch, sizeof(scratch), "%p", reinterpret_cast<void*>(value));
+            break;
+    }
+    line.append(scratch, std::max(0, std::min(length, static_cast<int>(sizeof(scratch)) - 1)));
+}
+
+} // namespace
+
+LogLevel logLevelFromString(const std::string& name) {
+    if (strcasecmp(name.c_str(), "debug") == 0) {
+        return LogLevel::Debug;
+    }
+    if (strcasecmp(name.c_str(), "warn") == 0 || strcasecmp(name.c_str(), "warning") == 0) {
+        return LogLevel::Warn;
+    }
+    if (strcasecmp(name.c_str(), "error") == 0) {
+        return LogLevel::Error;
+    }
+    return LogLevel::Info;
+}
+
+AsyncLogger::~AsyncLogger() {
+    stop();
+}
+
+AsyncLogger::ThreadRing* AsyncLogger::registerThread() {
+    auto ring = std::make_shared<ThreadRing>();
+    {
+        std::lock_guard<std::mutex> lock(ringsMutex_);
+        ring->threadIndex = nextThreadIndex_++;
+        rings_.push_back(ring);
+    }
+    threadRingOwner.orphaned = &ring->orphaned;
+    threadRingOwner.ring = ring;
+    threadRing_ = ring.get();
+    return threadRing_;
+}
+
+uint64_t AsyncLogger::dropped() const {
+    std::lock_guard<std::mutex> lock(ringsMutex_);
+    uint64_t total = 0;
+    for (const auto& ring : rings_) {
+        total += ring->dropped.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+bool AsyncLogger::start(const std::string& path) {
+    if (running_) {
+        return true;
+    }
+
+    bool opened = true;
+    if (path == "-") {
+        file_ = stderr;
+    } else {
+        file_ = std::fopen(path.c_str(), "a");
+        if (!file_) {
+            std::fprintf(stderr, "Failed to open log file %s: %s\n", path.c_str(), strerror(errno));
+            file_ = stderr;
+            opened = false;
+        }
+    }
+
+    // Pair a TSC reading with wall-clock time once; records convert relative to it
+    tscTicksPerNs();
+    anchorTsc_ = readTsc();
+    anchorRealtimeNs_ = realtimeNs();
+
+    running_ = true;
+    thread_ = std::thread(&AsyncLogger::run, this);
+    return opened;
+}
+
+void AsyncLogger::stop() {
+    running_ = false;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    if (file_) {
+        std::fflush(file_);
+        if (file_ != stderr) {
+            std::fclose(file_);
+        }
+        file_ = nullptr;
+    }
+}
+
+void AsyncLogger::run() {
+    std::vector<LogRecord> batch;
+    std::string line;
+    batch.reserve(RING_RECORDS);
+    line.reserve(256);
+
+    while (running_) {
+        if (drain(batch, line) == 0) {
+            std::fflush(file_);
+            // 1ms idle sleep bounds log latency without spinning a core
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    drain(batch, line);
+    std::fflush(file_);
+}
+
+size_t AsyncLogger::drain(std::vector<LogRecord>& batch, std::string& line) {
+    std::vector<std::shared_ptr<ThreadRing>> rings;
+    {
+        std::lock_guard<std::mutex> lock(ringsMutex_);
+        rings = rings_;
+    }
+
+    // Copy out everything published so far, remembering each record's thread
+    batch.clear();
+    std::vector<uint32_t> threadIndexes;
+    uint64_t droppedTotal = 0;
+    bool anyOrphanDrained = false;
+    for (const auto& ring : rings) {
+        const bool orphaned = ring->orphaned.load(std::memory_order_acquire);
+        const uint64_t head = ring->head.load(std::memory_order_relaxed);
+        const uint64_t tail = ring->tail.load(std::memory_order_acquire);
+        for (uint64_t i = head; i != tail; ++i) {
+            batch.push_back(ring->records[i & (RING_RECORDS - 1)]);
+            threadIndexes.push_back(ring->threadIndex);
+        }
+        ring->head.store(tail, std::memory_order_release);
+        droppedTotal += ring->dropped.load(std::memory_order_relaxed);
+        anyOrphanDrained |= orphaned;
+    }
+
+    // Threads run concurrently; present one timeline
+    std::vector<size_t> order(batch.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&batch](size_t a, size_t b) {
+        return static_cast<int64_t>(batch[a].tsc - batch[b].tsc) < 0;
+    });
+
+    for (size_t i : order) {
+        line.clear();
+        format(batch[i], threadIndexes[i], line);
+        std::fwrite(line.data(), 1, line.size(), file_);
+    }
+
+    if (droppedTotal != droppedReported_) {
+        std::fprintf(file_, "[logger] %llu records dropped (ring full)\n",
+                     static_cast<unsigned long long>(droppedTotal - droppedReported_));
+        droppedReported_ = droppedTotal;
+    }
+
+    // Orphaned rings were drained above (their owners can no longer publish)
+    if (anyOrphanDrained) {
+        std::lock_guard<std::mutex> lock(ringsMutex_);
+        rings_.erase(
+            std::remove_if(rings_.begin(), rings_.end(),
+                [this](const std::shared_ptr<ThreadRing>& ring) {
+                    if (!ring->orphaned.load(std::memory_order_acquire) ||
+                        ring->head.load(std::memory_order_relaxed) != ring->tail.load(std::memory_order_acquire)) {
+                        return false;
+                    }
+                    droppedReported_ -= ring->dropped.load(std::memory_order_relaxed);
+                    return true;
+                }),
+            rings_.end());
+    }
+    return batch.size();
+}
+
+void AsyncLogger::format(const LogRecord& record, uint32_t threadIndex, std::string& line) const {
+    const int64_t ns = anchorRealtimeNs_ + tscToNs(static_cast<int64_t>(record.tsc - anchorTsc_));
+    const time_t seconds = static_cast<time_t>(ns / 1000000000LL);
+    tm local;
+    localtime_r(&seconds, &local);
+
+    char prefix[96];
+    const char* file = std::strrchr(record.site->file, '/');
+    file = file ? file + 1 : record.site->file;
+    const size_t dateLength = std::strftime(prefix, sizeof(prefix), "%Y-%m-%d %H:%M:%S", &local);
+    const int prefixLength = std::snprintf(prefix + dateLength, sizeof(prefix) - dateLength,
+                                           ".%06lld %s T%u %s:%d ",
+                                           static_cast<long long>((ns % 1000000000LL) / 1000),
+                                           levelName(record.site->level), threadIndex,
+                                           file, record.site->line);
+    line.append(prefix, dateLength + std::max(0, std::min(prefixLength,
+                                              static_cast<int>(sizeof(prefix) - dateLength) - 1)));
+
+    // Substitute "{}" placeholders in order
+    size_t arg = 0;
+    for (const char* p = record.site->format; *p; ++p) {
+        if (p[0] == '{' && p[1] == '}' && arg < record.argCount) {
+            appendArg(line, record, arg++);
+            ++p;
+        } else {
+            line += *p;
+        }
+    }
+    line += '\n';
+}
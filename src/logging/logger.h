@@ -0,0 +1,238 @@
+#pragma once
+
+/**
+ * @file logger.h
+ * @brief Asynchronous binary logger
+ *
+ * Hot threads never format or touch a stream. A LOG_* call copies a pointer
+ * to its static call-site descriptor (format string, level, file, line), a
+ * TSC timestamp and the raw argument values into a fixed-size record in a
+ * per-thread SPSC ring - tens of nanoseconds. A background thread drains all
+ * rings every millisecond, orders records by timestamp, substitutes "{}"
+ * placeholders and appends lines to the log file.
+ *
+ * When a thread's ring is full, records are dropped (never blocking) and the
+ * drop count is written to the log.
+ */
+
+#include "../util/tsc_clock.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+enum class LogLevel : uint8_t {
+    Debug,
+    Info,
+    Warn,
+    Error
+};
+
+/**
+ * @brief Parses "debug", "info", "warn" or "error" (defaults to Info)
+ */
+LogLevel logLevelFromString(const std::string& name);
+
+/**
+ * @struct LogSite
+ * @brief Static per-call-site data; records refer to it by address
+ */
+struct LogSite {
+    LogLevel level;
+    const char* format;     ///< "{}" marks each argument
+    const char* file;
+    int line;
+};
+
+enum class LogArgType : uint8_t {
+    Int,
+    UInt,
+    Double,
+    Bool,
+    Char,
+    String,     ///< Copied into LogRecord::text: value = offset << 16 | length
+    Pointer
+};
+
+/**
+ * @struct LogRecord
+ * @brief One log call: two cache lines, no heap
+ */
+struct LogRecord {
+    static constexpr size_t MAX_ARGS = 6;       ///< Extra arguments are ignored
+    static constexpr size_t TEXT_BYTES = 56;    ///< Shared by all string arguments (truncated)
+
+    const LogSite* site;
+    uint64_t tsc;
+    uint8_t argCount;
+    uint8_t textUsed;
+    LogArgType types[MAX_ARGS];
+    uint64_t values[MAX_ARGS];
+    char text[TEXT_BYTES];
+};
+
+static_assert(sizeof(LogRecord) == 128, "LogRecord should stay two cache lines");
+
+/**
+ * @class AsyncLogger
+ * @brief Per-thread record rings drained by a background formatter thread
+ *
+ * Records logged before start() wait in their rings (up to the ring size).
+ */
+class AsyncLogger {
+public:
+    static constexpr size_t RING_RECORDS = 512;  ///< Per thread (64KB)
+
+    ~AsyncLogger();
+
+    /**
+     * @brief Opens the log file (appending; "-" for stderr) and starts the writer thread
+     *
+     * Falls back to stderr if the file cannot be opened.
+     * @return false if the file could not be opened
+     */
+    bool start(const std::string& path);
+
+    /**
+     * @brief Writes everything logged so far, stops the writer and closes the file
+     */
+    void stop();
+
+    void setLevel(LogLevel level) { level_.store(level, std::memory_order_relaxed); }
+
+    bool enabled(LogLevel level) const {
+        return level >= level_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Records one call (use the LOG_* macros)
+     */
+    template<typename... Args>
+    void log(const LogSite& site, const Args&... args) {
+        ThreadRing* ring = threadRing_ ? threadRing_ : registerThread();
+        const uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        if (tail - ring->cachedHead >= RING_RECORDS) {
+            ring->cachedHead = ring->head.load(std::memory_order_acquire);
+            if (tail - ring->cachedHead >= RING_RECORDS) {
+                ring->dropped.store(ring->dropped.load(std::memory_order_relaxed) + 1,
+                                    std::memory_order_relaxed);
+                return;
+            }
+        }
+
+        LogRecord& record = ring->records[tail & (RING_RECORDS - 1)];
+        record.site = &site;
+        record.tsc = readTsc();
+        record.argCount = 0;
+        record.textUsed = 0;
+        (encode(record, args), ...);
+        ring->tail.store(tail + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Records dropped because a ring was full
+     */
+    uint64_t dropped() const;
+
+private:
+    struct ThreadRing {
+        alignas(64) std::atomic<uint64_t> head{0};  ///< Next record to read (writer thread)
+        alignas(64) std::atomic<uint64_t> tail{0};  ///< Next record to write (owning thread)
+        uint64_t cachedHead = 0;                    ///< Owner's last view of head
+        std::atomic<uint64_t> dropped{0};           ///< Written by owner only
+        std::atomic<bool> orphaned{false};          ///< Owner thread exited
+        uint32_t threadIndex = 0;                   ///< Registration order, shown as T<n>
+        LogRecord records[RING_RECORDS];
+    };
+
+    inline static thread_local ThreadRing* threadRing_ = nullptr;
+
+    std::vector<std::shared_ptr<ThreadRing>> rings_;    ///< Every registered thread
+    mutable std::mutex ringsMutex_;                     ///< Guards rings_
+    uint32_t nextThreadIndex_ = 1;
+    std::atomic<LogLevel> level_{LogLevel::Info};
+
+    FILE* file_ = nullptr;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    uint64_t anchorTsc_ = 0;        ///< TSC at start()
+    int64_t anchorRealtimeNs_ = 0;  ///< CLOCK_REALTIME at start()
+    uint64_t droppedReported_ = 0;  ///< Writer thread only
+
+    ThreadRing* registerThread();
+    void run();
+    size_t drain(std::vector<LogRecord>& batch, std::string& line);
+    void format(const LogRecord& record, uint32_t threadIndex, std::string& line) const;
+
+    template<typename T>
+    static void encode(LogRecord& record, const T& value) {
+        if (record.argCount >= LogRecord::MAX_ARGS) {
+            return;
+        }
+        using D = std::decay_t<T>;
+        const size_t i = record.argCount++;
+        if constexpr (std::is_same_v<D, bool>) {
+            record.types[i] = LogArgType::Bool;
+            record.values[i] = value ? 1 : 0;
+        } else if constexpr (std::is_same_v<D, char>) {
+            record.types[i] = LogArgType::Char;
+            record.values[i] = static_cast<unsigned char>(value);
+        } else if constexpr (std::is_enum_v<D>) {
+            record.types[i] = LogArgType::Int;
+            record.values[i] = static_cast<uint64_t>(static_cast<int64_t>(value));
+        } else if constexpr (std::is_integral_v<D> && std::is_signed_v<D>) {
+            record.types[i] = LogArgType::Int;
+            record.values[i] = static_cast<uint64_t>(static_cast<int64_t>(value));
+        } else if constexpr (std::is_integral_v<D>) {
+            record.types[i] = LogArgType::UInt;
+            record.values[i] = static_cast<uint64_t>(value);
+        } else if constexpr (std::is_floating_point_v<D>) {
+            const double d = static_cast<double>(value);
+            record.types[i] = LogArgType::Double;
+            std::memcpy(&record.values[i], &d, sizeof(d));
+        } else if constexpr (std::is_same_v<D, const char*> || std::is_same_v<D, char*>) {
+            encodeText(record, i, value ? std::string_view(value) : std::string_view("(null)"));
+        } else if constexpr (std::is_convertible_v<const D&, std::string_view>) {
+            encodeText(record, i, std::string_view(value));
+        } else if constexpr (std::is_pointer_v<D>) {
+            record.types[i] = LogArgType::Pointer;
+            record.values[i] = reinterpret_cast<uintptr_t>(value);
+        } else {
+            static_assert(std::is_pointer_v<D>, "unsupported log argument type");
+        }
+    }
+
+    static void encodeText(LogRecord& record, size_t i, std::string_view text) {
+        const size_t length = std::min(text.size(), LogRecord::TEXT_BYTES - record.textUsed);
+        std::memcpy(record.text + record.textUsed, text.data(), length);
+        record.types[i] = LogArgType::String;
+        record.values[i] = (static_cast<uint64_t>(record.textUsed) << 16) | length;
+        record.textUsed = static_cast<uint8_t>(record.textUsed + length);
+    }
+};
+
+/**
+ * @brief Global logger - started and stopped by main
+ */
+extern AsyncLogger asyncLogger;
+
+#define HFT_LOG(level, fmt, ...)                                                    \
+    do {                                                                            \
+        static const LogSite hftLogSite_{level, fmt, __FILE__, __LINE__};           \
+        if (asyncLogger.enabled(level)) {                                           \
+            asyncLogger.log(hftLogSite_, ##__VA_ARGS__);                            \
+        }                                                                           \
+    } while (0)
+
+#define LOG_DEBUG(fmt, ...) HFT_LOG(LogLevel::Debug, fmt, ##__VA_ARGS__)
+#define LOG_INFO(fmt, ...)  HFT_LOG(LogLevel::Info, fmt, ##__VA_ARGS__)
+#define LOG_WARN(fmt, ...)  HFT_LOG(LogLevel::Warn, fmt, ##__VA_ARGS__)
+#define LOG_ERROR(fmt, ...) HFT_LOG(LogLevel::Error, fmt, ##__VA_ARGS__)
@@ -4,18 +4,40 @@
  * 
  * Architecture:
  * - Main thread: Menu loop, message display, connection management
- * - Server accept thread: Accepts new client connections
+ * - Server accept threads: One per HFT_LISTENERS entry (TCP and Unix domain)
  * - Server receive threads: One per client, receives messages
  * - Client connect thread: Handles non-blocking connection attempts
  * - Client receive threads: One per connection, receives messages
+ * - Connection pool thread (option 11): One event loop running every pooled
+ *   upstream connection's connect, receive and send coroutines
+ * - Event loop threads (HFT_COROUTINES): Run session, connect and receive
+ *   coroutines in place of the per-connection threads above; listeners
+ *   with loops=N get their own
+ * - Market data receive thread: Joins multicast feed, recovers gaps over TCP
+ * - Log writer thread: Formats records queued by the other threads into the log file
+ * - Admin thread: Serves metrics scrapes on the local admin socket
+ * - Idle reaper thread (HFT_IDLE_TIMEOUT_MS): Shuts down sessions that went quiet
+ * 
+ * Hot restart: while the server runs, the main loop also polls the handoff
+ * socket; a successor started with HFT_TAKEOVER=1 receives the listeners
+ * (and, with HFT_HANDOFF_SESSIONS, live sessions) and this process exits.
  */
 
 #include "network/socket_utils.h"
 #include "network/message.h"
 #include "network/connection.h"
+#include "network/multicast.h"
+#include "network/subscriptions.h"
+#include "network/idle_reaper.h"
 #include "server/server.h"
+#include "server/handoff.h"
 #include "client/client.h"
+#include "client/connection_pool.h"
 #include "ui/ui.h"
+#include "config/config.h"
+#include "logging/logger.h"
+#include "metrics/metrics.h"
+#include "metrics/admin_server.h"
 #include <iostream>
 #include <thread>
 #include <atomic>
@@ -29,15 +51,36 @@
 #include <chrono>
 
 int main() {
+    // Diagnostics go to the async log; the console is reserved for the UI
+    asyncLogger.setLevel(logLevelFromString(gatewayConfig().logLevel));
+    if (!asyncLogger.start(gatewayConfig().logFile)) {
+        std::cout << "[Error] Cannot open log file " << gatewayConfig().logFile << "; logging to stderr.\n";
+    }
+    LOG_INFO("Gateway starting");
+    
+    // Idle sessions are reaped from one timer thread instead of per-connection polling
+    if (gatewayConfig().idleTimeoutMs > 0) {
+        idleReaper.start(gatewayConfig().idleTimeoutMs * 1000000);
+    }
+    
+    // Coroutine mode: sessions share a few event loop threads
+    if (gatewayConfig().coroutines) {
+        if (eventLoops.start(gatewayConfig().eventLoopThreads)) {
+            LOG_INFO("Running sessions on {} event loop threads", eventLoops.size());
+        } else {
+            std::cout << "[Error] Cannot start event loops; using one thread per connection.\n";
+        }
+    }
+    
     // ========================================================================
     // Server State
     // ========================================================================
-    SocketPtr serverSocket = nullptr;  ///< Server listening socket
+    ListenerSet serverListeners;  ///< Listening sockets and their accept threads (HFT_LISTENERS)
     
-    std::thread serverAcceptThreadHandle;  ///< Thread handle for accept thread
     std::thread clientConnectThreadHandle;  ///< Thread handle for connect thread
+    std::thread serverDrainThreadHandle;    ///< Thread handle for the last option 5 drain
+    HandoffListener handoffListener;        ///< Hot restart rendezvous while the server runs
     
-    std::atomic<bool> serverAcceptRunning(false);  ///< Control flag for accept thread
     std::atomic<bool> clientConnectRunning(false);  ///< Control flag for connect thread
     std::atomic<bool> connectComplete(false);       ///< Flag indicating connect attempt finished
     std::atomic<int> nextClientId(1);                ///< Counter for server client IDs
@@ -51,11 +94,21 @@ int main() {
     // ========================================================================
     std::vector<ClientConnectionPtr> clientConnections;  ///< Active client connections
     std::mutex clientConnectionsMutex;                   ///< Mutex for clientConnections vector
+    auto clientSlab = std::make_shared<ConnectionSlab>();  ///< Storage for client connections (created on the main thread)
     
     SocketPtr pendingClientSocket = nullptr;  ///< Socket for pending connection attempt
     bool pendingConnectSuccess = false;       ///< Result of pending connection
     int pendingConnectionId = 0;              ///< ID for pending connection
     
+    ConnectionPool connectionPool;            ///< Load-balanced upstream connections (options 11-12)
+    
+    // ========================================================================
+    // Market Data State
+    // ========================================================================
+    std::shared_ptr<MulticastPublisher> marketDataPublisher;  ///< Multicast publisher (created on first publish)
+    std::thread marketDataThreadHandle;                       ///< Thread handle for multicast receiver
+    std::atomic<bool> marketDataRunning(false);               ///< Control flag for multicast receiver
+    
     // ========================================================================
     // UI State
     // ========================================================================
@@ -66,12 +119,102 @@ int main() {
     // ========================================================================
     // Message History
     // ========================================================================
-    std::vector<std::string> messageHistory;  ///< History of received messages
-    std::mutex messageHistoryMutex;           ///< Mutex for messageHistory
-    const size_t MAX_HISTORY_SIZE = 1000;     ///< Maximum history entries
+    MessageHistory messageHistory(gatewayConfig().historyCapacity,
+                                  gatewayConfig().historyFile);  ///< Bounded ring of received messages
+
+    // ========================================================================
+    // Metrics
+    // ========================================================================
+    metrics.addGauge("queue_depth", "Received messages waiting for the main thread",
+                     [] { return static_cast<double>(receivedMessages.size()); });
+    metrics.addGauge("subscriptions", "Session symbol subscriptions",
+                     [] { return static_cast<double>(subscriptions.subscriptionCount()); });
+    metrics.addCollector([&](std::string& out) {
+        appendMetricHeader(out, "hft_log_records_dropped_total", "Log records dropped (ring full)", "counter");
+        appendMetric(out, "hft_log_records_dropped_total", "", static_cast<double>(asyncLogger.dropped()));
+        
+        std::vector<std::pair<std::string, const ConnectionMetrics*>> connections;
+        std::vector<ClientConnectionPtr> held;  // Keeps connections alive while rendering
+        const std::vector<ListenerConfig>& listenerTable = gatewayConfig().listeners;
+        std::vector<size_t> listenerSessions(listenerTable.size());
+        {
+            std::lock_guard<std::mutex> lock(serverClientsMutex);
+            for (const auto& conn : serverClients) {
+                if (conn->listener < listenerSessions.size()) {
+                    ++listenerSessions[conn->listener];
+                }
+                held.push_back(conn);
+                connections.emplace_back("role=\"session\",id=\"" + std::to_string(conn->id) + "\"", &conn->traffic);
+            }
+        }
+        const size_t sessions = connections.size();
+        {
+            std::lock_guard<std::mutex> lock(clientConnectionsMutex);
+            for (const auto& conn : clientConnections) {
+                held.push_back(conn);
+                connections.emplace_back("role=\"client\",id=\"" + std::to_string(conn->id) + "\"", &conn->traffic);
+            }
+        }
+        appendMetricHeader(out, "hft_connections", "Open connections", "gauge");
+        appendMetric(out, "hft_connections", "role=\"session\"", static_cast<double>(sessions));
+        appendMetric(out, "hft_connections", "role=\"client\"", static_cast<double>(connections.size() - sessions));
+        appendMetricHeader(out, "hft_listener_sessions", "Server sessions per listener", "gauge");
+        for (size_t i = 0; i < listenerTable.size(); ++i) {
+            appendMetric(out, "hft_listener_sessions", "listener=\"" + listenerTable[i].name + "\"",
+                         static_cast<double>(listenerSessions[i]));
+        }
+        
+        const std::vector<PoolMemberPtr> poolMembers = connectionPool.members();
+        appendMetricHeader(out, "hft_pool_member_up", "Pool member connected and taking sends", "gauge");
+        for (const auto& member : poolMembers) {
+            appendMetric(out, "hft_pool_member_up", "id=\"" + std::to_string(member->id) + "\",target=\"" +
+                         member->target.name + "\"", member->state() == PoolMemberState::Healthy ? 1 : 0);
+        }
+        appendMetricHeader(out, "hft_pool_outstanding_bytes", "Bytes queued or unacknowledged per pool member", "gauge");
+        for (const auto& member : poolMembers) {
+            appendMetric(out, "hft_pool_outstanding_bytes", "id=\"" + std::to_string(member->id) + "\"",
+                         static_cast<double>(member->outstandingBytes()));
+        }
+        appendMetricHeader(out, "hft_pool_failures_total", "Failed connects and dropped connections per pool member", "counter");
+        for (const auto& member : poolMembers) {
+            appendMetric(out, "hft_pool_failures_total", "id=\"" + std::to_string(member->id) + "\"",
+                         static_cast<double>(member->failures.load(std::memory_order_relaxed)));
+        }
+        for (const auto& member : poolMembers) {
+            connections.emplace_back("role=\"pool\",id=\"" + std::to_string(member->id) + "\"", &member->traffic);
+        }
+        appendMetricHeader(out, "hft_request_rtt_seconds", "Correlated request round trip per message type", "summary");
+        for (int type = 0; type < 256; ++type) {
+            const LatencyHistogram* rtt = requestRtt.find(static_cast<uint8_t>(type));
+            if (!rtt || rtt->count() == 0) {
+                continue;
+            }
+            const std::string typeLabel = "type=\"" + std::to_string(type) + "\"";
+            const std::pair<const char*, double> quantiles[] = {{"0.5", 50}, {"0.99", 99}, {"0.999", 99.9}};
+            for (const auto& [quantile, percentile] : quantiles) {
+                appendMetric(out, "hft_request_rtt_seconds", typeLabel + ",quantile=\"" + quantile + "\"",
+                             rtt->percentile(percentile) / 1e9);
+            }
+            appendMetric(out, "hft_request_rtt_seconds_sum", typeLabel, static_cast<double>(rtt->sum()) / 1e9);
+            appendMetric(out, "hft_request_rtt_seconds_count", typeLabel, static_cast<double>(rtt->count()));
+        }
+        appendConnectionMetrics(out, connections);
+    });
+    
+    AdminServer adminServer;  ///< Metrics scrapes (HFT_ADMIN_SOCKET / HFT_ADMIN_PORT)
+    auto startAdmin = [&adminServer]() {
+        if ((!gatewayConfig().adminSocket.empty() || gatewayConfig().adminPort > 0) &&
+            !adminServer.start(gatewayConfig().adminSocket, gatewayConfig().adminPort)) {
+            std::cout << "[Error] Admin endpoint could not be opened; metrics unavailable.\n";
+        }
+    };
+    // A successor's admin endpoint opens at takeover, once the running gateway has released it
+    if (!gatewayConfig().takeover) {
+        startAdmin();
+    }
 
     // Display initial menu
-    displayMenu(serverSocket, serverClients, clientConnections);
+    displayMenu(!serverListeners.empty(), serverClients, clientConnections, connectionPool);
     menuDisplayed = true;
 
     // ========================================================================
@@ -81,19 +224,60 @@ int main() {
         // Check for received messages and display them (non-blocking)
         // Messages are pushed by receive threads and consumed here
         std::string source, message;
-        while (receivedMessages.pop(source, message)) {
+        int session;
+        int64_t receivedNs;
+        while (receivedMessages.pop(source, message, session, receivedNs)) {
             std::cout << "\n" << message << std::endl;
             
-            // Store message in history for later viewing
+            // Store message in history for later viewing (O(1), oldest overwritten)
+            messageHistory.append(receivedNs, source, session, message);
+        }
+        
+        // Hot restart: a successor started with HFT_TAKEOVER asked for the listeners
+        if (SocketPtr successor = serverListeners.empty() ? nullptr : handoffListener.acceptSuccessor()) {
+            // Listeners stay open throughout: new connects wait in the backlog for the successor
+            serverListeners.stopAccepting();
+            std::vector<ClientConnectionPtr> remaining;
             {
-                std::lock_guard<std::mutex> lock(messageHistoryMutex);
-                messageHistory.push_back(message);
+                std::lock_guard<std::mutex> lock(serverClientsMutex);
+                remaining.swap(serverClients);
+            }
+            
+            HandoffState state;
+            state.listeners = serverListeners.sockets();
+            state.nextClientId = nextClientId;
+            if (gatewayConfig().handoffSessions) {
+                state.sessions = detachSessions(remaining);
+            }
+            // Free the rendezvous and admin paths for the successor before it can bind its own
+            handoffListener.stop();
+            adminServer.stop();
+            
+            if (sendHandoff(*successor, state)) {
+                const size_t handedOff = state.sessions.size();
+                releaseHandoff(state);
+                serverListeners.close();
                 
-                // Limit history size to prevent unbounded growth
-                if (messageHistory.size() > MAX_HISTORY_SIZE) {
-                    messageHistory.erase(messageHistory.begin());
-                }
+                // Sessions that stayed here (all of them without HFT_HANDOFF_SESSIONS) reconnect to the successor
+                const DrainReport report = drainSessions(std::move(remaining),
+                                                         gatewayConfig().drainTimeoutMs * 1000000);
+                std::cout << "\n[Info] Hot restart: handed the listeners and " << handedOff
+                          << " session(s) to the new gateway, logged out " << report.loggedOut
+                          << ". Exiting.\n";
+                break;
             }
+            
+            // The successor gave up: carry on serving as before
+            std::vector<ClientConnectionPtr> resumed = adoptSessions(state.sessions, serverListeners);
+            remaining.insert(remaining.end(), resumed.begin(), resumed.end());
+            {
+                std::lock_guard<std::mutex> lock(serverClientsMutex);
+                serverClients.swap(remaining);
+            }
+            serverListeners.startAccepting(serverClients, serverClientsMutex, nextClientId);
+            handoffListener.start(gatewayConfig().handoffSocket);
+            startAdmin();
+            std::cout << "\n[Error] Hot restart failed; this gateway keeps serving.\n";
         }
         
         // Clean up disconnected server clients
@@ -124,7 +308,7 @@ int main() {
         if (hasInput()) {
             // Display menu if not already displayed
             if (!menuDisplayed) {
-                displayMenu(serverSocket, serverClients, clientConnections);
+                displayMenu(!serverListeners.empty(), serverClients, clientConnections, connectionPool);
                 menuDisplayed = true;
             }
             
@@ -138,32 +322,56 @@ int main() {
             }
             
             menuDisplayed = false;
-            choice = input[0] - '0';  // Parse first character as menu choice
+            // Parse leading number as menu choice (options go past 9)
+            try {
+                choice = std::stoi(input);
+            } catch (...) {
+                choice = 0;
+            }
             
             // Process menu selection
             switch (choice) {
                 case 1: {
                     // Option 1: Create server socket
-                    if (serverSocket) {
+                    if (!serverListeners.empty()) {
                         std::cout << "\n[Error] Server already running. Stop it first (option 5).\n";
                         break;
                     }
                     std::cout << "\n[Action] Creating server socket and waiting for clients...\n";
                     
-                    // Create and configure server socket (listening on port 8080)
-                    serverSocket = startServer();
-                    if (serverSocket) {
-                        // Start accept thread for handling multiple client connections
-                        serverAcceptRunning = true;
-                        nextClientId = 1;  // Reset client ID counter
-                        serverAcceptThreadHandle = std::thread(serverAcceptThread,
-                                                               serverSocket,
-                                                               std::ref(serverAcceptRunning),
-                                                               std::ref(serverClients),
-                                                               std::ref(serverClientsMutex),
-                                                               std::ref(nextClientId),
-                                                               1000); // Maximum 1000 concurrent connections
-                        std::cout << "[Success] Server socket created! Waiting for client connections...\n";
+                    // Hot restart: inherit the running gateway's listeners instead of binding
+                    HandoffState inherited;
+                    const bool tookOver = gatewayConfig().takeover && !gatewayConfig().handoffSocket.empty() &&
+                                          receiveHandoff(gatewayConfig().handoffSocket, inherited);
+                    nextClientId = tookOver ? inherited.nextClientId : 1;  // Reset client ID counter
+                    if (gatewayConfig().takeover) {
+                        startAdmin();  // No-op once open
+                    }
+                    
+                    // One listening socket per HFT_LISTENERS entry (default: TCP 8080 and the Unix socket)
+                    if (serverListeners.open(gatewayConfig().listeners, std::move(inherited.listeners))) {
+                        // Inherited sessions resume before new connections are accepted
+                        std::vector<ClientConnectionPtr> adopted = adoptSessions(inherited.sessions, serverListeners);
+                        {
+                            std::lock_guard<std::mutex> lock(serverClientsMutex);
+                            serverClients.insert(serverClients.end(), adopted.begin(), adopted.end());
+                        }
+                        serverListeners.startAccepting(serverClients, serverClientsMutex, nextClientId);
+                        
+                        if (!gatewayConfig().handoffSocket.empty()) {
+                            handoffListener.start(gatewayConfig().handoffSocket);
+                        }
+                        for (const auto& listener : serverListeners.listeners()) {
+                            std::cout << "[Info] Listener " << listener.config.name << " on "
+                                      << listenerAddress(listener.config) << " (max "
+                                      << listener.config.maxConnections << " sessions)\n";
+                        }
+                        if (tookOver) {
+                            std::cout << "[Success] Took over the running gateway's listeners and "
+                                      << adopted.size() << " session(s).\n";
+                        } else {
+                            std::cout << "[Success] Server socket created! Waiting for client connections...\n";
+                        }
                     } else {
                         std::cout << "[Error] Failed to create server socket.\n";
                     }
@@ -172,6 +380,20 @@ int main() {
                 
                 case 2: {
                     // Option 2: Connect to server
+                    if (gatewayConfig().shmTransport) {
+                        // The gateway attaches shared memory only for local Unix domain sessions
+                        std::cout << "\n[Action] Connecting to server (" << DEFAULT_UNIX_SOCKET_PATH << ")...\n";
+                        SocketPtr unixSocket = startUnixClient();
+                        if (!unixSocket || !makeNonBlocking(*unixSocket)) {
+                            std::cout << "[Error] Failed to connect to the gateway's Unix socket.\n";
+                            break;
+                        }
+                        pendingClientSocket = unixSocket;
+                        pendingConnectSuccess = true;
+                        pendingConnectionId = nextClientConnectionId++;
+                        connectComplete = true;  // Local connect completes at once
+                        break;
+                    }
                     std::cout << "\n[Action] Connecting to server (127.0.0.1:8080)...\n";
                     
                     // Create client socket
@@ -198,12 +420,19 @@ int main() {
                     pendingClientSocket = tempSocket;
                     pendingConnectSuccess = false;
                     pendingConnectionId = connectionId;
-                    clientConnectThreadHandle = std::thread(clientConnectThread,
-                                                           tempSocket,
-                                                           std::ref(clientConnectRunning),
-                                                           std::ref(connectComplete),
-                                                           std::ref(pendingConnectSuccess),
-                                                           "127.0.0.1", 5);  // 5 second timeout
+                    if (eventLoops.running()) {
+                        EventLoop& loop = eventLoops.next();
+                        loop.spawn(clientConnectTask(loop, tempSocket, clientConnectRunning,
+                                                     connectComplete, pendingConnectSuccess,
+                                                     "127.0.0.1", 5));  // 5 second timeout
+                    } else {
+                        clientConnectThreadHandle = std::thread(clientConnectThread,
+                                                               tempSocket,
+                                                               std::ref(clientConnectRunning),
+                                                               std::ref(connectComplete),
+                                                               std::ref(pendingConnectSuccess),
+                                                               "127.0.0.1", 5, 8080);  // 5 second timeout
+                    }
                     
                     std::cout << "[Info] Connection attempt " << connectionId << " in progress...\n";
                     break;
@@ -217,8 +446,11 @@ int main() {
                         break;
                     }
                     
-                    // Prompt for message
-                    std::cout << "\n[Action] Enter message to send from server to client: ";
+                    // Prompt for symbol (routes to its subscribers) and message
+                    std::cout << "\n[Action] Enter symbol (blank to send to all clients): ";
+                    std::string symbol;
+                    std::getline(std::cin, symbol);
+                    std::cout << "[Action] Enter message to send from server to client: ";
                     std::string message;
                     std::getline(std::cin, message);
                     if (message.empty()) {
@@ -226,12 +458,18 @@ int main() {
                         break;
                     }
                     
+                    if (!symbol.empty()) {
+                        const size_t sent = subscriptions.publish(symbol, message);
+                        std::cout << "[Success] " << symbol << " update sent to " << sent << " subscriber(s).\n";
+                        break;
+                    }
+                    
                     // Send message to all connected clients
                     bool anySent = false;
+                    auto msgPtr = std::make_shared<const std::string>(message);
                     for (auto& client : serverClients) {
                         if (client->connected && client->socket) {
-                            auto msgPtr = std::make_shared<std::string>(message);
-                            if (sendToClient(client->socket, msgPtr)) {
+                            if (sendToConnection(client, msgPtr)) {
                                 anySent = true;
                             }
                         }
@@ -299,8 +537,45 @@ int main() {
                         std::cout << "[Error] Message cannot be empty.\n";
                         break;
                     }
-                    auto msgPtr = std::make_shared<std::string>(message);
-                    if (sendToServer(selectedClient->socket, msgPtr)) {
+                    if (selectedClient->requests && !selectedClient->shmAttached) {
+                        // HFT_REQUEST_TIMEOUT_MS: send as a correlated request and time the round trip
+                        std::cout << "Message type (0-255) [0]: ";
+                        std::string typeStr;
+                        std::getline(std::cin, typeStr);
+                        int type = 0;
+                        try {
+                            type = typeStr.empty() ? 0 : std::stoi(typeStr);
+                        } catch (...) {
+                            type = -1;
+                        }
+                        if (type < 0 || type > 255) {
+                            std::cout << "[Error] Invalid message type.\n";
+                            break;
+                        }
+                        const int connectionId = selectedClient->id;
+                        const uint64_t requestId = sendRequest(selectedClient, message, static_cast<uint8_t>(type),
+                            [connectionId](const CorrelatedResponse& response) {
+                                const std::string request = "[CLIENT] request " + std::to_string(response.correlationId) +
+                                                            " (type " + std::to_string(response.type) + ")";
+                                if (response.ok) {
+                                    receivedMessages.push("Client", request + " answered in " +
+                                                          std::to_string(response.rttNs / 1000) + "us [\"" +
+                                                          response.payload + "\"]", connectionId);
+                                } else {
+                                    receivedMessages.push("System", request + " got no response", connectionId);
+                                }
+                            });
+                        if (requestId) {
+                            std::cout << "[Success] Request " << requestId << " sent from client " << selectedClient->id << ".\n";
+                        } else {
+                            std::cout << "[Error] Failed to send request from client " << selectedClient->id << ".\n";
+                            selectedClient->connected = false;
+                        }
+                        break;
+                    }
+                    
+                    auto msgPtr = std::make_shared<const std::string>(message);
+                    if (sendToConnection(selectedClient, msgPtr)) {
                         std::cout << "[Success] Message sent successfully from client " << selectedClient->id << "!\n";
                     } else {
                         std::cout << "[Error] Failed to send message from client " << selectedClient->id << ".\n";
@@ -311,45 +586,34 @@ int main() {
                 
                 case 5: {
                     // Option 5: Stop server connection
-                    if (!serverSocket) {
+                    if (serverListeners.empty()) {
                         std::cout << "\n[Error] No server connection to stop.\n";
                         break;
                     }
                     
-                    // Stop accept thread by setting flag and closing socket
-                    serverAcceptRunning = false;
-                    if (serverSocket) {
-                        close(*serverSocket); // Close socket to break accept() call
-                    }
+                    // Stop accepting (threads see the flag within their 1ms poll) and release
+                    // the listening sockets now so a new server can bind right away
+                    serverListeners.close();
+                    handoffListener.stop();
                     
-                    // Stop all client receive threads
+                    // Take the sessions out under the lock; drain them without it
+                    std::vector<ClientConnectionPtr> draining;
                     {
                         std::lock_guard<std::mutex> lock(serverClientsMutex);
-                        for (auto& client : serverClients) {
-                            client->running = false;
-                            client->connected = false;
-                        }
+                        draining.swap(serverClients);
                     }
+                    const size_t drainCount = draining.size();
                     
-                    // Wait for accept thread to finish
-                    if (serverAcceptThreadHandle.joinable()) {
-                        serverAcceptThreadHandle.join();
+                    // Flush, log out and close in the background; the report arrives as a message
+                    if (serverDrainThreadHandle.joinable()) {
+                        serverDrainThreadHandle.join();
                     }
-                    
-                    // Wait for all client receive threads to finish
-                    {
-                        std::lock_guard<std::mutex> lock(serverClientsMutex);
-                        for (auto& client : serverClients) {
-                            if (client->receiveThread.joinable()) {
-                                client->receiveThread.join();
-                            }
-                        }
-                        serverClients.clear();  // Clear clients vector
-                    }
-                    
-                    // Release server socket
-                    serverSocket.reset();
-                    std::cout << "\n[Success] Server connection stopped.\n";
+                    serverDrainThreadHandle = std::thread([sessions = std::move(draining)]() mutable {
+                        const DrainReport report = drainSessions(std::move(sessions),
+                                                                 gatewayConfig().drainTimeoutMs * 1000000);
+                        receivedMessages.push("System", formatDrainReport(report));
+                    });
+                    std::cout << "\n[Success] Server stopped accepting; draining " << drainCount << " session(s).\n";
                     break;
                 }
                 
@@ -413,7 +677,9 @@ int main() {
                         conn->running = false;
                         conn->connected = false;
                         if (conn->socket) {
-                            close(*conn->socket);
+                            // shutdown, not close: wakes the receiver and keeps the fd
+                            // number reserved until its last owner lets go
+                            shutdown(*conn->socket, SHUT_RDWR);
                         }
                     }
                     
@@ -455,26 +721,120 @@ int main() {
                 }
                 
                 case 7: {
-                    // Option 7: View received messages history
-                    std::cout << "\n[Received Messages]\n";
-                    std::cout << "========================================\n";
-                    {
-                        std::lock_guard<std::mutex> lock(messageHistoryMutex);
-                        if (messageHistory.empty()) {
-                            std::cout << "No messages received yet.\n";
-                        } else {
-                            // Display all messages in history
-                            for (const auto& msg : messageHistory) {
-                                std::cout << msg << "\n";
-                            }
+                    // Option 7: View received messages history (filter by time or session)
+                    displayMessageHistory(messageHistory);
+                    break;
+                }
+                
+                case 8: {
+                    // Option 8: Publish market data update over multicast
+                    if (!marketDataPublisher) {
+                        auto publisher = std::make_shared<MulticastPublisher>();
+                        if (!publisher->open()) {
+                            std::cout << "\n[Error] Failed to open multicast publisher.\n";
+                            break;
+                        }
+                        // Server sessions replay retained packets to receivers that detect gaps
+                        setRetransmitSource(publisher);
+                        marketDataPublisher = publisher;
+                    }
+                    
+                    std::cout << "\n[Action] Enter market data update to publish: ";
+                    std::string update;
+                    std::getline(std::cin, update);
+                    if (update.empty()) {
+                        std::cout << "[Error] Update cannot be empty.\n";
+                        break;
+                    }
+                    
+                    if (marketDataPublisher->publish(update) && marketDataPublisher->flush()) {
+                        std::cout << "[Success] Update published (next sequence "
+                                  << marketDataPublisher->nextSequence() << ").\n";
+                    } else {
+                        std::cout << "[Error] Failed to publish update.\n";
+                    }
+                    break;
+                }
+                
+                case 9: {
+                    // Option 9: Join or leave the multicast market data feed
+                    if (marketDataRunning) {
+                        marketDataRunning = false;
+                        if (marketDataThreadHandle.joinable()) {
+                            marketDataThreadHandle.join();
                         }
+                        std::cout << "\n[Success] Left market data feed.\n";
+                        break;
+                    }
+                    
+                    if (marketDataThreadHandle.joinable()) {
+                        marketDataThreadHandle.join();  // Reap a receiver that failed to join
+                    }
+                    marketDataRunning = true;
+                    marketDataThreadHandle = std::thread(marketDataReceiveThread,
+                                                         std::ref(marketDataRunning),
+                                                         "239.255.0.1", 30001,
+                                                         gatewayConfig().retransmitHost,
+                                                         gatewayConfig().retransmitPort);
+                    std::cout << "\n[Success] Joined market data feed (239.255.0.1:30001).\n";
+                    break;
+                }
+                
+                case 10: {
+                    // Option 10: View per-connection statistics
+                    std::lock_guard<std::mutex> serverLock(serverClientsMutex);
+                    std::lock_guard<std::mutex> clientLock(clientConnectionsMutex);
+                    displayConnectionStats(serverClients, clientConnections, connectionPool.members());
+                    break;
+                }
+                
+                case 11: {
+                    // Option 11: Start or stop the outbound connection pool
+                    if (connectionPool.running()) {
+                        connectionPool.stop();
+                        std::cout << "\n[Success] Connection pool stopped.\n";
+                        break;
+                    }
+                    
+                    const std::vector<PoolTarget> targets = parsePoolTargets(gatewayConfig().poolTargets);
+                    if (targets.empty()) {
+                        std::cout << "\n[Error] No valid pool targets in HFT_POOL_TARGETS.\n";
+                        break;
+                    }
+                    if (!connectionPool.start(targets, gatewayConfig().poolConnections, nextClientConnectionId)) {
+                        std::cout << "\n[Error] Failed to start connection pool.\n";
+                        break;
+                    }
+                    std::cout << "\n[Success] Connection pool dialing " << gatewayConfig().poolConnections
+                              << " connection(s) to " << gatewayConfig().poolTargets << ".\n";
+                    break;
+                }
+                
+                case 12: {
+                    // Option 12: Send through the pool member with the fewest outstanding bytes
+                    if (!connectionPool.running()) {
+                        std::cout << "\n[Error] Connection pool not running. Start it first (option 11).\n";
+                        break;
+                    }
+                    
+                    std::cout << "\n[Action] Enter message to send through the connection pool: ";
+                    std::string message;
+                    std::getline(std::cin, message);
+                    if (message.empty()) {
+                        std::cout << "[Error] Message cannot be empty.\n";
+                        break;
+                    }
+                    const int memberId = connectionPool.send(std::make_shared<const std::string>(message));
+                    if (memberId) {
+                        std::cout << "[Success] Message queued on pool member " << memberId << ".\n";
+                    } else {
+                        std::cout << "[Error] No healthy pool member can take the message.\n";
                     }
-                    std::cout << "========================================\n";
                     break;
                 }
                 
                 default:
-                    std::cout << "\n[Error] Invalid choice. Please enter a number between 1-7.\n";
+                    std::cout << "\n[Error] Invalid choice. Please enter a number between 1-12.\n";
                     break;
             }
         } else {
@@ -504,23 +864,52 @@ int main() {
             if (success && pendingConnectSuccess) {
                 // Connection successful - create ClientConnection structure
                 int connectionId = pendingConnectionId;
-                auto clientConn = std::make_shared<ClientConnection>(connectionId);
+                auto clientConn = makeClientConnection(connectionId, clientSlab);
                 clientConn->socket = pendingClientSocket;
                 clientConn->running = true;
                 clientConn->connected = true;
+                if (gatewayConfig().requestTimeoutMs > 0) {
+                    clientConn->requests = std::make_unique<RequestTracker>(gatewayConfig().requestTimeoutMs * 1000000);
+                }
+                
+                // HFT_TRANSPORT=shm moves the data path onto a shared-memory ring pair
+                if (gatewayConfig().shmTransport) {
+                    std::shared_ptr<ShmChannel> shm;
+                    if (requestShmUpgrade(*clientConn->socket, clientConn->buffer, shm)) {
+                        clientConn->shm = shm;
+                        clientConn->shmAttached = true;
+                        std::cout << "\n[Info] Client connection " << connectionId << " using shared memory transport.\n";
+                    } else {
+                        std::cout << "\n[Info] Shared memory upgrade failed; client connection " << connectionId << " using TCP.\n";
+                    }
+                }
                 
-                // Start receive thread for this connection
-                clientConn->receiveThread = std::thread(clientReceiveThread,
-                                                        clientConn->socket,
-                                                        std::ref(clientConn->running),
-                                                        std::ref(clientConn->connected),
-                                                        std::ref(clientConn->buffer));
+                // After the upgrade handshake, which writes to the socket before tracking starts
+                enableTxTracking(clientConn);
+                
+                // Start receive thread (or coroutine) for this connection
+                if (eventLoops.running()) {
+                    EventLoop& loop = eventLoops.next();
+                    loop.spawn(clientReceiveTask(loop, clientConn));
+                } else {
+                    clientConn->receiveThread = std::thread(clientReceiveThread,
+                                                            clientConn->socket,
+                                                            std::ref(clientConn->running),
+                                                            std::ref(clientConn->connected),
+                                                            std::ref(clientConn->buffer),
+                                                            clientConn->shm,
+                                                            &clientConn->rxWakeup,
+                                                            connectionId,
+                                                            &clientConn->traffic,
+                                                            clientConn->requests.get());
+                }
                 
                 // Add to client connections list (with mutex lock)
                 {
                     std::lock_guard<std::mutex> lock(clientConnectionsMutex);
                     clientConnections.push_back(clientConn);
                 }
+                metrics.add(Counter::ClientConnects);
                 
                 std::cout << "\n[Success] Client connection " << connectionId << " connected to server!\n";
             } else {
@@ -537,30 +926,19 @@ int main() {
     // ========================================================================
     // Cleanup on Exit
     // ========================================================================
+    // Admin scrapes read the connection lists below; stop serving them first
+    adminServer.stop();
+    
     // Stop all threads by setting control flags
-    serverAcceptRunning = false;
     clientConnectRunning = false;
+    marketDataRunning = false;
     
     // Close sockets first to break any blocking operations in threads
-    if (serverSocket) {
-        close(*serverSocket);
-    }
+    serverListeners.close();
     if (pendingClientSocket) {
         close(*pendingClientSocket);
     }
     
-    // Stop all server client connections
-    {
-        std::lock_guard<std::mutex> lock(serverClientsMutex);
-        for (auto& client : serverClients) {
-            client->running = false;
-            client->connected = false;
-            if (client->socket) {
-                close(*client->socket);
-            }
-        }
-    }
-    
     // Stop all client connections
     {
         std::lock_guard<std::mutex> lock(clientConnectionsMutex);
@@ -568,31 +946,35 @@ int main() {
             conn->running = false;
             conn->connected = false;
             if (conn->socket) {
-                close(*conn->socket);
+                shutdown(*conn->socket, SHUT_RDWR);
             }
         }
     }
     
-    // Wait for all threads to finish
+    // Pooled connections run on the pool's own loop
+    connectionPool.stop();
     
-    // Join accept thread
-    if (serverAcceptThreadHandle.joinable()) {
-        serverAcceptThreadHandle.join();
-    }
+    // Wait for all threads to finish
     
     // Join connect thread
     if (clientConnectThreadHandle.joinable()) {
         clientConnectThreadHandle.join();
     }
     
-    // Join all server client receive threads
+    // Join market data receive thread
+    if (marketDataThreadHandle.joinable()) {
+        marketDataThreadHandle.join();
+    }
+    
+    // Log out remaining server sessions (accept threads are gone, so the list is final)
+    std::vector<ClientConnectionPtr> draining;
     {
         std::lock_guard<std::mutex> lock(serverClientsMutex);
-        for (auto& client : serverClients) {
-            if (client->receiveThread.joinable()) {
-                client->receiveThread.join();
-            }
-        }
+        draining.swap(serverClients);
+    }
+    drainSessions(std::move(draining), gatewayConfig().drainTimeoutMs * 1000000);
+    if (serverDrainThreadHandle.joinable()) {
+        serverDrainThreadHandle.join();
     }
     
     // Join all client connection receive threads
@@ -605,5 +987,17 @@ int main() {
         }
     }
     
+    // Coroutines see the cleared flags within one wakeup; give them a second
+    serverListeners.stopLoops();
+    eventLoops.stop();
+    idleReaper.stop();
+    
+    // Stop TX completion reader
+    txCompletionReader.stop();
+    
+    // Flush remaining log records
+    LOG_INFO("Gateway stopped");
+    asyncLogger.stop();
+    
     return 0;
 }
@@ -0,0 +1,129 @@
+#include "admin_server.h"
+#include "metrics.h"
+#include "../logging/logger.h"
+#include <cerrno>
+#include <cstring>
+#include <sys/poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr int REQUEST_WAIT_MS = 200;   ///< How long to wait for an HTTP request line
+constexpr int POLL_TIMEOUT_MS = 100;   ///< Admin thread is not latency sensitive
+
+bool sendAll(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        #ifdef MSG_NOSIGNAL
+        const ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        #else
+        const ssize_t n = send(fd, data.data() + sent, data.size() - sent, 0);
+        #endif
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+} // namespace
+
+AdminServer::~AdminServer() {
+    stop();
+}
+
+bool AdminServer::start(const std::string& unixPath, int tcpPort) {
+    if (running_) {
+        return true;
+    }
+    if (!unixPath.empty()) {
+        if (SocketPtr listener = startUnixServer(unixPath)) {
+            listeners_.push_back(listener);
+            LOG_INFO("Admin endpoint listening on {}", unixPath);
+        }
+    }
+    if (tcpPort > 0) {
+        if (SocketPtr listener = startServer(static_cast<uint16_t>(tcpPort), "127.0.0.1")) {
+            listeners_.push_back(listener);
+            LOG_INFO("Admin endpoint listening on 127.0.0.1:{}", tcpPort);
+        }
+    }
+    if (listeners_.empty()) {
+        return false;
+    }
+    running_ = true;
+    thread_ = std::thread(&AdminServer::run, this);
+    return true;
+}
+
+void AdminServer::stop() {
+    running_ = false;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    listeners_.clear();
+}
+
+void AdminServer::run() {
+    std::vector<struct pollfd> pfds(listeners_.size());
+    for (size_t i = 0; i < listeners_.size(); ++i) {
+        pfds[i].fd = *listeners_[i];
+        pfds[i].events = POLLIN;
+    }
+
+    while (running_) {
+        for (auto& pfd : pfds) {
+            pfd.revents = 0;
+        }
+        if (poll(pfds.data(), pfds.size(), POLL_TIMEOUT_MS) <= 0) {
+            continue;
+        }
+        for (const auto& pfd : pfds) {
+            if (!(pfd.revents & POLLIN)) {
+                continue;
+            }
+            const int fd = accept(pfd.fd, nullptr, nullptr);
+            if (fd < 0) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    LOG_WARN("Admin accept failed: {}", strerror(errno));
+                }
+                continue;
+            }
+            serve(fd);
+            close(fd);
+        }
+    }
+}
+
+void AdminServer::serve(int fd) {
+    // A stalled scraper must not wedge the admin thread
+    timeval timeout{1, 0};
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    // HTTP clients send a request first; raw clients usually send nothing
+    bool http = false;
+    struct pollfd pfd{fd, POLLIN, 0};
+    if (poll(&pfd, 1, REQUEST_WAIT_MS) > 0 && (pfd.revents & POLLIN)) {
+        char request[4096];
+        const ssize_t n = recv(fd, request, sizeof(request), 0);
+        http = n >= 4 && std::memcmp(request, "GET ", 4) == 0;
+    }
+
+    const std::string body = metrics.render();
+    if (http) {
+        const std::string header = "HTTP/1.0 200 OK\r\n"
+                                   "Content-Type: text/plain; version=0.0.4\r\n"
+                                   "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                                   "Connection: close\r\n\r\n";
+        if (!sendAll(fd, header)) {
+            return;
+        }
+    }
+    sendAll(fd, body);
+}
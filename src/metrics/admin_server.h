@@ -0,0 +1,51 @@
+#pragma once
+
+/**
+ * @file admin_server.h
+ * @brief Local admin endpoint serving the metrics registry
+ * 
+ * Listens on a Unix domain socket and/or a loopback TCP port. Each connection
+ * gets one scrape of the registry in Prometheus text format and is closed:
+ * an HTTP GET is answered with an HTTP/1.0 response (curl, Prometheus), any
+ * other client (nc, socat) receives the bare exposition.
+ * 
+ * The admin thread is off the data path; scrapes only read per-thread
+ * counter blocks and never block senders or receivers.
+ */
+
+#include "../network/socket_utils.h"
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @class AdminServer
+ * @brief Background thread answering metrics scrapes
+ */
+class AdminServer {
+public:
+    ~AdminServer();
+
+    /**
+     * @brief Opens the listeners and starts the admin thread
+     * 
+     * @param unixPath Unix socket path (empty for none)
+     * @param tcpPort TCP port bound to 127.0.0.1 (0 for none)
+     * @return false if no listener could be opened
+     */
+    bool start(const std::string& unixPath, int tcpPort);
+
+    /**
+     * @brief Stops the admin thread and closes the listeners
+     */
+    void stop();
+
+private:
+    std::vector<SocketPtr> listeners_;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+
+    void run();
+    static void serve(int fd);
+};
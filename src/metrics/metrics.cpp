@@ -0,0 +1,172 @@
+#include "metrics.h"
+#include <cmath>
+#include <cstdio>
+
+MetricsRegistry metrics;
+
+namespace {
+
+struct CounterInfo {
+    const char* name;
+    const char* help;
+};
+
+// Indexed by Counter
+const CounterInfo COUNTER_INFO[MetricsRegistry::COUNTER_COUNT] = {
+    {"hft_frames_in_total", "Frames received"},
+    {"hft_frames_out_total", "Frames sent"},
+    {"hft_bytes_in_total", "Payload bytes received"},
+    {"hft_bytes_out_total", "Payload bytes sent"},
+    {"hft_frames_dropped_total", "Invalid or oversized frames that reset a stream"},
+    {"hft_throttle_rejected_total", "Frames rejected by session throttles"},
+    {"hft_buffer_compactions_total", "Message buffer compactions"},
+    {"hft_sessions_accepted_total", "Server sessions accepted"},
+    {"hft_sessions_rejected_total", "Connections refused at the session limit"},
+    {"hft_sessions_closed_total", "Server sessions ended"},
+    {"hft_client_connects_total", "Outbound client connections established"},
+    {"hft_updates_conflated_total", "Published updates replaced by a newer one before being sent"},
+    {"hft_sessions_reaped_total", "Server sessions closed by the idle timeout"},
+    {"hft_reaped_buffer_bytes_total", "Receive buffer bytes released by reaped sessions"},
+    {"hft_requests_completed_total", "Correlated requests answered"},
+    {"hft_requests_failed_total", "Correlated requests that timed out or lost their connection"},
+};
+
+/**
+ * @brief Marks the thread's block retired on thread exit
+ */
+struct ThreadBlockOwner {
+    std::shared_ptr<void> block;
+    std::atomic<bool>* retired = nullptr;
+
+    ~ThreadBlockOwner() {
+        if (retired) {
+            retired->store(true, std::memory_order_release);
+        }
+    }
+};
+
+thread_local ThreadBlockOwner threadBlockOwner;
+
+} // namespace
+
+MetricsRegistry::ThreadBlock* MetricsRegistry::registerThread() {
+    auto block = std::make_shared<ThreadBlock>();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        blocks_.push_back(block);
+    }
+    threadBlockOwner.retired = &block->retired;
+    threadBlockOwner.block = block;
+    threadBlock_ = block.get();
+    return threadBlock_;
+}
+
+uint64_t MetricsRegistry::totalLocked(size_t index) const {
+    uint64_t sum = retiredTotals_[index];
+    for (const auto& block : blocks_) {
+        sum += block->values[index].load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+uint64_t MetricsRegistry::total(Counter counter) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return totalLocked(static_cast<size_t>(counter));
+}
+
+void MetricsRegistry::addGauge(const std::string& name, const std::string& help, std::function<double()> read) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    gauges_.push_back({name, help, std::move(read)});
+}
+
+void MetricsRegistry::addCollector(std::function<void(std::string&)> collect) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    collectors_.push_back(std::move(collect));
+}
+
+std::string MetricsRegistry::render() const {
+    std::string out;
+    std::vector<Gauge> gauges;
+    std::vector<std::function<void(std::string&)>> collectors;
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    // Fold blocks of exited threads so totals survive them
+    for (auto it = blocks_.begin(); it != blocks_.end();) {
+        if ((*it)->retired.load(std::memory_order_acquire)) {
+            for (size_t i = 0; i < COUNTER_COUNT; ++i) {
+                retiredTotals_[i] += (*it)->values[i].load(std::memory_order_relaxed);
+            }
+            it = blocks_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    for (size_t i = 0; i < COUNTER_COUNT; ++i) {
+        appendMetricHeader(out, COUNTER_INFO[i].name, COUNTER_INFO[i].help, "counter");
+        appendMetric(out, COUNTER_INFO[i].name, "", static_cast<double>(totalLocked(i)));
+    }
+    // Callbacks run unlocked: they take other locks (main's collector takes the
+    // session list mutexes), while registerThread() takes mutex_ from threads
+    // that may hold those same locks
+    gauges = gauges_;
+    collectors = collectors_;
+    lock.unlock();
+
+    for (const auto& gauge : gauges) {
+        const std::string name = "hft_" + gauge.name;
+        appendMetricHeader(out, name, gauge.help, "gauge");
+        appendMetric(out, name, "", gauge.read());
+    }
+    for (const auto& collect : collectors) {
+        collect(out);
+    }
+    return out;
+}
+
+void appendMetricHeader(std::string& out, const std::string& name, const std::string& help, const char* type) {
+    out += "# HELP " + name + " " + help + "\n";
+    out += "# TYPE " + name + " " + type + "\n";
+}
+
+void appendMetric(std::string& out, const std::string& name, const std::string& labels, double value) {
+    char number[32];
+    if (std::floor(value) == value && std::fabs(value) < 1e15) {
+        std::snprintf(number, sizeof(number), "%.0f", value);
+    } else {
+        std::snprintf(number, sizeof(number), "%g", value);
+    }
+    out += name;
+    if (!labels.empty()) {
+        out += "{" + labels + "}";
+    }
+    out += " ";
+    out += number;
+    out += "\n";
+}
+
+void appendConnectionMetrics(std::string& out,
+                             const std::vector<std::pair<std::string, const ConnectionMetrics*>>& connections) {
+    struct Family {
+        const char* name;
+        const char* help;
+        const std::atomic<uint64_t> ConnectionMetrics::*field;
+    };
+    static const Family families[] = {
+        {"hft_connection_frames_in_total", "Frames received on the connection", &ConnectionMetrics::framesIn},
+        {"hft_connection_bytes_in_total", "Payload bytes received on the connection", &ConnectionMetrics::bytesIn},
+        {"hft_connection_frames_out_total", "Frames sent on the connection", &ConnectionMetrics::framesOut},
+        {"hft_connection_bytes_out_total", "Payload bytes sent on the connection", &ConnectionMetrics::bytesOut},
+    };
+    if (connections.empty()) {
+        return;
+    }
+    // Prometheus expects each family's series together
+    for (const auto& family : families) {
+        appendMetricHeader(out, family.name, family.help, "counter");
+        for (const auto& connection : connections) {
+            appendMetric(out, family.name, connection.first,
+                         static_cast<double>((connection.second->*family.field).load(std::memory_order_relaxed)));
+        }
+    }
+}
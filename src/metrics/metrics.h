@@ -0,0 +1,157 @@
+#pragma once
+
+/**
+ * @file metrics.h
+ * @brief Lock-free metrics registry rendered in Prometheus text format
+ * 
+ * Global counters are per-thread: each thread increments its own cache-line
+ * aligned block with a relaxed load/store (no atomic read-modify-write, no
+ * sharing between writers). A scrape sums every block, so readers never
+ * contend with the hot path beyond reading its lines. Blocks of exited
+ * threads are folded into retired totals.
+ * 
+ * Gauges are callbacks evaluated at scrape time; collectors append
+ * arbitrary labelled series (e.g. per-connection counters).
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Global counters (exported as hft_<name>_total)
+ */
+enum class Counter : uint8_t {
+    FramesIn,           ///< Frames received (socket and shm)
+    FramesOut,          ///< Frames sent
+    BytesIn,            ///< Payload bytes received
+    BytesOut,           ///< Payload bytes sent
+    FramesDropped,      ///< Invalid or oversized frames that reset a stream
+    ThrottleRejected,   ///< Frames rejected by session throttles
+    BufferCompactions,  ///< MessageBuffer compactions
+    SessionsAccepted,   ///< Server sessions accepted
+    SessionsRejected,   ///< Connections refused at the session limit
+    SessionsClosed,     ///< Server sessions ended (peer close or throttle)
+    ClientConnects,     ///< Outbound client connections established (including reconnects)
+    UpdatesConflated,   ///< Published updates replaced by a newer one before being sent
+    SessionsReaped,     ///< Server sessions closed by the idle timeout
+    ReapedBufferBytes,  ///< Receive buffer memory released by reaped sessions
+    RequestsCompleted,  ///< Correlated requests answered
+    RequestsFailed,     ///< Correlated requests that timed out or lost their connection
+    Count
+};
+
+/**
+ * @struct ConnectionMetrics
+ * @brief Per-connection counters, inbound and outbound on separate cache lines
+ * 
+ * Inbound counters have a single writer (the connection's receive thread);
+ * outbound ones may be written by any sending thread.
+ */
+struct ConnectionMetrics {
+    alignas(64) std::atomic<uint64_t> framesIn{0};
+    std::atomic<uint64_t> bytesIn{0};
+    alignas(64) std::atomic<uint64_t> framesOut{0};
+    std::atomic<uint64_t> bytesOut{0};
+
+    void recordIn(size_t bytes) {
+        framesIn.store(framesIn.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        bytesIn.store(bytesIn.load(std::memory_order_relaxed) + bytes, std::memory_order_relaxed);
+    }
+
+    void recordOut(size_t bytes) {
+        framesOut.fetch_add(1, std::memory_order_relaxed);
+        bytesOut.fetch_add(bytes, std::memory_order_relaxed);
+    }
+};
+
+/**
+ * @class MetricsRegistry
+ * @brief Per-thread counters plus scrape-time gauges and collectors
+ */
+class MetricsRegistry {
+public:
+    static constexpr size_t COUNTER_COUNT = static_cast<size_t>(Counter::Count);
+
+    /**
+     * @brief Adds to a counter in the calling thread's block
+     */
+    void add(Counter counter, uint64_t value = 1) {
+        ThreadBlock* block = threadBlock_ ? threadBlock_ : registerThread();
+        std::atomic<uint64_t>& slot = block->values[static_cast<size_t>(counter)];
+        slot.store(slot.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Sum of a counter across all threads
+     */
+    uint64_t total(Counter counter) const;
+
+    /**
+     * @brief Registers a gauge evaluated on each scrape (exported as hft_<name>)
+     */
+    void addGauge(const std::string& name, const std::string& help, std::function<double()> read);
+
+    /**
+     * @brief Registers a callback that appends its own series to each scrape
+     */
+    void addCollector(std::function<void(std::string&)> collect);
+
+    /**
+     * @brief Prometheus text exposition of all counters, gauges and collectors
+     *
+     * Gauges and collectors are called after mutex_ is released, so they may
+     * take locks held by threads that are counting.
+     */
+    std::string render() const;
+
+private:
+    struct alignas(64) ThreadBlock {
+        std::atomic<uint64_t> values[COUNTER_COUNT] = {};
+        std::atomic<bool> retired{false};   ///< Owner thread exited
+    };
+
+    struct Gauge {
+        std::string name;
+        std::string help;
+        std::function<double()> read;
+    };
+
+    inline static thread_local ThreadBlock* threadBlock_ = nullptr;
+
+    mutable std::mutex mutex_;                              ///< Guards everything below
+    mutable std::vector<std::shared_ptr<ThreadBlock>> blocks_;
+    mutable uint64_t retiredTotals_[COUNTER_COUNT] = {};    ///< Folded from exited threads
+    std::vector<Gauge> gauges_;
+    std::vector<std::function<void(std::string&)>> collectors_;
+
+    ThreadBlock* registerThread();
+    uint64_t totalLocked(size_t index) const;
+};
+
+/**
+ * @brief Global registry
+ */
+extern MetricsRegistry metrics;
+
+/**
+ * @brief Appends one series in Prometheus text format ("name{labels} value")
+ * 
+ * @param labels Label list without braces (e.g. role="session",id="3"), may be empty
+ */
+void appendMetric(std::string& out, const std::string& name, const std::string& labels, double value);
+
+/**
+ * @brief Appends "# HELP" and "# TYPE" lines for a metric family
+ */
+void appendMetricHeader(std::string& out, const std::string& name, const std::string& help, const char* type);
+
+/**
+ * @brief Appends per-connection counter families for (labels, metrics) pairs
+ */
+void appendConnectionMetrics(std::string& out,
+                             const std::vector<std::pair<std::string, const ConnectionMetrics*>>& connections);
@@ -0,0 +1,191 @@
+#include "async_io.h"
+#include "message.h"
+#include "../config/config.h"
+#include "../logging/logger.h"
+#include "../metrics/metrics.h"
+#include "../util/tsc_clock.h"
+#include <algorithm>
+#include <cerrno>
+#include <sys/poll.h>
+#include <sys/socket.h>
+
+namespace {
+
+constexpr int64_t WRITE_CHECK_NS = 50000000;  ///< Blocked reply writes re-check the session at least this often
+constexpr int64_t RETRY_NS = 1000000;         ///< Retry interval for a full shared-memory ring or a busy writer
+
+/**
+ * @brief Writes all of framed, suspending while the socket is full
+ *
+ * With conn set, a wait re-checks the session every WRITE_CHECK_NS and gives
+ * up once it stops. A non-zero deadlineNs (steady clock) bounds the whole
+ * write and sets timedOut when it passes. bytesSent reports progress even on
+ * failure.
+ */
+Task<bool> writeAll(EventLoop& loop, int socketFd, const std::string& framed, size_t& bytesSent,
+                    const ClientConnection* conn, int64_t deadlineNs, bool& timedOut) {
+    while (bytesSent < framed.size()) {
+        #ifdef MSG_NOSIGNAL
+        const ssize_t sent = send(socketFd, framed.data() + bytesSent, framed.size() - bytesSent, MSG_NOSIGNAL);
+        #else
+        const ssize_t sent = send(socketFd, framed.data() + bytesSent, framed.size() - bytesSent, 0);
+        #endif
+        if (sent > 0) {
+            bytesSent += static_cast<size_t>(sent);
+            continue;
+        }
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            int64_t waitNs = conn ? WRITE_CHECK_NS : -1;
+            if (deadlineNs) {
+                const int64_t remainingNs = deadlineNs - static_cast<int64_t>(steadyClockNs());
+                if (remainingNs <= 0) {
+                    timedOut = true;
+                    co_return false;
+                }
+                waitNs = waitNs < 0 ? remainingNs : std::min(waitNs, remainingNs);
+            }
+            const IoStatus status = co_await loop.writable(socketFd, waitNs);
+            if (status == IoStatus::Error ||
+                (status == IoStatus::Timeout && conn && (!conn->running || !conn->connected))) {
+                co_return false;
+            }
+            continue;
+        }
+        co_return false;
+    }
+    co_return true;
+}
+
+} // namespace
+
+Task<bool> asyncConnect(EventLoop& loop, int socketFd, sockaddr_in address, int64_t timeoutNs) {
+    if (connect(socketFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) {
+        co_return true;
+    }
+    if (errno != EINPROGRESS) {
+        co_return false;
+    }
+    if (co_await loop.writable(socketFd, timeoutNs) != IoStatus::Ready) {
+        co_return false;
+    }
+    int error = 0;
+    socklen_t len = sizeof(error);
+    co_return getsockopt(socketFd, SOL_SOCKET, SO_ERROR, &error, &len) == 0 && error == 0;
+}
+
+Task<bool> asyncSendFrame(EventLoop& loop, int socketFd, std::string message) {
+    if (socketFd < 0 || message.empty() || message.size() > MessageBuffer::MAX_PAYLOAD) {
+        co_return false;
+    }
+    
+    const std::string framed = encodeFrame(message, 0, 0);
+    size_t bytesSent = 0;
+    bool timedOut = false;
+    if (!co_await writeAll(loop, socketFd, framed, bytesSent, nullptr, 0, timedOut)) {
+        co_return false;
+    }
+    
+    metrics.add(Counter::FramesOut);
+    metrics.add(Counter::BytesOut, message.size());
+    co_return true;
+}
+
+Task<bool> asyncSendReply(EventLoop& loop, ClientConnectionPtr conn, SessionReply reply) {
+    if (!conn || !reply.message || reply.message->empty() || reply.message->size() > MessageBuffer::MAX_PAYLOAD) {
+        co_return false;
+    }
+    const std::string& message = *reply.message;
+    const int64_t timeoutMs = gatewayConfig().sendTimeoutMs;
+    const int64_t deadlineNs = timeoutMs > 0 ? static_cast<int64_t>(steadyClockNs()) + timeoutMs * 1000000 : 0;
+    auto expired = [deadlineNs] { return deadlineNs && static_cast<int64_t>(steadyClockNs()) >= deadlineNs; };
+    
+    // Another thread may be mid-frame on this connection: wait on the loop, not on the mutex.
+    // The lock is held across suspensions; the task always resumes on this loop's thread.
+    std::unique_lock<std::mutex> writing(conn->sendMutex, std::defer_lock);
+    while (!writing.try_lock()) {
+        if (!conn->running || !conn->connected || expired()) {
+            co_return false;
+        }
+        co_await loop.sleepFor(RETRY_NS);
+    }
+    
+    if (conn->shmAttached) {
+        // Ring frames have no extension; a correlated reply cannot go this way
+        ShmChannel& channel = *conn->shm;
+        if (reply.correlationId || 4 + message.size() > channel.capacity()) {
+            co_return false;
+        }
+        while (!channel.trySend(message)) {
+            if (channel.peerClosed() || !conn->running || !conn->connected || expired()) {
+                co_return false;
+            }
+            co_await loop.sleepFor(RETRY_NS);
+        }
+    } else {
+        if (!conn->socket || *conn->socket < 0) {
+            co_return false;
+        }
+        TxCompletionTracker* tracker = conn->txTracker.get();
+        const int64_t userNs = tracker ? realtimeNs() : 0;
+        const std::string framed = encodeFrame(message, reply.type, reply.correlationId);
+        size_t bytesSent = 0;
+        bool timedOut = false;
+        const bool sent = co_await writeAll(loop, *conn->socket, framed, bytesSent, conn.get(), deadlineNs, timedOut);
+        if (tracker) {
+            tracker->recordSend(bytesSent, userNs);  // Partial frames too: byte offsets follow the kernel
+        }
+        if (timedOut) {
+            // Peer is connected but not reading, and the stream may end mid-frame: drop the session.
+            // The session task sees EOF on its next wait and cleans up from there.
+            LOG_WARN("Session {} not reading for {}ms, disconnecting", conn->id, timeoutMs);
+            shutdown(*conn->socket, SHUT_RDWR);
+        }
+        if (!sent) {
+            co_return false;
+        }
+    }
+    
+    metrics.add(Counter::FramesOut);
+    metrics.add(Counter::BytesOut, message.size());
+    conn->traffic.recordOut(message.size());
+    co_return true;
+}
+
+Task<size_t> asyncFlushConflated(EventLoop& loop, ClientConnectionPtr conn) {
+    ConflationQueue* queue = conn ? conn->conflation.get() : nullptr;
+    if (!queue || !queue->pending()) {
+        co_return 0;
+    }
+    if (conn->shmAttached) {
+        co_return flushConflated(conn);  // Ring writes are single non-blocking attempts already
+    }
+    std::unique_lock<std::mutex> flushing(queue->flushMutex, std::try_to_lock);
+    if (!flushing.owns_lock()) {
+        co_return 0;
+    }
+    
+    size_t sent = 0;
+    uint32_t symbolId;
+    ConflationQueue::Frame frame;
+    while (queue->pending() && conn->running && conn->connected && !conn->shmAttached) {
+        if (!conn->socket || *conn->socket < 0) {
+            break;
+        }
+        struct pollfd pfd{*conn->socket, POLLOUT, 0};
+        if (poll(&pfd, 1, 0) <= 0 || !(pfd.revents & POLLOUT)) {
+            break;
+        }
+        if (!queue->pop(symbolId, frame)) {
+            break;
+        }
+        if (!co_await asyncSendReply(loop, conn, SessionReply{frame, 0, 0, nullptr})) {
+            queue->restore(symbolId, std::move(frame));
+            break;
+        }
+        ++sent;
+    }
+    co_return sent;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+/**
+ * @file async_io.h
+ * @brief Coroutine socket operations on an EventLoop
+ *
+ * Counterparts of the blocking helpers in message.h and client.h that suspend
+ * on the loop instead of sitting in poll(). Sockets must be non-blocking.
+ * Receiving has no wrapper: sessions await loop.readable() and then drain the
+ * socket with receiveFramedMessage(..., timeoutMs = 0).
+ */
+
+#include "../async/event_loop.h"
+#include "../async/task.h"
+#include "connection.h"
+#include <cstdint>
+#include <string>
+#include <netinet/in.h>
+
+/**
+ * @brief Non-blocking connect, suspended until it completes or timeoutNs passes
+ *
+ * @return true if connected (SO_ERROR clear)
+ */
+Task<bool> asyncConnect(EventLoop& loop, int socketFd, sockaddr_in address, int64_t timeoutNs);
+
+/**
+ * @brief Sends one length-prefixed frame, suspending while the socket is full
+ *
+ * @return false on error, peer close, or payload over the frame limit
+ */
+Task<bool> asyncSendFrame(EventLoop& loop, int socketFd, std::string message);
+
+/**
+ * @brief Sends a session reply on the connection's active data path without blocking the loop
+ *
+ * Socket replies suspend on writable() instead of polling, record the frame
+ * in the connection's TX tracker and count FramesOut/BytesOut and the
+ * session's traffic like sendReply(). Zerocopy is not used; large frames go
+ * through the copy path. A full shared-memory ring, or conn->sendMutex held
+ * by another writer, is retried every millisecond. Gives up once the
+ * session stops running or disconnects, or after HFT_SEND_TIMEOUT_MS; a
+ * socket that stays full that long is shut down as a slow consumer.
+ *
+ * @return false if the reply was not (completely) sent
+ */
+Task<bool> asyncSendReply(EventLoop& loop, ClientConnectionPtr conn, SessionReply reply);
+
+/**
+ * @brief flushConflated() for coroutine sessions: frames go out through asyncSendReply()
+ *
+ * Stops at the first sign of backpressure like flushConflated(), so the
+ * session gets back to reading; a frame that was not sent stays dirty.
+ * conflation->flushMutex is held across suspensions, which publishers
+ * (try-lock) simply skip.
+ *
+ * @return Number of frames sent
+ */
+Task<size_t> asyncFlushConflated(EventLoop& loop, ClientConnectionPtr conn);
@@ -0,0 +1,65 @@
+#include "conflation.h"
+#include "../metrics/metrics.h"
+
+void ConflationQueue::offer(uint32_t symbolId, Frame frame) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (symbolId >= slots_.size()) {
+        slots_.resize(symbolId + 1);
+    }
+    Slot& slot = slots_[symbolId];
+    if (slot.dirty) {
+        conflated_.fetch_add(1, std::memory_order_relaxed);
+        metrics.add(Counter::UpdatesConflated);
+    } else {
+        slot.dirty = true;
+        dirty_.push_back(symbolId);
+        dirtyCount_.fetch_add(1, std::memory_order_release);
+    }
+    slot.latest = std::move(frame);
+}
+
+bool ConflationQueue::pop(Frame& frame) {
+    uint32_t symbolId;
+    return pop(symbolId, frame);
+}
+
+bool ConflationQueue::pop(uint32_t& symbolId, Frame& frame) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (head_ == dirty_.size()) {
+        return false;
+    }
+    symbolId = dirty_[head_++];
+    Slot& slot = slots_[symbolId];
+    frame = std::move(slot.latest);
+    slot.dirty = false;
+    // Entries from head_ on are distinct dirty symbols; drop the popped prefix once it is
+    // the larger half, so a subscriber that never catches up keeps at most 2 entries per symbol
+    if (head_ == dirty_.size()) {
+        dirty_.clear();
+        head_ = 0;
+    } else if (head_ > dirty_.size() / 2) {
+        dirty_.erase(dirty_.begin(), dirty_.begin() + static_cast<std::ptrdiff_t>(head_));
+        head_ = 0;
+    }
+    dirtyCount_.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+void ConflationQueue::restore(uint32_t symbolId, Frame frame) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Slot& slot = slots_[symbolId];
+    if (slot.dirty) {
+        // Offered again since the pop: the newer value supersedes this one
+        conflated_.fetch_add(1, std::memory_order_relaxed);
+        metrics.add(Counter::UpdatesConflated);
+        return;
+    }
+    slot.dirty = true;
+    slot.latest = std::move(frame);
+    if (head_ > 0) {
+        dirty_[--head_] = symbolId;
+    } else {
+        dirty_.insert(dirty_.begin(), symbolId);
+    }
+    dirtyCount_.fetch_add(1, std::memory_order_release);
+}
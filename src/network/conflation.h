@@ -0,0 +1,80 @@
+#pragma once
+
+/**
+ * @file conflation.h
+ * @brief Latest-value-per-symbol outbound queue for slow subscribers
+ *
+ * A conflating session does not queue every tick. Each symbol has one slot
+ * holding its most recent frame; a symbol is put on the dirty list the first
+ * time it is written after a flush. Flushing sends the current frame of each
+ * dirty symbol, oldest dirty first, so a subscriber that falls behind skips
+ * intermediate updates instead of building a backlog. Memory is bounded by
+ * one frame per symbol.
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @class ConflationQueue
+ * @brief Per-symbol latest-value slots plus a dirty list
+ *
+ * Thread safety: offer() and pop() may be called from any thread.
+ * flushMutex serializes flushers so frames are not interleaved on the socket.
+ */
+class ConflationQueue {
+public:
+    using Frame = std::shared_ptr<const std::string>;
+
+    /**
+     * @brief Stores frame as the latest value of symbolId, marking it dirty
+     */
+    void offer(uint32_t symbolId, Frame frame);
+
+    /**
+     * @brief Takes the latest value of the oldest dirty symbol
+     *
+     * @return false if nothing is dirty
+     */
+    bool pop(Frame& frame);
+
+    /**
+     * @brief pop() that also reports which symbol the frame belongs to
+     */
+    bool pop(uint32_t& symbolId, Frame& frame);
+
+    /**
+     * @brief Puts back a popped frame that could not be sent, first in line again
+     *
+     * Dropped (and counted as conflated) if a newer value for the symbol was
+     * offered meanwhile.
+     */
+    void restore(uint32_t symbolId, Frame frame);
+
+    /**
+     * @brief Whether any symbol is waiting to be flushed (lock-free)
+     */
+    bool pending() const { return dirtyCount_.load(std::memory_order_acquire) > 0; }
+
+    uint64_t conflated() const { return conflated_.load(std::memory_order_relaxed); }
+    size_t dirtySymbols() const { return dirtyCount_.load(std::memory_order_relaxed); }
+
+    std::mutex flushMutex;  ///< Held by the thread currently writing to the socket
+
+private:
+    struct Slot {
+        Frame latest;
+        bool dirty = false;
+    };
+
+    std::mutex mutex_;                  ///< Guards slots_, dirty_ and head_
+    std::vector<Slot> slots_;           ///< Indexed by symbol id, grown on demand
+    std::vector<uint32_t> dirty_;       ///< Dirty symbol ids in marking order (compacted by pop())
+    size_t head_ = 0;                   ///< Next dirty_ entry to pop
+    std::atomic<size_t> dirtyCount_{0};
+    std::atomic<uint64_t> conflated_{0};  ///< Updates overwritten before they were sent
+};
@@ -1,15 +1,187 @@
 #include "connection.h"
+#include "../config/config.h"
+#include <sys/poll.h>
+#include <sys/socket.h>
 #include <unistd.h>
 
 ClientConnection::ClientConnection(int clientId) : id(clientId) {}
 
+ClientConnectionPtr makeClientConnection(int clientId, const ConnectionSlabPtr& slab) {
+    if (!slab) {
+        return std::make_shared<ClientConnection>(clientId);
+    }
+    return std::allocate_shared<ClientConnection>(ConnectionSlabAllocator<ClientConnection>(slab), clientId);
+}
+
 ClientConnection::~ClientConnection() {
     running = false;
     connected = false;
+    if (requests) {
+        requests->failAll();
+    }
+    if (txTracker) {
+        txCompletionReader.remove(txTracker.get());
+    }
     if (socket) {
-        close(*socket);
+        // Wakes a blocked receiver; the SocketPtr deleter closes the fd exactly once
+        shutdown(*socket, SHUT_RDWR);
     }
     if (receiveThread.joinable()) {
-        receiveThread.join();
+        // The receive thread may hold the last reference once its session was reaped
+        if (receiveThread.get_id() == std::this_thread::get_id()) {
+            receiveThread.detach();
+        } else {
+            receiveThread.join();
+        }
+    }
+}
+
+bool sendToConnection(const ClientConnectionPtr& conn, const std::shared_ptr<const std::string>& message) {
+    if (!conn || !message || message->empty()) {
+        return false;
+    }
+    std::lock_guard<std::mutex> writing(conn->sendMutex);
+    bool sent;
+    if (conn->shmAttached) {
+        sent = sendFramedMessage(*conn->shm, *message);
+    } else if (!conn->socket || *conn->socket < 0) {
+        return false;
+    } else {
+        // Large frames (snapshots, reference data) skip the staging copy
+        const size_t threshold = gatewayConfig().zeroCopyThreshold;
+        if (threshold > 0 && conn->txTracker && conn->txTracker->zeroCopyEnabled() &&
+            message->size() >= threshold) {
+            sent = sendFramedMessageZeroCopy(*conn->socket, message, *conn->txTracker);
+        } else {
+            sent = sendFramedMessage(*conn->socket, *message, conn->txTracker.get());
+        }
+    }
+    if (sent) {
+        conn->traffic.recordOut(message->size());
+    }
+    return sent;
+}
+
+bool trySendShm(const ClientConnectionPtr& conn, const std::string& message) {
+    if (!conn || !conn->shmAttached || message.empty()) {
+        return false;
+    }
+    std::unique_lock<std::mutex> writing(conn->sendMutex, std::try_to_lock);
+    if (!writing.owns_lock() || !conn->shm->trySend(message)) {
+        return false;
+    }
+    metrics.add(Counter::FramesOut);
+    metrics.add(Counter::BytesOut, message.size());
+    conn->traffic.recordOut(message.size());
+    return true;
+}
+
+bool sendCorrelated(const ClientConnectionPtr& conn, const std::string& message, uint8_t type, uint64_t correlationId) {
+    if (!conn || conn->shmAttached || !conn->socket || *conn->socket < 0) {
+        return false;
+    }
+    std::lock_guard<std::mutex> writing(conn->sendMutex);
+    if (!sendFramedMessage(*conn->socket, message, conn->txTracker.get(), type, correlationId)) {
+        return false;
+    }
+    conn->traffic.recordOut(message.size());
+    return true;
+}
+
+bool sendReply(const ClientConnectionPtr& conn, const SessionReply& reply) {
+    if (reply.correlationId) {
+        return reply.message && sendCorrelated(conn, *reply.message, reply.type, reply.correlationId);
+    }
+    return sendToConnection(conn, reply.message);
+}
+
+uint64_t sendRequest(const ClientConnectionPtr& conn, const std::string& message, uint8_t type,
+                     ResponseCallback callback) {
+    if (!conn || !conn->requests) {
+        return 0;
+    }
+    // Registered first: the response may arrive before send() returns
+    const uint64_t id = conn->requests->begin(type, std::move(callback));
+    if (!sendCorrelated(conn, message, type, id)) {
+        conn->requests->cancel(id);
+        return 0;
+    }
+    return id;
+}
+
+std::future<CorrelatedResponse> sendRequest(const ClientConnectionPtr& conn, const std::string& message,
+                                            uint8_t type) {
+    auto promise = std::make_shared<std::promise<CorrelatedResponse>>();
+    std::future<CorrelatedResponse> future = promise->get_future();
+    if (!sendRequest(conn, message, type, [promise](const CorrelatedResponse& response) {
+            promise->set_value(response);
+        })) {
+        CorrelatedResponse failed;
+        failed.type = type;
+        promise->set_value(failed);
+    }
+    return future;
+}
+
+void enableTxTracking(const ClientConnectionPtr& conn) {
+    const GatewayConfig& config = gatewayConfig();
+    if ((!config.txTimestamps && config.zeroCopyThreshold == 0) ||
+        !conn || !conn->socket || *conn->socket < 0) {
+        return;
+    }
+    auto tracker = std::make_shared<TxCompletionTracker>(*conn->socket);
+    const bool timestamps = config.txTimestamps && tracker->enableTimestamps();
+    const bool zeroCopy = config.zeroCopyThreshold > 0 && tracker->enableZeroCopy();
+    if (timestamps || zeroCopy) {
+        conn->txTracker = tracker;
+        txCompletionReader.add(tracker);
+    }
+}
+
+size_t flushConflated(const ClientConnectionPtr& conn) {
+    ConflationQueue* queue = conn ? conn->conflation.get() : nullptr;
+    if (!queue || !queue->pending()) {
+        return 0;
+    }
+    std::unique_lock<std::mutex> flushing(queue->flushMutex, std::try_to_lock);
+    if (!flushing.owns_lock()) {
+        return 0;
+    }
+    
+    size_t sent = 0;
+    uint32_t symbolId;
+    ConflationQueue::Frame frame;
+    while (queue->pending()) {
+        // Stop at the first sign of backpressure; dirty symbols keep their newest value
+        if (conn->shmAttached) {
+            // The ring has no readiness to poll: one attempt per frame, put back if it is full
+            if (!queue->pop(symbolId, frame)) {
+                break;
+            }
+            if (4 + frame->size() > conn->shm->capacity() || conn->shm->broken()) {
+                continue;  // Can never fit: dropped rather than left at the head for good
+            }
+            if (!trySendShm(conn, *frame)) {
+                queue->restore(symbolId, std::move(frame));
+                break;
+            }
+            ++sent;
+            continue;
+        }
+        if (!conn->socket || *conn->socket < 0) {
+            break;
+        }
+        struct pollfd pfd{*conn->socket, POLLOUT, 0};
+        if (poll(&pfd, 1, 0) <= 0 || !(pfd.revents & POLLOUT)) {
+            break;
+        }
+        if (!queue->pop(frame)) {
+            break;
+        }
+        if (!sendToConnection(conn, frame)) {
+            break;
+        }
+        ++sent;
     }
+    return sent;
 }
@@ -7,25 +7,157 @@
 
 #include "socket_utils.h"
 #include "message.h"
+#include "shm_transport.h"
+#include "latency_histogram.h"
+#include "tx_completion.h"
+#include "throttle.h"
+#include "conflation.h"
+#include "request_tracker.h"
+#include "connection_slab.h"
+#include "../metrics/metrics.h"
 #include <thread>
 #include <atomic>
+#include <future>
+#include <mutex>
+#include <vector>
 
 /**
  * @struct ClientConnection
  * @brief Represents a single client connection with socket, thread, and buffer
  * 
+ * Fields are grouped by who touches them, each group on its own cache lines:
+ * handles set up once and then only read; flags that the main thread, drain
+ * workers and the idle reaper write while the receiver polls them; the send
+ * mutex, which every writer takes per frame; and the receive path's per-frame
+ * state. A store to running from another core no longer invalidates the line
+ * holding the buffer's read position, and publishers taking the send mutex do
+ * not invalidate the flags the receiver polls.
+ * 
  * Thread safety: Protect with mutexes when accessed from multiple threads.
  */
 struct ClientConnection {
+    // Set up when the connection is created or attached, read-mostly afterwards
     SocketPtr socket;                    ///< Socket pointer
     std::thread receiveThread;            ///< Receive thread handle
-    std::atomic<bool> running{false};     ///< Thread should continue
-    std::atomic<bool> connected{false};   ///< Connection is active
-    MessageBuffer buffer;                 ///< Per-connection message buffer
+    std::shared_ptr<ShmChannel> shm;      ///< Shared-memory data path (set before shmAttached)
+    TxCompletionTrackerPtr txTracker;     ///< TX timestamp / zerocopy tracking (null unless enabled)
+    std::unique_ptr<ConflationQueue> conflation;  ///< Latest-value publish queue (null unless HFT_CONFLATE)
+    std::unique_ptr<RequestTracker> requests;  ///< Correlated requests awaiting a response (client connections with HFT_REQUEST_TIMEOUT_MS)
     int id;                               ///< Unique client identifier
+    size_t listener = 0;                  ///< Index of the accepting listener in HFT_LISTENERS (server sessions)
+
+    // Cross-thread flags
+    alignas(64) std::atomic<bool> running{false};  ///< Thread should continue
+    std::atomic<bool> connected{false};   ///< Connection is active
+    std::atomic<bool> shmAttached{false}; ///< Data flows over shm, socket only signals liveness
+    std::atomic<bool> idleReaped{false};     ///< Session was shut down by the idle timeout
+
+    // Outbound writers: publishers, conflation flushers, drain workers and the session itself
+    alignas(64) std::mutex sendMutex;     ///< Held for each whole frame written (see sendToConnection)
+
+    // Receive thread (or loop) state, written per inbound frame
+    alignas(64) MessageBuffer buffer;     ///< Per-connection message buffer
+    std::atomic<int64_t> lastActivityNs{0};  ///< steadyClockNs() of the last inbound frame (set when HFT_IDLE_TIMEOUT_MS is on)
+    SessionThrottle throttle;             ///< Inbound rate limits (server sessions, HFT_THROTTLE_*)
+    LatencyHistogram rxWakeup;            ///< Kernel RX timestamp to frame delivery (ns)
+
+    ConnectionMetrics traffic;            ///< Frame and byte counters served by the admin endpoint (inbound and outbound lines split)
     
     ClientConnection(int clientId);
     ~ClientConnection();
 };
 
 using ClientConnectionPtr = std::shared_ptr<ClientConnection>;
+
+/**
+ * @brief Creates a connection in slab (or on the heap if slab is null)
+ * 
+ * Each reactor that opens connections keeps its own slab, so the objects it
+ * creates are contiguous; see connection_slab.h.
+ */
+ClientConnectionPtr makeClientConnection(int clientId, const ConnectionSlabPtr& slab);
+
+/**
+ * @brief Enables TX timestamps and/or SO_ZEROCOPY on the connection's socket
+ * 
+ * Registers the tracker with txCompletionReader. Call before the first send.
+ * No-op unless HFT_TX_TIMESTAMPS or HFT_ZEROCOPY_THRESHOLD is set.
+ */
+void enableTxTracking(const ClientConnectionPtr& conn);
+
+/**
+ * @brief Sends framed message over the connection's active data path (shm or socket)
+ * 
+ * Socket frames at or above HFT_ZEROCOPY_THRESHOLD bytes use MSG_ZEROCOPY.
+ * The session's reader, publishers, conflation flushers and drain workers
+ * all write to the same connection, so every frame is written whole under
+ * conn->sendMutex; sendCorrelated() and asyncSendReply() take it too.
+ */
+bool sendToConnection(const ClientConnectionPtr& conn, const std::shared_ptr<const std::string>& message);
+
+/**
+ * @brief One non-blocking attempt to write message to a shared-memory session's ring
+ * 
+ * Fails at once, sending nothing, if the ring is full or another writer
+ * holds conn->sendMutex. Counts the frame like sendToConnection().
+ */
+bool trySendShm(const ClientConnectionPtr& conn, const std::string& message);
+
+/**
+ * @brief Sends a frame carrying type and correlationId in the header extension
+ * 
+ * Socket only: shared-memory frames have no extension.
+ */
+bool sendCorrelated(const ClientConnectionPtr& conn, const std::string& message, uint8_t type, uint64_t correlationId);
+
+/**
+ * @struct SessionReply
+ * @brief A frame a session owes its peer in answer to an inbound frame
+ * 
+ * Request handlers collect replies instead of writing them, so the session's
+ * reader picks the write: a receive thread blocks in sendReply(), a coroutine
+ * session co_awaits asyncSendReply() (async_io.h) and keeps its loop running.
+ */
+struct SessionReply {
+    std::shared_ptr<const std::string> message;
+    uint8_t type = 0;
+    uint64_t correlationId = 0;          ///< Non-zero: sent as a correlated frame (socket only)
+    std::shared_ptr<ShmChannel> attach;  ///< Data path to switch to once this reply is sent
+};
+
+using SessionReplies = std::vector<SessionReply>;
+
+/**
+ * @brief Sends reply with sendCorrelated() or sendToConnection(), blocking while the path is full
+ */
+bool sendReply(const ClientConnectionPtr& conn, const SessionReply& reply);
+
+/**
+ * @brief Sends message as a request and calls callback with the response
+ * 
+ * The callback runs on the connection's receive thread (or loop) once the
+ * peer echoes the correlation id, or with ok=false when the request times
+ * out or the connection closes. Needs conn->requests.
+ * 
+ * @return Correlation id, or 0 if the frame was not sent (callback not run)
+ */
+uint64_t sendRequest(const ClientConnectionPtr& conn, const std::string& message, uint8_t type,
+                     ResponseCallback callback);
+
+/**
+ * @brief Future-returning sendRequest; a frame that was not sent yields ok=false at once
+ */
+std::future<CorrelatedResponse> sendRequest(const ClientConnectionPtr& conn, const std::string& message,
+                                            uint8_t type);
+
+/**
+ * @brief Sends the latest value of each dirty symbol while the socket stays writable
+ * 
+ * Returns immediately if the connection does not conflate, nothing is dirty,
+ * or another thread is already flushing. Shared-memory sessions never block
+ * either: a frame the ring cannot take stays dirty (trySendShm()). Called by publishers and, for
+ * leftovers, by the session's receive thread.
+ * 
+ * @return Number of frames sent
+ */
+size_t flushConflated(const ClientConnectionPtr& conn);
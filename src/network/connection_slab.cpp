@@ -0,0 +1,62 @@
+#include "connection_slab.h"
+
+namespace {
+
+constexpr std::align_val_t SLOT_ALIGNMENT{ConnectionSlab::SLOT_ALIGN};
+
+size_t roundToSlot(size_t bytes) {
+    return (bytes + ConnectionSlab::SLOT_ALIGN - 1) & ~(ConnectionSlab::SLOT_ALIGN - 1);
+}
+
+} // namespace
+
+ConnectionSlab::~ConnectionSlab() {
+    for (void* chunk : chunks_) {
+        ::operator delete(chunk, SLOT_ALIGNMENT);
+    }
+}
+
+void* ConnectionSlab::allocate(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (slotSize_ == 0) {
+        slotSize_ = roundToSlot(bytes);
+    }
+    if (roundToSlot(bytes) != slotSize_) {
+        return ::operator new(bytes, SLOT_ALIGNMENT);
+    }
+    if (free_.empty()) {
+        auto* chunk = static_cast<std::byte*>(::operator new(slotSize_ * SLOTS_PER_CHUNK, SLOT_ALIGNMENT));
+        chunks_.push_back(chunk);
+        // Pushed in reverse so slots are handed out in address order
+        for (size_t i = SLOTS_PER_CHUNK; i-- > 0;) {
+            free_.push_back(chunk + i * slotSize_);
+        }
+    }
+    void* slot = free_.back();
+    free_.pop_back();
+    ++inUse_;
+    return slot;
+}
+
+void ConnectionSlab::deallocate(void* p, size_t bytes) {
+    if (!p) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (roundToSlot(bytes) != slotSize_) {
+        ::operator delete(p, SLOT_ALIGNMENT);
+        return;
+    }
+    free_.push_back(p);
+    --inUse_;
+}
+
+size_t ConnectionSlab::slotsInUse() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return inUse_;
+}
+
+size_t ConnectionSlab::capacity() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return chunks_.size() * SLOTS_PER_CHUNK;
+}
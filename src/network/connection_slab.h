@@ -0,0 +1,89 @@
+#pragma once
+
+/**
+ * @file connection_slab.h
+ * @brief Contiguous, cache-line aligned storage for ClientConnection objects
+ *
+ * make_shared puts every connection wherever the general-purpose heap finds
+ * room, interleaved with frame buffers and strings. A slab hands out
+ * fixed-size, 64-byte aligned slots carved from chunks of SLOTS_PER_CHUNK,
+ * so the connections one reactor (an accept thread, or the console) creates
+ * sit next to each other and walks over the session list stream through
+ * memory. Freed slots go on a LIFO free list: the next session reuses the
+ * most recently released (still cache-warm) slot.
+ *
+ * Chunks are only returned when the slab itself is destroyed; every
+ * allocation holds a reference to its slab, so the last session of a closed
+ * listener can still be freed safely.
+ */
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+/**
+ * @class ConnectionSlab
+ * @brief Fixed-slot allocator backing std::allocate_shared for connections
+ *
+ * Thread safety: allocate() and deallocate() lock; sessions are created by
+ * one thread but may be released by any.
+ */
+class ConnectionSlab {
+public:
+    static constexpr size_t SLOT_ALIGN = 64;
+    static constexpr size_t SLOTS_PER_CHUNK = 16;
+
+    ~ConnectionSlab();
+
+    /**
+     * @brief Returns a slot for bytes with at most SLOT_ALIGN alignment
+     *
+     * The first allocation fixes the slot size; requests of any other size
+     * fall back to aligned operator new.
+     */
+    void* allocate(size_t bytes);
+
+    void deallocate(void* p, size_t bytes);
+
+    size_t slotsInUse() const;
+    size_t capacity() const;   ///< Slots carved so far (in use + free)
+
+private:
+    mutable std::mutex mutex_;
+    size_t slotSize_ = 0;
+    std::vector<void*> chunks_;
+    std::vector<void*> free_;  ///< LIFO: most recently freed slot first
+    size_t inUse_ = 0;
+};
+
+using ConnectionSlabPtr = std::shared_ptr<ConnectionSlab>;
+
+/**
+ * @brief Allocator for std::allocate_shared that draws from a ConnectionSlab
+ *
+ * Holds a reference to the slab so it outlives every object placed in it.
+ */
+template<typename T>
+struct ConnectionSlabAllocator {
+    using value_type = T;
+
+    ConnectionSlabPtr slab;
+
+    explicit ConnectionSlabAllocator(ConnectionSlabPtr s) : slab(std::move(s)) {}
+    template<typename U>
+    ConnectionSlabAllocator(const ConnectionSlabAllocator<U>& other) : slab(other.slab) {}
+
+    T* allocate(size_t n) {
+        static_assert(alignof(T) <= ConnectionSlab::SLOT_ALIGN, "slot alignment too small");
+        return static_cast<T*>(slab->allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t n) { slab->deallocate(p, n * sizeof(T)); }
+
+    template<typename U>
+    bool operator==(const ConnectionSlabAllocator<U>& other) const { return slab == other.slab; }
+    template<typename U>
+    bool operator!=(const ConnectionSlabAllocator<U>& other) const { return slab != other.slab; }
+};
@@ -0,0 +1,171 @@
+#pragma once
+
+/**
+ * @file frame_header.h
+ * @brief Frame header policies for length-prefixed message framing
+ *
+ * Each policy describes one wire format as a type: header size and payload
+ * limit are constexpr and encode/decode are inline, so BasicMessageBuffer and
+ * the send functions instantiated with a policy contain no runtime branching
+ * on the header format.
+ *
+ * Policy interface:
+ * - HEADER_SIZE   Bytes preceding the payload
+ * - MAX_PAYLOAD   Largest payload accepted; larger (or invalid) lengths reset the stream
+ * - HAS_TYPE      Header carries a message type byte
+ * - payloadLength(header)  Decoded payload length, or INVALID_LENGTH
+ * - frameType(header)      Message type (0 if the format has none)
+ * - encode(header, payloadLength, type)
+ *
+ * Request/response correlation (NoCorrelation for formats without it):
+ * - EXTENSION_SIZE  Bytes between the header and the payload of a correlated frame
+ * - correlated(header)     Frame carries the extension
+ * - decodeExtension(extension, type, correlationId)
+ * - encodeCorrelated(header, payloadLength, type, correlationId)  Writes header and extension
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * @brief payloadLength() result for a header that cannot describe a valid frame
+ */
+constexpr size_t INVALID_LENGTH = SIZE_MAX;
+
+namespace frame_detail {
+
+constexpr bool HOST_LITTLE_ENDIAN = __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__;
+
+template<typename T>
+inline T load(const char* p) {
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+template<typename T>
+inline void store(char* p, T value) {
+    std::memcpy(p, &value, sizeof(T));
+}
+
+inline uint16_t swap(uint16_t v) { return __builtin_bswap16(v); }
+inline uint32_t swap(uint32_t v) { return __builtin_bswap32(v); }
+inline uint64_t swap(uint64_t v) { return __builtin_bswap64(v); }
+
+template<typename T>
+inline T fromBigEndian(T v) { return HOST_LITTLE_ENDIAN ? swap(v) : v; }
+
+template<typename T>
+inline T fromLittleEndian(T v) { return HOST_LITTLE_ENDIAN ? v : swap(v); }
+
+} // namespace frame_detail
+
+/**
+ * @struct NoCorrelation
+ * @brief Correlation hooks of formats that cannot carry a correlation id
+ */
+struct NoCorrelation {
+    static constexpr size_t EXTENSION_SIZE = 0;
+
+    static bool correlated(const char*) { return false; }
+    static void decodeExtension(const char*, uint8_t&, uint64_t&) {}
+    static void encodeCorrelated(char*, size_t, uint8_t, uint64_t) {}
+};
+
+/**
+ * @struct BigEndian32Header
+ * @brief [4 bytes: length (network byte order)][N bytes: payload] - the gateway's native format
+ *
+ * Correlated frames (requests expecting a matched response) set the top bit
+ * of the length, which no valid length uses, and insert [1 byte: type]
+ * [8 bytes: correlation id (big-endian)] before the payload. Plain frames are
+ * unchanged, so peers that never correlate see the original format.
+ */
+struct BigEndian32Header {
+    static constexpr size_t HEADER_SIZE = 4;
+    static constexpr size_t MAX_PAYLOAD = 1024 * 1024;
+    static constexpr bool HAS_TYPE = false;
+    static constexpr size_t EXTENSION_SIZE = 9;
+    static constexpr uint32_t CORRELATED_FLAG = 0x80000000u;
+
+    static size_t payloadLength(const char* header) {
+        return frame_detail::fromBigEndian(frame_detail::load<uint32_t>(header)) & ~CORRELATED_FLAG;
+    }
+    static uint8_t frameType(const char*) { return 0; }
+    static void encode(char* header, size_t payloadLength, uint8_t) {
+        frame_detail::store(header, frame_detail::fromBigEndian(static_cast<uint32_t>(payloadLength)));
+    }
+
+    static bool correlated(const char* header) {
+        return (frame_detail::fromBigEndian(frame_detail::load<uint32_t>(header)) & CORRELATED_FLAG) != 0;
+    }
+    static void decodeExtension(const char* extension, uint8_t& type, uint64_t& correlationId) {
+        type = static_cast<uint8_t>(extension[0]);
+        correlationId = frame_detail::fromBigEndian(frame_detail::load<uint64_t>(extension + 1));
+    }
+    static void encodeCorrelated(char* header, size_t payloadLength, uint8_t type, uint64_t correlationId) {
+        frame_detail::store(header, frame_detail::fromBigEndian(static_cast<uint32_t>(payloadLength) | CORRELATED_FLAG));
+        header[HEADER_SIZE] = static_cast<char>(type);
+        frame_detail::store(header + HEADER_SIZE + 1, frame_detail::fromBigEndian(correlationId));
+    }
+};
+
+/**
+ * @struct LittleEndian16Header
+ * @brief [2 bytes: length (little-endian)][N bytes: payload], payloads up to 64KB
+ */
+struct LittleEndian16Header : NoCorrelation {
+    static constexpr size_t HEADER_SIZE = 2;
+    static constexpr size_t MAX_PAYLOAD = UINT16_MAX;
+    static constexpr bool HAS_TYPE = false;
+
+    static size_t payloadLength(const char* header) {
+        return frame_detail::fromLittleEndian(frame_detail::load<uint16_t>(header));
+    }
+    static uint8_t frameType(const char*) { return 0; }
+    static void encode(char* header, size_t payloadLength, uint8_t) {
+        frame_detail::store(header, frame_detail::fromLittleEndian(static_cast<uint16_t>(payloadLength)));
+    }
+};
+
+/**
+ * @struct LittleEndian32Header
+ * @brief [4 bytes: length (little-endian)][N bytes: payload]
+ */
+struct LittleEndian32Header : NoCorrelation {
+    static constexpr size_t HEADER_SIZE = 4;
+    static constexpr size_t MAX_PAYLOAD = 1024 * 1024;
+    static constexpr bool HAS_TYPE = false;
+
+    static size_t payloadLength(const char* header) {
+        return frame_detail::fromLittleEndian(frame_detail::load<uint32_t>(header));
+    }
+    static uint8_t frameType(const char*) { return 0; }
+    static void encode(char* header, size_t payloadLength, uint8_t) {
+        frame_detail::store(header, frame_detail::fromLittleEndian(static_cast<uint32_t>(payloadLength)));
+    }
+};
+
+/**
+ * @struct LengthTypeHeader
+ * @brief [2 bytes: length (big-endian)][1 byte: type][N bytes: payload]
+ *
+ * SoupBinTCP-style: the length counts the type byte plus the payload, so a
+ * zero length is invalid.
+ */
+struct LengthTypeHeader : NoCorrelation {
+    static constexpr size_t HEADER_SIZE = 3;
+    static constexpr size_t MAX_PAYLOAD = UINT16_MAX - 1;
+    static constexpr bool HAS_TYPE = true;
+
+    static size_t payloadLength(const char* header) {
+        const size_t length = frame_detail::fromBigEndian(frame_detail::load<uint16_t>(header));
+        return length == 0 ? INVALID_LENGTH : length - 1;
+    }
+    static uint8_t frameType(const char* header) { return static_cast<uint8_t>(header[2]); }
+    static void encode(char* header, size_t payloadLength, uint8_t type) {
+        frame_detail::store(header, frame_detail::fromBigEndian(static_cast<uint16_t>(payloadLength + 1)));
+        header[2] = static_cast<char>(type);
+    }
+};
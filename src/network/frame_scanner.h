@@ -0,0 +1,108 @@
+#pragma once
+
+/**
+ * @file frame_scanner.h
+ * @brief Batch frame-boundary scanning over a contiguous receive buffer
+ *
+ * Frame boundaries form a dependency chain (each header's length gives the
+ * next header's offset), so a general stream cannot be split across SIMD
+ * lanes. Streams of many tiny frames are usually fixed-stride, though: every
+ * quote or ACK has the same size. The scanner decodes one header, guesses
+ * that the following frames have the same stride, and verifies that guess
+ * STRIDE_BLOCK headers at a time with a branch-free loop the compiler turns
+ * into vector compares. Offsets of a verified run are filled in with a
+ * second straight-line loop. The first header that differs ends the run and
+ * scanning continues one frame at a time until a new run starts.
+ */
+
+#include "frame_header.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @struct FrameSpan
+ * @brief One complete frame found by scanFrames()
+ */
+struct FrameSpan {
+    uint32_t offset;       ///< Header start, relative to the scanned data
+    uint32_t length;       ///< Payload length
+    uint32_t headerBytes;  ///< Header plus correlation extension; the payload starts at offset + headerBytes
+};
+
+/**
+ * @struct FrameScan
+ * @brief Result of scanFrames()
+ */
+struct FrameScan {
+    size_t frames = 0;     ///< Spans written
+    size_t bytes = 0;      ///< Bytes covered by those frames (offset of the first unscanned header)
+    bool invalid = false;  ///< Scan stopped at a header with an invalid or oversized length
+};
+
+namespace frame_detail {
+
+constexpr size_t STRIDE_BLOCK = 8;  ///< Headers verified per step of a fixed-stride run
+
+/**
+ * @brief Whether the STRIDE_BLOCK headers starting at first, stride bytes apart, all match length and extension
+ */
+template<typename Header>
+inline bool sameStride(const char* first, size_t stride, size_t length, bool correlated) {
+    uint32_t mismatch = 0;
+    for (size_t i = 0; i < STRIDE_BLOCK; ++i) {
+        const char* header = first + i * stride;
+        mismatch |= static_cast<uint32_t>(Header::payloadLength(header) != length) |
+                    static_cast<uint32_t>(Header::correlated(header) != correlated);
+    }
+    return mismatch == 0;
+}
+
+} // namespace frame_detail
+
+/**
+ * @brief Finds up to maxSpans complete frames at the start of data
+ *
+ * A trailing partial frame is left unscanned (bytes stops before it).
+ * Scanning stops at an invalid header; the frames before it are returned.
+ */
+template<typename Header>
+FrameScan scanFrames(const char* data, size_t len, FrameSpan* spans, size_t maxSpans) {
+    FrameScan scan;
+    size_t pos = 0;
+    while (scan.frames < maxSpans && len - pos >= Header::HEADER_SIZE) {
+        const char* header = data + pos;
+        const size_t length = Header::payloadLength(header);
+        if (length > Header::MAX_PAYLOAD) {
+            scan.invalid = true;
+            break;
+        }
+        const bool correlated = Header::correlated(header);
+        const size_t headerBytes = Header::HEADER_SIZE + (correlated ? Header::EXTENSION_SIZE : 0);
+        const size_t stride = headerBytes + length;
+        if (len - pos < stride) {
+            break;  // Incomplete frame
+        }
+
+        // Frames that would fit if the stream were fixed-stride from here
+        const size_t room = std::min((len - pos) / stride, maxSpans - scan.frames);
+        size_t run = 1;
+        if (room > frame_detail::STRIDE_BLOCK && Header::payloadLength(header + stride) == length) {
+            while (run + frame_detail::STRIDE_BLOCK <= room &&
+                   frame_detail::sameStride<Header>(header + run * stride, stride, length, correlated)) {
+                run += frame_detail::STRIDE_BLOCK;
+            }
+        }
+
+        FrameSpan* out = spans + scan.frames;
+        for (size_t i = 0; i < run; ++i) {
+            out[i].offset = static_cast<uint32_t>(pos + i * stride);
+            out[i].length = static_cast<uint32_t>(length);
+            out[i].headerBytes = static_cast<uint32_t>(headerBytes);
+        }
+        scan.frames += run;
+        pos += run * stride;
+    }
+    scan.bytes = pos;
+    return scan;
+}
@@ -0,0 +1,193 @@
+#include "hdr_histogram.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+HdrHistogram::HdrHistogram(int64_t highestTrackable, int significantDigits)
+    : highestTrackable_(std::max<int64_t>(highestTrackable, 2)),
+      significantDigits_(std::clamp(significantDigits, 1, 5)) {
+    // Enough linear sub-buckets that one unit step is within the requested precision
+    const int64_t largestSingleUnitValue = 2 * static_cast<int64_t>(std::pow(10, significantDigits_));
+    const int subBucketCountMagnitude = static_cast<int>(std::ceil(std::log2(static_cast<double>(largestSingleUnitValue))));
+    subBucketHalfCountMagnitude_ = std::max(subBucketCountMagnitude, 1) - 1;
+    subBucketCount_ = int64_t{1} << (subBucketHalfCountMagnitude_ + 1);
+    subBucketHalfCount_ = subBucketCount_ / 2;
+    subBucketMask_ = subBucketCount_ - 1;
+
+    // Each further bucket doubles the range
+    int64_t smallestUntrackable = subBucketCount_;
+    bucketCount_ = 1;
+    while (smallestUntrackable <= highestTrackable_) {
+        if (smallestUntrackable > INT64_MAX / 2) {
+            ++bucketCount_;
+            break;
+        }
+        smallestUntrackable <<= 1;
+        ++bucketCount_;
+    }
+    counts_.assign(static_cast<size_t>((bucketCount_ + 1) * subBucketHalfCount_), 0);
+}
+
+size_t HdrHistogram::countsIndex(int64_t value) const {
+    const int pow2Ceiling = 64 - __builtin_clzll(static_cast<uint64_t>(value | subBucketMask_));
+    const int bucketIndex = pow2Ceiling - (subBucketHalfCountMagnitude_ + 1);
+    const int64_t subBucketIndex = value >> bucketIndex;
+    // Bucket 0 uses all its sub-buckets; later ones only their upper half
+    return static_cast<size_t>((static_cast<int64_t>(bucketIndex + 1) << subBucketHalfCountMagnitude_) +
+                               (subBucketIndex - subBucketHalfCount_));
+}
+
+int64_t HdrHistogram::valueFromIndex(size_t index) const {
+    int bucketIndex = static_cast<int>(index >> subBucketHalfCountMagnitude_) - 1;
+    int64_t subBucketIndex = static_cast<int64_t>(index & static_cast<size_t>(subBucketHalfCount_ - 1)) +
+                             subBucketHalfCount_;
+    if (bucketIndex < 0) {
+        subBucketIndex -= subBucketHalfCount_;
+        bucketIndex = 0;
+    }
+    return subBucketIndex << bucketIndex;
+}
+
+int64_t HdrHistogram::highestEquivalentValue(int64_t value) const {
+    const int pow2Ceiling = 64 - __builtin_clzll(static_cast<uint64_t>(value | subBucketMask_));
+    const int bucketIndex = pow2Ceiling - (subBucketHalfCountMagnitude_ + 1);
+    const int64_t subBucketIndex = value >> bucketIndex;
+    const int64_t lowest = subBucketIndex << bucketIndex;
+    const int64_t range = int64_t{1} << (bucketIndex + (subBucketIndex >= subBucketCount_ ? 1 : 0));
+    return lowest + range - 1;
+}
+
+int64_t HdrHistogram::midpointValue(int64_t value) const {
+    const int pow2Ceiling = 64 - __builtin_clzll(static_cast<uint64_t>(value | subBucketMask_));
+    const int bucketIndex = pow2Ceiling - (subBucketHalfCountMagnitude_ + 1);
+    const int64_t subBucketIndex = value >> bucketIndex;
+    return (subBucketIndex << bucketIndex) + ((int64_t{1} << bucketIndex) >> 1);
+}
+
+void HdrHistogram::record(int64_t value, uint64_t count) {
+    if (value < 0) {
+        value = 0;
+    }
+    if (value > highestTrackable_) {
+        value = highestTrackable_;
+        clamped_ += count;
+    }
+    counts_[countsIndex(value)] += count;
+    total_ += count;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+}
+
+bool HdrHistogram::add(const HdrHistogram& other) {
+    if (other.counts_.size() != counts_.size() || other.subBucketCount_ != subBucketCount_) {
+        return false;
+    }
+    for (size_t i = 0; i < counts_.size(); ++i) {
+        counts_[i] += other.counts_[i];
+    }
+    total_ += other.total_;
+    clamped_ += other.clamped_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+    return true;
+}
+
+void HdrHistogram::reset() {
+    std::fill(counts_.begin(), counts_.end(), 0);
+    total_ = 0;
+    clamped_ = 0;
+    min_ = INT64_MAX;
+    max_ = 0;
+}
+
+double HdrHistogram::mean() const {
+    if (total_ == 0) {
+        return 0;
+    }
+    double sum = 0;
+    for (size_t i = 0; i < counts_.size(); ++i) {
+        if (counts_[i]) {
+            sum += static_cast<double>(midpointValue(valueFromIndex(i))) * static_cast<double>(counts_[i]);
+        }
+    }
+    return sum / static_cast<double>(total_);
+}
+
+double HdrHistogram::stddev() const {
+    if (total_ == 0) {
+        return 0;
+    }
+    const double average = mean();
+    double squares = 0;
+    for (size_t i = 0; i < counts_.size(); ++i) {
+        if (counts_[i]) {
+            const double deviation = static_cast<double>(midpointValue(valueFromIndex(i))) - average;
+            squares += deviation * deviation * static_cast<double>(counts_[i]);
+        }
+    }
+    return std::sqrt(squares / static_cast<double>(total_));
+}
+
+int64_t HdrHistogram::valueAtPercentile(double p) const {
+    if (total_ == 0) {
+        return 0;
+    }
+    const double clampedPercentile = std::clamp(p, 0.0, 100.0);
+    uint64_t target = static_cast<uint64_t>(clampedPercentile / 100.0 * static_cast<double>(total_) + 0.5);
+    target = std::max<uint64_t>(target, 1);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts_.size(); ++i) {
+        seen += counts_[i];
+        if (seen >= target) {
+            return std::min(highestEquivalentValue(valueFromIndex(i)), max_);
+        }
+    }
+    return max_;
+}
+
+std::string HdrHistogram::percentileSpectrum(double unitScale, int ticksPerHalfDistance) const {
+    std::string out;
+    char line[128];
+    std::snprintf(line, sizeof(line), "%12s %14s %10s %14s\n\n", "Value", "Percentile", "TotalCount",
+                  "1/(1-Percentile)");
+    out += line;
+
+    ticksPerHalfDistance = std::max(ticksPerHalfDistance, 1);
+    uint64_t seen = 0;
+    double nextPercentile = 0;
+    for (size_t i = 0; i < counts_.size() && total_ > 0; ++i) {
+        if (!counts_[i]) {
+            continue;
+        }
+        seen += counts_[i];
+        const double value = static_cast<double>(std::min(highestEquivalentValue(valueFromIndex(i)), max_)) /
+                             unitScale;
+        if (seen == total_) {
+            std::snprintf(line, sizeof(line), "%12.3f %14.12f %10llu\n", value, 1.0,
+                          static_cast<unsigned long long>(seen));
+            out += line;
+            break;
+        }
+        // One row per percentile tick this bucket reaches
+        const double reached = 100.0 * static_cast<double>(seen) / static_cast<double>(total_);
+        while (nextPercentile <= reached) {
+            std::snprintf(line, sizeof(line), "%12.3f %14.12f %10llu %14.2f\n", value, nextPercentile / 100.0,
+                          static_cast<unsigned long long>(seen), 100.0 / (100.0 - nextPercentile));
+            out += line;
+            // Ticks get closer together as the remaining distance to 100% halves
+            const double halvings = std::floor(std::log2(100.0 / (100.0 - nextPercentile))) + 1;
+            nextPercentile += 100.0 / (std::pow(2.0, halvings) * ticksPerHalfDistance);
+        }
+    }
+
+    std::snprintf(line, sizeof(line), "#[Mean    = %12.3f, StdDeviation   = %12.3f]\n", mean() / unitScale,
+                  stddev() / unitScale);
+    out += line;
+    std::snprintf(line, sizeof(line), "#[Max     = %12.3f, Total count    = %12llu]\n", max_ / unitScale,
+                  static_cast<unsigned long long>(total_));
+    out += line;
+    std::snprintf(line, sizeof(line), "#[Buckets = %12d, SubBuckets     = %12lld]\n", bucketCount_,
+                  static_cast<long long>(subBucketCount_));
+    out += line;
+    return out;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+/**
+ * @file hdr_histogram.h
+ * @brief High dynamic range histogram for benchmark latencies
+ *
+ * Same bucket layout as HdrHistogram: each power of two is split into
+ * 2 * 10^digits linear sub-buckets, so every value up to the highest
+ * trackable one is kept to the configured number of significant decimal
+ * digits (3 digits: 1us resolution at 1ms, 1ms at 1s). Unlike the 8-way
+ * LatencyHistogram this is precise enough to report p99.9 and beyond.
+ *
+ * Counts are plain integers: give each recording thread its own histogram
+ * and add() them together once the threads are done.
+ */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @class HdrHistogram
+ * @brief Value distribution with fixed relative precision and percentile spectrum output
+ */
+class HdrHistogram {
+public:
+    static constexpr int64_t DEFAULT_HIGHEST_NS = 3600LL * 1000000000;  ///< One hour
+
+    /**
+     * @param highestTrackable Largest value kept exactly; larger ones are clamped to it
+     * @param significantDigits Decimal digits of precision (1-5)
+     */
+    explicit HdrHistogram(int64_t highestTrackable = DEFAULT_HIGHEST_NS, int significantDigits = 3);
+
+    /**
+     * @brief Records value (clamped to 0..highestTrackable)
+     */
+    void record(int64_t value, uint64_t count = 1);
+
+    /**
+     * @brief Adds every sample of other (must have the same range and precision)
+     *
+     * @return false if the layouts differ
+     */
+    bool add(const HdrHistogram& other);
+
+    void reset();
+
+    uint64_t count() const { return total_; }
+    uint64_t clamped() const { return clamped_; }  ///< Samples above highestTrackable
+    int64_t min() const { return total_ ? min_ : 0; }
+    int64_t max() const { return max_; }
+    double mean() const;
+    double stddev() const;
+
+    /**
+     * @brief Highest value equivalent to the sample at percentile p (0-100)
+     */
+    int64_t valueAtPercentile(double p) const;
+
+    /**
+     * @brief Percentile distribution in HdrHistogram's .hgrm text format
+     *
+     * Rows of value, percentile, cumulative count and 1/(1-percentile), at
+     * ticksPerHalfDistance rows per halving of the distance to 100%, so the
+     * tail is resolved as finely as the body. Loads into the standard HDR
+     * percentile plotters.
+     *
+     * @param unitScale Values are divided by this (1000: ns -> us)
+     */
+    std::string percentileSpectrum(double unitScale = 1000.0, int ticksPerHalfDistance = 5) const;
+
+private:
+    int64_t highestTrackable_;
+    int significantDigits_;
+    int subBucketHalfCountMagnitude_;
+    int64_t subBucketCount_;
+    int64_t subBucketHalfCount_;
+    int64_t subBucketMask_;
+    int bucketCount_;
+    std::vector<uint64_t> counts_;
+    uint64_t total_ = 0;
+    uint64_t clamped_ = 0;
+    int64_t min_ = INT64_MAX;
+    int64_t max_ = 0;
+
+    size_t countsIndex(int64_t value) const;
+    int64_t valueFromIndex(size_t index) const;
+    int64_t highestEquivalentValue(int64_t value) const;
+    int64_t midpointValue(int64_t value) const;
+};
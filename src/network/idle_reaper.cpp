@@ -0,0 +1,110 @@
+#include "idle_reaper.h"
+#include "../logging/logger.h"
+#include "../metrics/metrics.h"
+#include "../util/tsc_clock.h"
+#include <chrono>
+#include <sys/socket.h>
+
+IdleReaper idleReaper;
+
+int64_t checkIdleSession(ClientConnection& conn, int64_t nowNs, int64_t timeoutNs) {
+    if (!conn.running || !conn.connected) {
+        return 0;
+    }
+    const int64_t lastNs = conn.lastActivityNs.load(std::memory_order_relaxed);
+    if (nowNs < lastNs + timeoutNs) {
+        return lastNs + timeoutNs;
+    }
+
+    // Shutting the socket down wakes the receive loop with EOF; it cleans up from there
+    conn.idleReaped = true;
+    LOG_WARN("Session {} idle for {}ms, reaping", conn.id, (nowNs - lastNs) / 1000000);
+    if (conn.socket && *conn.socket >= 0) {
+        shutdown(*conn.socket, SHUT_RDWR);
+    }
+    return 0;
+}
+
+void recordReapedSession(ClientConnection& conn) {
+    const size_t bufferBytes = conn.buffer.release();
+    metrics.add(Counter::SessionsReaped);
+    metrics.add(Counter::ReapedBufferBytes, bufferBytes);
+    LOG_INFO("Session {} reaped, {} buffer bytes released", conn.id, bufferBytes);
+    receivedMessages.push("System", "Client " + std::to_string(conn.id) + " reaped after idle timeout", conn.id);
+}
+
+IdleReaper::~IdleReaper() {
+    stop();
+}
+
+bool IdleReaper::start(int64_t timeoutNs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (thread_.joinable()) {
+        return true;
+    }
+    if (timeoutNs <= 0) {
+        return false;
+    }
+    timeoutNs_ = timeoutNs;
+    wheel_ = std::make_unique<TimerWheel>(TICK_NS, static_cast<int64_t>(steadyClockNs()));
+    stopping_ = false;
+    thread_ = std::thread(&IdleReaper::run, this);
+    return true;
+}
+
+void IdleReaper::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wakeup_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    watches_.clear();   // Cancels the timers while the wheel still exists
+    wheel_.reset();
+}
+
+void IdleReaper::watch(const ClientConnectionPtr& conn) {
+    if (!conn) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!wheel_) {
+            return;
+        }
+        Watch& entry = watches_.emplace_back();
+        entry.owner = this;
+        entry.conn = conn;
+        entry.self = std::prev(watches_.end());
+        wheel_->schedule(entry.timer, conn->lastActivityNs.load(std::memory_order_relaxed) + timeoutNs_);
+    }
+    wakeup_.notify_one();
+}
+
+void IdleReaper::Watch::expired(void* context) {
+    // Runs inside wheel_->advance() with mutex_ held
+    auto* entry = static_cast<Watch*>(context);
+    IdleReaper* owner = entry->owner;
+    const ClientConnectionPtr conn = entry->conn.lock();
+    const int64_t nextCheckNs = conn ? checkIdleSession(*conn, static_cast<int64_t>(steadyClockNs()),
+                                                        owner->timeoutNs_) : 0;
+    if (nextCheckNs) {
+        owner->wheel_->schedule(entry->timer, nextCheckNs);
+    } else {
+        owner->watches_.erase(entry->self);
+    }
+}
+
+void IdleReaper::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        const int64_t nowNs = static_cast<int64_t>(steadyClockNs());
+        wheel_->advance(nowNs);
+        const int64_t nextNs = wheel_->nextTimeoutNs(nowNs);
+        const int64_t sleepNs = (nextNs < 0 || nextNs > MAX_SLEEP_NS) ? MAX_SLEEP_NS : nextNs;
+        wakeup_.wait_for(lock, std::chrono::nanoseconds(sleepNs));
+    }
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+/**
+ * @file idle_reaper.h
+ * @brief Application-level idle timeout for server sessions
+ *
+ * Sessions stamp lastActivityNs on every inbound frame; nothing is armed or
+ * re-armed per frame. Each session has one timer set to lastActivity +
+ * timeout. When it fires, the session is either reaped (socket shut down, so
+ * its receive loop sees EOF and exits) or the timer is moved to the new
+ * deadline. A session is therefore reaped between timeout and timeout + one
+ * tick after its last frame, with no per-connection polling.
+ *
+ * Coroutine sessions keep their timer on their EventLoop's wheel; threaded
+ * sessions are watched by the global idleReaper thread.
+ */
+
+#include "connection.h"
+#include "../async/timer_wheel.h"
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/**
+ * @brief Reaps conn if it has been idle for timeoutNs
+ *
+ * @return 0 if the session was reaped or has already ended, otherwise the
+ *         steadyClockNs() deadline at which to check again
+ */
+int64_t checkIdleSession(ClientConnection& conn, int64_t nowNs, int64_t timeoutNs);
+
+/**
+ * @brief Counts what a reaped session gave back (call once its receive loop has exited)
+ */
+void recordReapedSession(ClientConnection& conn);
+
+/**
+ * @class IdleReaper
+ * @brief Thread driving idle timers for threaded sessions from one TimerWheel
+ *
+ * Thread safety: watch() may be called from any thread.
+ */
+class IdleReaper {
+public:
+    ~IdleReaper();
+
+    /**
+     * @brief Starts the reaper thread (no-op if running or timeoutNs <= 0)
+     */
+    bool start(int64_t timeoutNs);
+
+    /**
+     * @brief Stops the thread and forgets every watched session
+     */
+    void stop();
+
+    bool running() const { return thread_.joinable(); }
+
+    /**
+     * @brief Starts timing conn's inactivity; the watch ends when the session does
+     */
+    void watch(const ClientConnectionPtr& conn);
+
+private:
+    struct Watch {
+        IdleReaper* owner;
+        std::weak_ptr<ClientConnection> conn;
+        std::list<Watch>::iterator self;
+        TimerNode timer{&Watch::expired, this};
+
+        static void expired(void* context);
+    };
+
+    static constexpr int64_t TICK_NS = 10000000;     ///< Reaping granularity
+    static constexpr int64_t MAX_SLEEP_NS = 100000000;
+
+    int64_t timeoutNs_ = 0;
+    std::thread thread_;
+    std::mutex mutex_;                  ///< Guards everything below
+    std::condition_variable wakeup_;
+    bool stopping_ = false;
+    std::unique_ptr<TimerWheel> wheel_;
+    std::list<Watch> watches_;          ///< Stable addresses for the intrusive timers
+
+    void run();
+};
+
+/**
+ * @brief Reaper for threaded sessions (started by main when HFT_IDLE_TIMEOUT_MS is set)
+ */
+extern IdleReaper idleReaper;
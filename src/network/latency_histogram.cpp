@@ -0,0 +1,88 @@
+#include "latency_histogram.h"
+#include <cstdio>
+
+size_t LatencyHistogram::bucketIndex(uint64_t value) {
+    // Values below 16 map linearly; above, keep the top 4 bits of each power of two
+    if (value < (2u << SUB_BUCKET_BITS)) {
+        return static_cast<size_t>(value);
+    }
+    const int msb = 63 - __builtin_clzll(value);
+    const int shift = msb - SUB_BUCKET_BITS;
+    return (static_cast<size_t>(shift) << SUB_BUCKET_BITS) + static_cast<size_t>(value >> shift);
+}
+
+int64_t LatencyHistogram::bucketUpperBound(size_t index) {
+    if (index < (2u << SUB_BUCKET_BITS)) {
+        return static_cast<int64_t>(index);
+    }
+    const int shift = static_cast<int>(index >> SUB_BUCKET_BITS) - 1;
+    const uint64_t top = (index & ((1u << SUB_BUCKET_BITS) - 1)) + (1u << SUB_BUCKET_BITS);
+    const uint64_t upper = ((top + 1) << shift) - 1;
+    return upper > static_cast<uint64_t>(INT64_MAX) ? INT64_MAX : static_cast<int64_t>(upper);
+}
+
+void LatencyHistogram::record(int64_t valueNs) {
+    if (valueNs < 0) {
+        valueNs = 0;
+    }
+    buckets_[bucketIndex(static_cast<uint64_t>(valueNs))].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(static_cast<uint64_t>(valueNs), std::memory_order_relaxed);
+    
+    int64_t current = min_.load(std::memory_order_relaxed);
+    while (valueNs < current && !min_.compare_exchange_weak(current, valueNs, std::memory_order_relaxed)) {
+    }
+    current = max_.load(std::memory_order_relaxed);
+    while (valueNs > current && !max_.compare_exchange_weak(current, valueNs, std::memory_order_relaxed)) {
+    }
+}
+
+int64_t LatencyHistogram::min() const {
+    return count() ? min_.load(std::memory_order_relaxed) : 0;
+}
+
+int64_t LatencyHistogram::mean() const {
+    const uint64_t n = count();
+    return n ? static_cast<int64_t>(sum() / n) : 0;
+}
+
+int64_t LatencyHistogram::percentile(double p) const {
+    const uint64_t n = count();
+    if (n == 0) {
+        return 0;
+    }
+    uint64_t target = static_cast<uint64_t>(p / 100.0 * static_cast<double>(n) + 0.5);
+    if (target == 0) {
+        target = 1;
+    }
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        seen += buckets_[i].load(std::memory_order_relaxed);
+        if (seen >= target) {
+            // Bucket bound can overshoot the true maximum
+            const int64_t bound = bucketUpperBound(i);
+            return bound < max() ? bound : max();
+        }
+    }
+    return max();
+}
+
+void LatencyHistogram::reset() {
+    for (auto& bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    min_.store(INT64_MAX, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+std::string LatencyHistogram::summary() const {
+    char text[192];
+    std::snprintf(text, sizeof(text),
+                  "n=%llu min=%.1fus p50=%.1fus p99=%.1fus p99.9=%.1fus max=%.1fus",
+                  static_cast<unsigned long long>(count()),
+                  min() / 1000.0, percentile(50) / 1000.0, percentile(99) / 1000.0,
+                  percentile(99.9) / 1000.0, max() / 1000.0);
+    return text;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+/**
+ * @file latency_histogram.h
+ * @brief Lock-free log-linear latency histogram
+ * 
+ * Buckets cover 0ns to 2^63ns with 8 sub-buckets per power of two
+ * (~12.5% worst-case relative error). Recording is a handful of relaxed
+ * atomic operations, so hot threads can record while others read.
+ */
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+/**
+ * @class LatencyHistogram
+ * @brief Distribution of nanosecond latencies with percentile queries
+ */
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BUCKET_BITS = 3;
+    static constexpr size_t BUCKET_COUNT = 64 << SUB_BUCKET_BITS;
+    
+    /**
+     * @brief Records one sample (negative values are clamped to 0)
+     */
+    void record(int64_t valueNs);
+    
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t sum() const { return sum_.load(std::memory_order_relaxed); }  ///< Total of all samples (ns)
+    int64_t min() const;
+    int64_t max() const { return max_.load(std::memory_order_relaxed); }
+    int64_t mean() const;
+    
+    /**
+     * @brief Upper bound of the bucket holding the given percentile (0-100)
+     */
+    int64_t percentile(double p) const;
+    
+    void reset();
+    
+    /**
+     * @brief One-line summary: "n=... min=... p50=... p99=... p99.9=... max=..." (microseconds)
+     */
+    std::string summary() const;
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets_{};  ///< Sample counts per bucket
+    std::atomic<uint64_t> count_{0};                           ///< Total samples
+    std::atomic<uint64_t> sum_{0};                             ///< Sum of samples (ns)
+    std::atomic<int64_t> min_{INT64_MAX};                      ///< Smallest sample
+    std::atomic<int64_t> max_{0};                              ///< Largest sample
+    
+    static size_t bucketIndex(uint64_t value);
+    static int64_t bucketUpperBound(size_t index);
+};
@@ -1,82 +1,181 @@
 #include "message.h"
+#include "tx_completion.h"
+#include "../metrics/metrics.h"
+#include "../util/tsc_clock.h"
 #include <cstring>
 #include <cerrno>
-#include <vector>
 #include <sys/poll.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <ctime>
 
 MessageQueue receivedMessages;
 
-bool MessageBuffer::addData(const char* data, size_t len) {
+namespace {
+
+int64_t timespecNs(const timespec& ts) {
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief Extracts RX timestamps from recvmsg() control messages
+ */
+void parseRxTimestamps(msghdr& msg, RxTimestamp& timestamp) {
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET) {
+            continue;
+        }
+        #ifdef SCM_TIMESTAMPING
+        if (cmsg->cmsg_type == SCM_TIMESTAMPING) {
+            // [0] software, [1] deprecated, [2] raw hardware
+            timespec stamps[3];
+            std::memcpy(stamps, CMSG_DATA(cmsg), sizeof(stamps));
+            timestamp.kernelNs = timespecNs(stamps[0]);
+            timestamp.hardwareNs = timespecNs(stamps[2]);
+            continue;
+        }
+        #endif
+        #ifdef SCM_TIMESTAMPNS
+        if (cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+            timespec stamp;
+            std::memcpy(&stamp, CMSG_DATA(cmsg), sizeof(stamp));
+            timestamp.kernelNs = timespecNs(stamp);
+        }
+        #endif
+    }
+}
+
+} // namespace
+
+template<typename Header>
+bool BasicMessageBuffer<Header>::addData(const char* data, size_t len, const RxTimestamp* timestamp) {
     compactIfNeeded();
     buffer_.append(data, len);
+    bytesAdded_ += len;
+    if (timestamp && timestamp->kernelNs) {
+        chunkTimestamps_.emplace_back(bytesAdded_, *timestamp);
+    }
     return true;
 }
 
-bool MessageBuffer::extractMessage(std::string& message) {
-    const size_t available = buffer_.size() - readPos_;
-    
-    if (available < 4) {
-        return false; // Need 4 bytes for length header
+template<typename Header>
+bool BasicMessageBuffer<Header>::extractMessage(std::string& message, RxTimestamp* timestamp) {
+    if (indexNext_ == indexCount_) {
+        // Index every complete frame buffered so far (header decode inlined per policy)
+        const FrameScan scan = scanFrames<Header>(buffer_.data() + readPos_, buffer_.size() - readPos_,
+                                                  index_.data(), FRAME_BATCH);
+        indexCount_ = scan.frames;
+        indexNext_ = 0;
+        if (scan.frames == 0) {
+            // Reject invalid or oversized frames to prevent memory exhaustion
+            if (scan.invalid) {
+                metrics.add(Counter::FramesDropped);
+                clear();
+            }
+            return false; // Need the full header, or the message is incomplete
+        }
     }
     
-    // Read length field (network byte order)
-    uint32_t length;
-    std::memcpy(&length, buffer_.data() + readPos_, 4);
-    length = ntohl(length);
-    
-    // Reject messages > 1MB to prevent memory exhaustion
-    if (length > 1024 * 1024) {
-        clear();
-        return false;
+    // Frames are extracted in order, so the current one always starts at readPos_
+    const FrameSpan& span = index_[indexNext_];
+    const char* header = buffer_.data() + readPos_;
+    if (indexNext_ + PREFETCH_AHEAD < indexCount_) {
+        // Offsets are relative to a scan start that compaction may have moved; only their differences hold
+        __builtin_prefetch(header + (index_[indexNext_ + PREFETCH_AHEAD].offset - span.offset));
     }
+    ++indexNext_;
     
-    if (available < 4 + length) {
-        return false; // Incomplete message
+    // Correlated frames carry type and correlation id between header and payload
+    frameType_ = Header::frameType(header);
+    correlationId_ = 0;
+    if (span.headerBytes > HEADER_SIZE) {
+        Header::decodeExtension(header + HEADER_SIZE, frameType_, correlationId_);
     }
+    const size_t length = span.length;
+    message.assign(header + span.headerBytes, length);
+    readPos_ += span.headerBytes + length;
+    bytesConsumed_ += span.headerBytes + length;
     
-    message.assign(buffer_.data() + readPos_ + 4, length);
-    readPos_ += 4 + length;
+    // Frame takes the timestamp of the chunk holding its last byte
+    while (!chunkTimestamps_.empty() && chunkTimestamps_.front().first < bytesConsumed_) {
+        chunkTimestamps_.pop_front();
+    }
+    if (timestamp) {
+        *timestamp = chunkTimestamps_.empty() ? RxTimestamp() : chunkTimestamps_.front().second;
+    }
+    metrics.add(Counter::FramesIn);
+    metrics.add(Counter::BytesIn, length);
     compactIfNeeded();
     
     return true;
 }
 
-void MessageBuffer::clear() {
+template<typename Header>
+void BasicMessageBuffer<Header>::clear() {
     buffer_.clear();
     readPos_ = 0;
+    indexCount_ = 0;
+    indexNext_ = 0;
+    bytesConsumed_ = bytesAdded_;
+    chunkTimestamps_.clear();
 }
 
-void MessageBuffer::compactIfNeeded() {
+template<typename Header>
+size_t BasicMessageBuffer<Header>::release() {
+    const size_t released = buffer_.capacity();
+    clear();
+    std::string().swap(buffer_);
+    chunkTimestamps_.shrink_to_fit();
+    return released;
+}
+
+template<typename Header>
+void BasicMessageBuffer<Header>::compactIfNeeded() {
     // Compact when readPos_ > half buffer size or buffer > 1MB
     if (readPos_ > 0 && (readPos_ > buffer_.size() / 2 || buffer_.size() > 1024 * 1024)) {
         buffer_.erase(0, readPos_);
         readPos_ = 0;
+        metrics.add(Counter::BufferCompactions);
     }
 }
 
 
-void MessageQueue::push(const std::string& source, const std::string& message) {
+void MessageQueue::push(const std::string& source, const std::string& message, int session) {
+    const int64_t timestampNs = realtimeNs();
     std::lock_guard<std::mutex> lock(mutex_);
-    messages_.push({source, message});
+    messages_.push({source, message, session, timestampNs});
 }
 
 bool MessageQueue::pop(std::string& source, std::string& message) {
+    int session;
+    int64_t timestampNs;
+    return pop(source, message, session, timestampNs);
+}
+
+bool MessageQueue::pop(std::string& source, std::string& message, int& session, int64_t& timestampNs) {
     std::lock_guard<std::mutex> lock(mutex_);
     
     if (messages_.empty()) {
         return false;
     }
     
-    auto msg = messages_.front();
+    QueuedMessage& msg = messages_.front();
+    source = std::move(msg.source);
+    message = std::move(msg.message);
+    session = msg.session;
+    timestampNs = msg.timestampNs;
     messages_.pop();
-    source = msg.first;
-    message = msg.second;
     return true;
 }
 
+size_t MessageQueue::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return messages_.size();
+}
+
 void MessageQueue::clear() {
     std::lock_guard<std::mutex> lock(mutex_);
     while (!messages_.empty()) {
@@ -85,16 +184,31 @@ void MessageQueue::clear() {
 }
 
 
-bool sendFramedMessage(int socketFd, const std::string& message) {
-    if (socketFd < 0 || message.empty()) {
+template<typename Header>
+std::string encodeFrame(const std::string& message, uint8_t type, uint64_t correlationId) {
+    // Frame: [header][extension if correlated][N bytes: payload]
+    const size_t headerSize = Header::HEADER_SIZE + (correlationId ? Header::EXTENSION_SIZE : 0);
+    std::string framed(headerSize, '\0');
+    framed.reserve(headerSize + message.size());
+    if (correlationId) {
+        Header::encodeCorrelated(&framed[0], message.size(), type, correlationId);
+    } else {
+        Header::encode(&framed[0], message.size(), type);
+    }
+    framed.append(message);
+    return framed;
+}
+
+template<typename Header>
+bool sendFramedMessage(int socketFd, const std::string& message, TxCompletionTracker* tracker, uint8_t type,
+                       uint64_t correlationId) {
+    if (socketFd < 0 || message.empty() || message.size() > Header::MAX_PAYLOAD ||
+        (correlationId && Header::EXTENSION_SIZE == 0)) {
         return false;
     }
     
-    // Frame: [4 bytes: length (network byte order)][N bytes: payload]
-    uint32_t length = htonl(static_cast<uint32_t>(message.size()));
-    std::vector<char> framed(4 + message.size());
-    std::memcpy(framed.data(), &length, 4);
-    std::memcpy(framed.data() + 4, message.data(), message.size());
+    const int64_t userNs = tracker ? realtimeNs() : 0;
+    const std::string framed = encodeFrame<Header>(message, type, correlationId);
     
     // Handle partial writes (non-blocking sockets)
     size_t bytesSent = 0;
@@ -128,47 +242,165 @@ bool sendFramedMessage(int socketFd, const std::string& message) {
             if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
                 continue;
             }
+            if (tracker) {
+                tracker->recordSend(bytesSent, userNs);  // Keep byte offsets aligned with the kernel
+            }
             return false;
         }
         bytesSent += static_cast<size_t>(sent);
     }
     
+    if (tracker) {
+        tracker->recordSend(bytesSent, userNs);
+    }
+    metrics.add(Counter::FramesOut);
+    metrics.add(Counter::BytesOut, message.size());
     return true;
 }
 
-bool sendToClient(const SocketPtr& clientSocket, const std::shared_ptr<const std::string>& message) {
-    if (!clientSocket || *clientSocket < 0 || !message || message->empty()) {
+template<typename Header>
+bool sendFramedMessageZeroCopy(int socketFd, const std::shared_ptr<const std::string>& message,
+                               TxCompletionTracker& tracker, uint8_t type) {
+    if (socketFd < 0 || !message || message->empty() || message->size() > Header::MAX_PAYLOAD) {
         return false;
     }
-    return sendFramedMessage(*clientSocket, *message);
-}
-
-bool sendToServer(const SocketPtr& clientSocket, const std::shared_ptr<const std::string>& message) {
-    if (!clientSocket || *clientSocket < 0 || !message || message->empty()) {
-        return false;
+    
+    #ifdef MSG_ZEROCOPY
+    if (!tracker.zeroCopyEnabled()) {
+        return sendFramedMessage<Header>(socketFd, *message, &tracker, type);
+    }
+    
+    // Header must outlive the send too: kernel reads it from pinned user memory
+    constexpr size_t HEADER_SIZE = Header::HEADER_SIZE;
+    struct PinnedFrame {
+        char header[HEADER_SIZE];
+        std::shared_ptr<const std::string> payload;
+    };
+    auto frame = std::make_shared<PinnedFrame>();
+    Header::encode(frame->header, message->size(), type);
+    frame->payload = message;
+    
+    const int64_t userNs = tracker.timestampsEnabled() ? realtimeNs() : 0;
+    const size_t totalLength = HEADER_SIZE + message->size();
+    size_t bytesSent = 0;
+    uint32_t zeroCopyCalls = 0;
+    bool ok = true;
+    
+    while (bytesSent < totalLength) {
+        struct pollfd pfd;
+        pfd.fd = socketFd;
+        pfd.events = POLLOUT;
+        pfd.revents = 0;
+        
+        // 1ms timeout for low latency
+        int pollResult = poll(&pfd, 1, 1);
+        if (pollResult < 0) {
+            ok = false;
+            break;
+        }
+        if (pollResult == 0 || !(pfd.revents & POLLOUT)) {
+            continue;
+        }
+        
+        iovec iov[2];
+        int iovCount = 0;
+        if (bytesSent < HEADER_SIZE) {
+            iov[iovCount++] = {frame->header + bytesSent, HEADER_SIZE - bytesSent};
+            iov[iovCount++] = {const_cast<char*>(message->data()), message->size()};
+        } else {
+            iov[iovCount++] = {const_cast<char*>(message->data()) + (bytesSent - HEADER_SIZE), totalLength - bytesSent};
+        }
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = iovCount;
+        
+        const ssize_t sent = sendmsg(socketFd, &msg, MSG_ZEROCOPY | MSG_NOSIGNAL);
+        if (sent <= 0) {
+            if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                continue;
+            }
+            if (sent < 0 && errno == ENOBUFS) {
+                // Pinned-page budget (optmem) exhausted: copy the remainder instead
+                std::string remainder(frame->header, HEADER_SIZE);
+                remainder.append(*message);
+                const ssize_t copied = send(socketFd, remainder.data() + bytesSent,
+                                            totalLength - bytesSent, MSG_NOSIGNAL);
+                if (copied > 0) {
+                    bytesSent += static_cast<size_t>(copied);
+                    continue;
+                }
+                if (copied < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                    continue;
+                }
+            }
+            ok = false;
+            break;
+        }
+        bytesSent += static_cast<size_t>(sent);
+        zeroCopyCalls++;  // Each successful MSG_ZEROCOPY call consumes one completion ID
     }
-    return sendFramedMessage(*clientSocket, *message);
+    
+    tracker.pinZeroCopy(zeroCopyCalls, frame);
+    tracker.recordSend(bytesSent, userNs);
+    if (ok) {
+        metrics.add(Counter::FramesOut);
+        metrics.add(Counter::BytesOut, message->size());
+    }
+    return ok;
+    #else
+    return sendFramedMessage<Header>(socketFd, *message, &tracker, type);
+    #endif
 }
 
-bool receiveFramedMessage(int socketFd, MessageBuffer& buffer, std::string& message) {
+template<typename Header>
+bool receiveFramedMessage(int socketFd, BasicMessageBuffer<Header>& buffer, std::string& message,
+                          RxTimestamp* timestamp, int timeoutMs) {
     if (socketFd < 0) {
         return false;
     }
     
-    struct pollfd pfd;
-    pfd.fd = socketFd;
-    pfd.events = POLLIN;
-    pfd.revents = 0;
+    // Deliver frames already buffered by an earlier recv before waiting for more data
+    if (buffer.extractMessage(message, timestamp)) {
+        if (timestamp) {
+            timestamp->userNs = realtimeNs();
+        }
+        return true;
+    }
     
-    // 1ms timeout for low latency
-    int pollResult = poll(&pfd, 1, 1);
-    if (pollResult <= 0 || !(pfd.revents & POLLIN)) {
-        return false;
+    if (timeoutMs > 0) {
+        struct pollfd pfd;
+        pfd.fd = socketFd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        
+        // 1ms timeout for low latency
+        int pollResult = poll(&pfd, 1, timeoutMs);
+        if (pollResult <= 0 || !(pfd.revents & POLLIN)) {
+            return false;
+        }
     }
     
     // 8KB buffer reduces syscalls for large messages
     char recvBuffer[8192];
-    ssize_t bytesReceived = recv(socketFd, recvBuffer, sizeof(recvBuffer), 0);
+    ssize_t bytesReceived;
+    RxTimestamp chunkTimestamp;
+    
+    if (timestamp) {
+        // recvmsg() carries the kernel/hardware timestamp as a control message
+        alignas(cmsghdr) char control[256];
+        iovec iov{recvBuffer, sizeof(recvBuffer)};
+        msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        bytesReceived = recvmsg(socketFd, &msg, 0);
+        if (bytesReceived > 0) {
+            parseRxTimestamps(msg, chunkTimestamp);
+        }
+    } else {
+        bytesReceived = recv(socketFd, recvBuffer, sizeof(recvBuffer), 0);
+    }
     
     if (bytesReceived <= 0) {
         if (bytesReceived == 0 || (errno == EAGAIN || errno == EWOULDBLOCK)) {
@@ -177,8 +409,14 @@ bool receiveFramedMessage(int socketFd, MessageBuffer& buffer, std::string& mess
         return false;
     }
     
-    buffer.addData(recvBuffer, bytesReceived);
-    return buffer.extractMessage(message);
+    buffer.addData(recvBuffer, bytesReceived, timestamp ? &chunkTimestamp : nullptr);
+    if (!buffer.extractMessage(message, timestamp)) {
+        return false;
+    }
+    if (timestamp) {
+        timestamp->userNs = realtimeNs();
+    }
+    return true;
 }
 
 bool receiveFromClient(const SocketPtr& clientSocket, std::string& message) {
@@ -200,3 +438,21 @@ bool receiveFromServer(const SocketPtr& clientSocket, std::string& message) {
     }
     return receiveFramedMessage(*clientSocket, buffer, message);
 }
+
+// Explicit instantiations: one fully specialized buffer and send/receive path per frame format
+#define INSTANTIATE_FRAMING(Header)                                                                 \
+    template class BasicMessageBuffer<Header>;                                                      \
+    template std::string encodeFrame<Header>(const std::string&, uint8_t, uint64_t);               \
+    template bool sendFramedMessage<Header>(int, const std::string&, TxCompletionTracker*, uint8_t,  \
+                                            uint64_t);                                              \
+    template bool sendFramedMessageZeroCopy<Header>(int, const std::shared_ptr<const std::string>&,  \
+                                                    TxCompletionTracker&, uint8_t);                 \
+    template bool receiveFramedMessage<Header>(int, BasicMessageBuffer<Header>&, std::string&,       \
+                                               RxTimestamp*, int);
+
+INSTANTIATE_FRAMING(BigEndian32Header)
+INSTANTIATE_FRAMING(LittleEndian16Header)
+INSTANTIATE_FRAMING(LittleEndian32Header)
+INSTANTIATE_FRAMING(LengthTypeHeader)
+
+#undef INSTANTIATE_FRAMING
@@ -6,45 +6,119 @@
  * 
  * Implements length-prefixed message protocol with optimized buffering
  * for partial reads/writes and thread-safe message queues.
+ * 
+ * Buffers and send/receive functions are templates over a frame header policy
+ * (frame_header.h). The gateway's own format, BigEndian32Header, is the default;
+ * the other policies serve counterparties with different framing. All four are
+ * explicitly instantiated in message.cpp.
  */
 
 #include "socket_utils.h"
+#include "frame_header.h"
+#include "frame_scanner.h"
 #include <string>
 #include <memory>
 #include <queue>
+#include <deque>
 #include <mutex>
+#include <array>
+#include <cstdint>
 
 /**
- * @class MessageBuffer
+ * @struct RxTimestamp
+ * @brief Receive timestamps attached to an extracted frame (CLOCK_REALTIME, ns)
+ * 
+ * kernelNs/hardwareNs come from the recvmsg() control message of the read that
+ * completed the frame; zero when timestamping is disabled or unsupported.
+ */
+struct RxTimestamp {
+    int64_t kernelNs = 0;    ///< Software timestamp taken when the kernel received the data
+    int64_t hardwareNs = 0;  ///< NIC hardware timestamp (raw), if the device supports it
+    int64_t userNs = 0;      ///< When the frame was handed to the caller
+    
+    /**
+     * @brief Kernel-to-user delay (ns), or -1 if no kernel timestamp
+     */
+    int64_t wakeupDelayNs() const { return kernelNs ? userNs - kernelNs : -1; }
+};
+
+class TxCompletionTracker;
+
+/**
+ * @class BasicMessageBuffer
  * @brief Buffers length-prefixed messages for partial reads
  * 
  * Uses read position tracking to avoid memory copies. Optimized for high throughput.
- * Format: [4 bytes: length (network byte order)][N bytes: payload]
- * Max size: 1MB
+ * Complete frames are located FRAME_BATCH at a time by scanFrames() into an
+ * index; extractMessage() hands them out from the index, prefetching the
+ * frames after the current one, and rescans once it is used up.
+ * Format and size limit come from Header (see frame_header.h); MessageBuffer
+ * is [4 bytes: length (network byte order)][N bytes: payload], max 1MB.
  */
-class MessageBuffer {
+template<typename Header>
+class BasicMessageBuffer {
 public:
+    static constexpr size_t HEADER_SIZE = Header::HEADER_SIZE;
+    static constexpr size_t MAX_PAYLOAD = Header::MAX_PAYLOAD;
+    static constexpr size_t FRAME_BATCH = 64;    ///< Frames indexed per scan
+    static constexpr size_t PREFETCH_AHEAD = 2;  ///< Frames prefetched ahead of the one extracted
+
     /**
      * @brief Adds received data to buffer (auto-compacts if needed)
+     * 
+     * @param timestamp Receive timestamp of this chunk (optional)
      */
-    bool addData(const char* data, size_t len);
+    bool addData(const char* data, size_t len, const RxTimestamp* timestamp = nullptr);
     
     /**
      * @brief Extracts complete message if available
      * 
      * @param message Output parameter
+     * @param timestamp Output: timestamp of the chunk that completed the frame (optional)
      * @return true if complete message extracted, false if incomplete
      */
-    bool extractMessage(std::string& message);
+    bool extractMessage(std::string& message, RxTimestamp* timestamp = nullptr);
     
     /**
      * @brief Clears buffer and resets read position
      */
     void clear();
+    
+    /**
+     * @brief Clears buffer and frees its storage
+     * 
+     * @return Bytes of storage released
+     */
+    size_t release();
+    
+    /**
+     * @brief Bytes received but not yet extracted (a partial frame, or whole frames not read yet)
+     */
+    std::string unread() const { return buffer_.substr(readPos_); }
+    
+    /**
+     * @brief Message type of the last extracted frame (0 if Header has none)
+     */
+    uint8_t frameType() const { return frameType_; }
+    
+    /**
+     * @brief Correlation id of the last extracted frame (0 if it was not correlated)
+     * 
+     * For correlated frames frameType() is the type carried in the extension.
+     */
+    uint64_t correlationId() const { return correlationId_; }
 
 private:
     std::string buffer_;        ///< Internal buffer storing received data
     size_t readPos_ = 0;        ///< Current read position (avoids erase operations)
+    uint64_t bytesAdded_ = 0;   ///< Total bytes ever added (stream offset of buffer end)
+    uint64_t bytesConsumed_ = 0;  ///< Total bytes ever extracted (stream offset of readPos_)
+    std::deque<std::pair<uint64_t, RxTimestamp>> chunkTimestamps_;  ///< (stream end offset, timestamp) per timestamped chunk
+    uint8_t frameType_ = 0;     ///< Type byte of the last extracted frame
+    uint64_t correlationId_ = 0;  ///< Correlation id of the last extracted frame
+    std::array<FrameSpan, FRAME_BATCH> index_;  ///< Frames found by the last scan, offsets relative to its start
+    size_t indexCount_ = 0;     ///< Spans in index_
+    size_t indexNext_ = 0;      ///< Next span to extract (its frame starts at readPos_)
     
     /**
      * @brief Compacts buffer when readPos_ > half buffer size or buffer > 1MB
@@ -52,19 +126,39 @@ private:
     void compactIfNeeded();
 };
 
+using MessageBuffer = BasicMessageBuffer<BigEndian32Header>;  ///< Gateway's native framing
+
 /**
  * @class MessageQueue
  * @brief Thread-safe message queue for inter-thread communication
  */
 class MessageQueue {
 public:
-    void push(const std::string& source, const std::string& message);
+    /**
+     * @brief Queues a message, stamping it with the current CLOCK_REALTIME
+     * 
+     * @param session Connection ID the message belongs to (0 = none, e.g. system notices)
+     */
+    void push(const std::string& source, const std::string& message, int session = 0);
     bool pop(std::string& source, std::string& message);
+
+    /**
+     * @brief Pops a message along with its session and enqueue time
+     */
+    bool pop(std::string& source, std::string& message, int& session, int64_t& timestampNs);
+    size_t size() const;
     void clear();
 
 private:
-    std::queue<std::pair<std::string, std::string>> messages_;  ///< Internal message queue
-    std::mutex mutex_;  ///< Mutex for thread-safe operations
+    struct QueuedMessage {
+        std::string source;
+        std::string message;
+        int session;
+        int64_t timestampNs;
+    };
+
+    std::queue<QueuedMessage> messages_;  ///< Internal message queue
+    mutable std::mutex mutex_;  ///< Mutex for thread-safe operations
 };
 
 /**
@@ -73,22 +167,59 @@ private:
 extern MessageQueue receivedMessages;
 
 /**
- * @brief Sends length-prefixed message: [4 bytes: length][N bytes: payload]
+ * @brief Builds a frame: [header][extension if correlationId is set][N bytes: payload]
  * 
- * Non-blocking send with 1ms poll timeout. Handles partial writes.
+ * The caller checks the payload limit, and that Header supports correlation
+ * when correlationId is set.
  */
-bool sendFramedMessage(int socketFd, const std::string& message);
+template<typename Header = BigEndian32Header>
+std::string encodeFrame(const std::string& message, uint8_t type = 0, uint64_t correlationId = 0);
 
-bool sendToClient(const SocketPtr& clientSocket, const std::shared_ptr<const std::string>& message);
-bool sendToServer(const SocketPtr& clientSocket, const std::shared_ptr<const std::string>& message);
+/**
+ * @brief Sends length-prefixed message: [header][N bytes: payload]
+ * 
+ * Non-blocking send with 1ms poll timeout. Handles partial writes. Fails
+ * for payloads over Header::MAX_PAYLOAD.
+ * 
+ * @param tracker Matches the frame to its kernel TX timestamp (may be null)
+ * @param type Message type, for headers that carry one (Header::HAS_TYPE) or correlated frames
+ * @param correlationId Non-zero sends a correlated frame carrying type and this id;
+ *                      fails for formats without correlation (NoCorrelation)
+ */
+template<typename Header = BigEndian32Header>
+bool sendFramedMessage(int socketFd, const std::string& message,
+                       TxCompletionTracker* tracker = nullptr, uint8_t type = 0,
+                       uint64_t correlationId = 0);
+
+/**
+ * @brief Sends framed message with MSG_ZEROCOPY, pinning payload until the kernel releases it
+ * 
+ * Header and payload go out in one sendmsg() without copying the payload into
+ * a staging buffer. The payload (and header) are held by tracker until the
+ * completion arrives on the error queue. Falls back to a copying send for the
+ * remainder if the kernel refuses zerocopy (e.g. ENOBUFS). Requires
+ * tracker.enableZeroCopy(); worthwhile only for large frames.
+ */
+template<typename Header = BigEndian32Header>
+bool sendFramedMessageZeroCopy(int socketFd, const std::shared_ptr<const std::string>& message,
+                               TxCompletionTracker& tracker, uint8_t type = 0);
 
 /**
  * @brief Receives and extracts complete framed message
  * 
  * Non-blocking receive with 1ms poll timeout. Handles partial reads.
- * Buffer should be per-connection.
+ * Buffer should be per-connection; its type selects the frame format.
+ * 
+ * With a timestamp, uses recvmsg() to collect SO_TIMESTAMPING/SO_TIMESTAMPNS
+ * control messages (see enableRxTimestamps()). userNs is stamped when the
+ * frame is returned.
+ * 
+ * @param timeoutMs Poll timeout; 0 reads without polling (non-blocking sockets,
+ *                  e.g. after an event loop reported readiness)
  */
-bool receiveFramedMessage(int socketFd, MessageBuffer& buffer, std::string& message);
+template<typename Header>
+bool receiveFramedMessage(int socketFd, BasicMessageBuffer<Header>& buffer, std::string& message,
+                          RxTimestamp* timestamp = nullptr, int timeoutMs = 1);
 
 /**
  * @deprecated Legacy wrapper - creates temporary buffer (inefficient).
@@ -0,0 +1,433 @@
+#include "multicast.h"
+#include "message.h"
+#include "../logging/logger.h"
+#include <cstring>
+#include <cerrno>
+#include <chrono>
+#include <map>
+#include <random>
+#include <sstream>
+#include <utility>
+#include <sys/poll.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+const char* const RETRANSMIT_REQUEST = "RETRANSMIT ";
+const char* const RETRANSMIT_END = "RETRANSMIT END";
+
+namespace {
+
+std::shared_ptr<MulticastPublisher> retransmitSource;
+std::mutex retransmitSourceMutex;
+
+void writeU64(char* out, uint64_t value) {
+    uint32_t high = htonl(static_cast<uint32_t>(value >> 32));
+    uint32_t low = htonl(static_cast<uint32_t>(value & 0xFFFFFFFFu));
+    std::memcpy(out, &high, 4);
+    std::memcpy(out + 4, &low, 4);
+}
+
+uint64_t readU64(const char* in) {
+    uint32_t high, low;
+    std::memcpy(&high, in, 4);
+    std::memcpy(&low, in + 4, 4);
+    return (static_cast<uint64_t>(ntohl(high)) << 32) | ntohl(low);
+}
+
+void writeU32(char* out, uint32_t value) {
+    value = htonl(value);
+    std::memcpy(out, &value, 4);
+}
+
+uint32_t readU32(const char* in) {
+    uint32_t value;
+    std::memcpy(&value, in, 4);
+    return ntohl(value);
+}
+
+void writeU16(char* out, uint16_t value) {
+    value = htons(value);
+    std::memcpy(out, &value, 2);
+}
+
+uint16_t readU16(const char* in) {
+    uint16_t value;
+    std::memcpy(&value, in, 2);
+    return ntohs(value);
+}
+
+/**
+ * @brief Random non-zero publisher session id (0 marks an unsynced receiver)
+ */
+uint32_t newPublisherSession() {
+    std::random_device source;
+    uint32_t session = 0;
+    while (session == 0) {
+        session = source();
+    }
+    return session;
+}
+
+} // namespace
+
+
+MulticastPublisher::MulticastPublisher(size_t retainPackets)
+    : session_(newPublisherSession()),
+      retained_(retainPackets ? retainPackets : 1),
+      retainedSeq_(retainPackets ? retainPackets : 1, 0) {
+    pending_.reserve(MULTICAST_MAX_PACKET);
+    pending_.assign(MULTICAST_HEADER_SIZE, '\0');
+}
+
+MulticastPublisher::~MulticastPublisher() {
+    close();
+}
+
+bool MulticastPublisher::open(const std::string& group, int port,
+                              const std::string& iface, int ttl) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (socketFd_ >= 0) {
+        return true;
+    }
+
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        LOG_ERROR("Multicast socket creation failed: {}", strerror(errno));
+        return false;
+    }
+
+    in_addr ifaceAddr{};
+    if (inet_pton(AF_INET, iface.c_str(), &ifaceAddr) <= 0 ||
+        setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &ifaceAddr, sizeof(ifaceAddr)) < 0) {
+        LOG_ERROR("Multicast interface setup failed: {}", strerror(errno));
+        ::close(fd);
+        return false;
+    }
+
+    // Loopback lets receivers on the same host (including tests) see our packets
+    unsigned char loop = 1;
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+    unsigned char hops = static_cast<unsigned char>(ttl);
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &hops, sizeof(hops));
+
+    int bufferSize = 256 * 1024;
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize));
+
+    groupAddress_.sin_family = AF_INET;
+    groupAddress_.sin_port = htons(static_cast<uint16_t>(port));
+    if (inet_pton(AF_INET, group.c_str(), &groupAddress_.sin_addr) <= 0) {
+        LOG_ERROR("Invalid multicast group: {}", group);
+        ::close(fd);
+        return false;
+    }
+
+    socketFd_ = fd;
+    return true;
+}
+
+bool MulticastPublisher::publish(const std::string& update) {
+    if (update.empty() || update.size() > MULTICAST_MAX_PACKET - MULTICAST_HEADER_SIZE - 2) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (socketFd_ < 0) {
+        return false;
+    }
+
+    // Send current packet first if this update would overflow the MTU
+    if (pending_.size() + 2 + update.size() > MULTICAST_MAX_PACKET || pendingCount_ == UINT16_MAX) {
+        if (!sendPendingLocked()) {
+            return false;
+        }
+    }
+
+    char length[2];
+    writeU16(length, static_cast<uint16_t>(update.size()));
+    pending_.append(length, 2);
+    pending_.append(update);
+    pendingCount_++;
+    return true;
+}
+
+bool MulticastPublisher::flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (socketFd_ < 0) {
+        return false;
+    }
+    return pendingCount_ == 0 || sendPendingLocked();
+}
+
+bool MulticastPublisher::sendPendingLocked() {
+    const uint64_t seq = nextSeq_++;
+    writeU64(&pending_[0], seq);
+    writeU32(&pending_[8], session_);
+    writeU16(&pending_[12], pendingCount_);
+
+    const ssize_t sent = sendto(socketFd_, pending_.data(), pending_.size(), 0,
+                                (struct sockaddr*)&groupAddress_, sizeof(groupAddress_));
+
+    // Retain even if the send failed so receivers can recover the sequence over TCP
+    const size_t slot = seq % retained_.size();
+    retained_[slot] = pending_;
+    retainedSeq_[slot] = seq;
+
+    pending_.assign(MULTICAST_HEADER_SIZE, '\0');
+    pendingCount_ = 0;
+    return sent == static_cast<ssize_t>(retained_[slot].size());
+}
+
+std::vector<std::string> MulticastPublisher::retainedPackets(uint64_t fromSeq, uint64_t toSeq) const {
+    std::vector<std::string> packets;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (toSeq >= nextSeq_) {
+            toSeq = nextSeq_ - 1;
+        }
+        // Never replay more than the ring can hold
+        if (toSeq >= fromSeq && toSeq - fromSeq >= retained_.size()) {
+            fromSeq = toSeq - retained_.size() + 1;
+        }
+        for (uint64_t seq = fromSeq; seq <= toSeq && seq != 0; ++seq) {
+            const size_t slot = seq % retained_.size();
+            if (retainedSeq_[slot] == seq) {
+                packets.push_back(retained_[slot]);
+            }
+        }
+    }
+
+    return packets;
+}
+
+uint64_t MulticastPublisher::nextSequence() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return nextSeq_;
+}
+
+void MulticastPublisher::close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (socketFd_ >= 0) {
+        ::close(socketFd_);
+        socketFd_ = -1;
+    }
+}
+
+
+MulticastReceiver::MulticastReceiver(std::string retransmitHost, uint16_t retransmitPort)
+    : retransmitHost_(std::move(retransmitHost)), retransmitPort_(retransmitPort) {}
+
+MulticastReceiver::~MulticastReceiver() {
+    close();
+}
+
+bool MulticastReceiver::open(const std::string& group, int port, const std::string& iface) {
+    if (socketFd_ >= 0) {
+        return true;
+    }
+
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        LOG_ERROR("Multicast socket creation failed: {}", strerror(errno));
+        return false;
+    }
+
+    // Allow several receivers (processes or threads) to bind the same group port
+    int opt = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    #ifdef SO_REUSEPORT
+    setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt));
+    #endif
+
+    int bufferSize = 1024 * 1024;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+
+    sockaddr_in bindAddress{};
+    bindAddress.sin_family = AF_INET;
+    bindAddress.sin_port = htons(static_cast<uint16_t>(port));
+    bindAddress.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(fd, (struct sockaddr*)&bindAddress, sizeof(bindAddress)) < 0) {
+        LOG_ERROR("Multicast bind failed: {}", strerror(errno));
+        ::close(fd);
+        return false;
+    }
+
+    ip_mreq membership{};
+    if (inet_pton(AF_INET, group.c_str(), &membership.imr_multiaddr) <= 0 ||
+        inet_pton(AF_INET, iface.c_str(), &membership.imr_interface) <= 0 ||
+        setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) < 0) {
+        LOG_ERROR("Multicast join failed: {}", strerror(errno));
+        ::close(fd);
+        return false;
+    }
+
+    if (!makeNonBlocking(fd)) {
+        ::close(fd);
+        return false;
+    }
+
+    socketFd_ = fd;
+    expectedSeq_ = 0;
+    session_ = 0;
+    return true;
+}
+
+bool MulticastReceiver::receive(std::vector<std::string>& updates) {
+    if (socketFd_ < 0) {
+        return false;
+    }
+
+    struct pollfd pfd;
+    pfd.fd = socketFd_;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    // 1ms timeout for low latency
+    if (poll(&pfd, 1, 1) <= 0 || !(pfd.revents & POLLIN)) {
+        return false;
+    }
+
+    char packet[MULTICAST_MAX_PACKET];
+    const ssize_t len = recv(socketFd_, packet, sizeof(packet), 0);
+    if (len < static_cast<ssize_t>(MULTICAST_HEADER_SIZE)) {
+        return false;
+    }
+
+    const size_t before = updates.size();
+    const uint64_t seq = readU64(packet);
+    const uint32_t session = readU32(packet + 8);
+
+    if (expectedSeq_ != 0 && session != session_) {
+        // Publisher restarted: its sequence starts over, so follow the new stream from here
+        LOG_WARN("Multicast publisher session changed ({} -> {}), resyncing at sequence {}", session_, session, seq);
+        publisherRestarts_++;
+        expectedSeq_ = 0;
+    }
+    session_ = session;
+
+    if (expectedSeq_ != 0) {
+        if (seq < expectedSeq_) {
+            return false; // Duplicate or already recovered
+        }
+        if (seq > expectedSeq_) {
+            gapsDetected_++;
+            recoverGap(expectedSeq_, seq - 1, updates);
+        }
+    }
+
+    deliverPacket(packet, static_cast<size_t>(len), updates);
+    expectedSeq_ = seq + 1;
+    return updates.size() > before;
+}
+
+bool MulticastReceiver::recoverGap(uint64_t fromSeq, uint64_t toSeq,
+                                   std::vector<std::string>& updates) {
+    const uint64_t missing = toSeq - fromSeq + 1;
+
+    if (!recoverySocket_) {
+        // Blocking connect to the gateway, then switch to non-blocking framed I/O
+        recoverySocket_ = startClient(retransmitHost_, retransmitPort_);
+        if (!recoverySocket_ || !makeNonBlocking(*recoverySocket_)) {
+            recoverySocket_.reset();
+            packetsLost_ += missing;
+            return false;
+        }
+    }
+
+    std::ostringstream request;
+    request << RETRANSMIT_REQUEST << fromSeq << " " << toSeq;
+    if (!sendFramedMessage(*recoverySocket_, request.str())) {
+        recoverySocket_.reset();
+        packetsLost_ += missing;
+        return false;
+    }
+
+    // Collect replayed packets until the end marker or a 100ms deadline
+    std::map<uint64_t, std::string> recovered;
+    MessageBuffer buffer;
+    std::string reply;
+    bool complete = false;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (!receiveFramedMessage(*recoverySocket_, buffer, reply)) {
+            continue;
+        }
+        if (reply == RETRANSMIT_END) {
+            complete = true;
+            break;
+        }
+        if (reply.size() >= MULTICAST_HEADER_SIZE) {
+            const uint64_t seq = readU64(reply.data());
+            // A replay from a restarted publisher holds different packets under the same numbers
+            if (seq >= fromSeq && seq <= toSeq && readU32(reply.data() + 8) == session_) {
+                recovered[seq] = reply;
+            }
+        }
+    }
+
+    if (!complete) {
+        // Reply stream is out of step; reconnect next time
+        recoverySocket_.reset();
+    }
+
+    for (const auto& entry : recovered) {
+        deliverPacket(entry.second.data(), entry.second.size(), updates);
+    }
+    packetsRecovered_ += recovered.size();
+    packetsLost_ += missing - recovered.size();
+    return recovered.size() == missing;
+}
+
+void MulticastReceiver::deliverPacket(const char* data, size_t len,
+                                      std::vector<std::string>& updates) {
+    const uint16_t count = readU16(data + 12);
+    size_t offset = MULTICAST_HEADER_SIZE;
+
+    for (uint16_t i = 0; i < count && offset + 2 <= len; ++i) {
+        const uint16_t updateLen = readU16(data + offset);
+        offset += 2;
+        if (offset + updateLen > len) {
+            break; // Truncated packet
+        }
+        updates.emplace_back(data + offset, updateLen);
+        offset += updateLen;
+    }
+}
+
+void MulticastReceiver::close() {
+    if (socketFd_ >= 0) {
+        ::close(socketFd_);
+        socketFd_ = -1;
+    }
+    recoverySocket_.reset();
+}
+
+
+void setRetransmitSource(std::shared_ptr<MulticastPublisher> publisher) {
+    std::lock_guard<std::mutex> lock(retransmitSourceMutex);
+    retransmitSource = std::move(publisher);
+}
+
+bool handleRetransmitRequest(const std::string& message, std::vector<std::string>& replies) {
+    const size_t prefixLen = std::strlen(RETRANSMIT_REQUEST);
+    if (message.compare(0, prefixLen, RETRANSMIT_REQUEST) != 0 || message == RETRANSMIT_END) {
+        return false;
+    }
+
+    std::shared_ptr<MulticastPublisher> publisher;
+    {
+        std::lock_guard<std::mutex> lock(retransmitSourceMutex);
+        publisher = retransmitSource;
+    }
+
+    uint64_t fromSeq = 0, toSeq = 0;
+    std::istringstream request(message.substr(prefixLen));
+    replies.clear();
+    if (publisher && (request >> fromSeq >> toSeq) && fromSeq <= toSeq) {
+        replies = publisher->retainedPackets(fromSeq, toSeq);
+    }
+    // Always terminate the reply so the receiver does not wait out its deadline
+    replies.emplace_back(RETRANSMIT_END);
+    return true;
+}
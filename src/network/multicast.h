@@ -0,0 +1,194 @@
+#pragma once
+
+/**
+ * @file multicast.h
+ * @brief UDP multicast market data publisher and gap-detecting receiver
+ *
+ * Updates are batched into MTU-sized packets so fan-out costs one send per
+ * packet regardless of subscriber count. Receivers detect sequence gaps and
+ * recover the missing packets over the TCP retransmit channel served by the
+ * gateway server.
+ *
+ * Packet format: [8 bytes: sequence][4 bytes: publisher session][2 bytes: update count]
+ *                then per update [2 bytes: length][N bytes: payload]
+ * All integers in network byte order. The session id is drawn at random per
+ * publisher, so a receiver can tell a restarted publisher (sequence back at
+ * 1) from duplicates.
+ */
+
+#include "socket_utils.h"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <netinet/in.h>
+
+/**
+ * @brief Largest UDP payload that fits a 1500-byte Ethernet MTU (minus IP/UDP headers)
+ */
+constexpr size_t MULTICAST_MAX_PACKET = 1472;
+
+/**
+ * @brief Packet header size: 8-byte sequence + 4-byte publisher session + 2-byte update count
+ */
+constexpr size_t MULTICAST_HEADER_SIZE = 14;
+
+/**
+ * @class MulticastPublisher
+ * @brief Batches updates into sequenced multicast packets
+ *
+ * Retains the most recent packets in a ring so gaps can be replayed over TCP.
+ * Thread safety: publish/flush and retransmit may be called from different threads.
+ */
+class MulticastPublisher {
+public:
+    /**
+     * @param retainPackets Number of sent packets kept for retransmission
+     */
+    explicit MulticastPublisher(size_t retainPackets = 4096);
+    ~MulticastPublisher();
+
+    /**
+     * @brief Creates the UDP socket and configures the multicast interface
+     *
+     * Loopback is enabled so publisher and receiver can run on one machine.
+     *
+     * @param group Multicast group address
+     * @param port Destination UDP port
+     * @param iface Local interface address used for sending
+     * @param ttl Multicast TTL (1 keeps traffic on the local subnet)
+     * @return true on success, false on error
+     */
+    bool open(const std::string& group = "239.255.0.1", int port = 30001,
+              const std::string& iface = "127.0.0.1", int ttl = 1);
+
+    /**
+     * @brief Appends update to the current packet, sending it first if full
+     *
+     * @return false if update is empty, too large for one packet, or send failed
+     */
+    bool publish(const std::string& update);
+
+    /**
+     * @brief Sends the current packet if it holds any updates
+     */
+    bool flush();
+
+    /**
+     * @brief Retained packets [fromSeq, toSeq], oldest first
+     *
+     * Packets no longer retained are skipped. The caller sends each as one
+     * framed message, followed by RETRANSMIT_END.
+     */
+    std::vector<std::string> retainedPackets(uint64_t fromSeq, uint64_t toSeq) const;
+
+    /**
+     * @brief Sequence number the next packet will carry
+     */
+    uint64_t nextSequence() const;
+
+    /**
+     * @brief Non-zero id stamped on every packet of this publisher
+     */
+    uint32_t session() const { return session_; }
+
+    void close();
+
+private:
+    int socketFd_ = -1;                     ///< UDP socket
+    const uint32_t session_;                ///< Publisher session id (random, non-zero)
+    sockaddr_in groupAddress_{};            ///< Destination group and port
+    std::string pending_;                   ///< Packet being batched (header reserved)
+    uint16_t pendingCount_ = 0;             ///< Updates in pending_
+    uint64_t nextSeq_ = 1;                  ///< Sequence of next packet
+    std::vector<std::string> retained_;     ///< Sent packets, indexed by seq % size
+    std::vector<uint64_t> retainedSeq_;     ///< Sequence stored in each retained slot
+    mutable std::mutex mutex_;              ///< Guards all state above
+
+    bool sendPendingLocked();
+};
+
+/**
+ * @class MulticastReceiver
+ * @brief Joins a multicast group, unpacks updates, and recovers gaps over TCP
+ *
+ * Not thread-safe: intended to be driven by a single receive thread.
+ */
+class MulticastReceiver {
+public:
+    /**
+     * @param retransmitHost IPv4 address of the gateway serving retransmit requests
+     * @param retransmitPort Its TCP port
+     */
+    explicit MulticastReceiver(std::string retransmitHost = "127.0.0.1", uint16_t retransmitPort = 8080);
+    ~MulticastReceiver();
+
+    /**
+     * @brief Binds the group port and joins the group on the given interface
+     *
+     * SO_REUSEADDR/SO_REUSEPORT allow several receivers on one host.
+     */
+    bool open(const std::string& group = "239.255.0.1", int port = 30001,
+              const std::string& iface = "127.0.0.1");
+
+    /**
+     * @brief Receives one packet (1ms poll timeout) and appends its updates in order
+     *
+     * On a sequence gap, missing packets are fetched from the gateway's TCP
+     * retransmit channel before the current packet is delivered. A packet
+     * from a new publisher session resyncs the receiver to its sequence.
+     *
+     * @return true if any updates were appended
+     */
+    bool receive(std::vector<std::string>& updates);
+
+    void close();
+
+    uint64_t gapsDetected() const { return gapsDetected_; }
+    uint64_t packetsRecovered() const { return packetsRecovered_; }
+    uint64_t packetsLost() const { return packetsLost_; }
+    uint64_t publisherRestarts() const { return publisherRestarts_; }
+
+private:
+    int socketFd_ = -1;                 ///< UDP socket
+    std::string retransmitHost_;        ///< Gateway answering retransmit requests
+    uint16_t retransmitPort_;
+    SocketPtr recoverySocket_;          ///< Lazily connected TCP retransmit channel
+    uint64_t expectedSeq_ = 0;          ///< Next expected sequence (0 = not yet synced)
+    uint32_t session_ = 0;              ///< Publisher session of the stream being followed
+    uint64_t gapsDetected_ = 0;         ///< Gaps seen on the multicast stream
+    uint64_t packetsRecovered_ = 0;     ///< Packets filled from retransmit channel
+    uint64_t packetsLost_ = 0;          ///< Packets that could not be recovered
+    uint64_t publisherRestarts_ = 0;    ///< Session changes seen after syncing
+
+    bool recoverGap(uint64_t fromSeq, uint64_t toSeq, std::vector<std::string>& updates);
+    void deliverPacket(const char* data, size_t len, std::vector<std::string>& updates);
+};
+
+/**
+ * @brief Prefix of retransmit requests: "RETRANSMIT <fromSeq> <toSeq>"
+ */
+extern const char* const RETRANSMIT_REQUEST;
+
+/**
+ * @brief Framed message terminating a retransmit reply
+ */
+extern const char* const RETRANSMIT_END;
+
+/**
+ * @brief Registers the publisher whose retained packets the server replays
+ */
+void setRetransmitSource(std::shared_ptr<MulticastPublisher> publisher);
+
+/**
+ * @brief Answers a retransmit request received on a server session
+ *
+ * Does not write to the session: the replies (retained packets, then
+ * RETRANSMIT_END) are returned for the caller to send on the connection,
+ * so they go through its TX tracking like every other frame.
+ *
+ * @param replies Output: frames to send, in order
+ * @return true if message was a retransmit request (handled), false otherwise
+ */
+bool handleRetransmitRequest(const std::string& message, std::vector<std::string>& replies);
@@ -0,0 +1,155 @@
+#include "request_tracker.h"
+#include "../metrics/metrics.h"
+#include "../util/tsc_clock.h"
+#include <utility>
+#include <vector>
+
+RoundTripHistograms requestRtt;
+
+RoundTripHistograms::~RoundTripHistograms() {
+    for (auto& histogram : histograms_) {
+        delete histogram.load(std::memory_order_relaxed);
+    }
+}
+
+void RoundTripHistograms::record(uint8_t type, int64_t rttNs) {
+    std::atomic<LatencyHistogram*>& slot = histograms_[type];
+    LatencyHistogram* histogram = slot.load(std::memory_order_acquire);
+    if (!histogram) {
+        // Types are rarely first seen concurrently; the loser frees its copy
+        auto* created = new LatencyHistogram();
+        if (slot.compare_exchange_strong(histogram, created, std::memory_order_acq_rel)) {
+            histogram = created;
+        } else {
+            delete created;
+        }
+    }
+    histogram->record(rttNs);
+}
+
+uint64_t RequestTracker::begin(uint8_t type, ResponseCallback callback) {
+    const int64_t nowNs = static_cast<int64_t>(steadyClockNs());
+    expire(nowNs);
+    std::lock_guard<std::mutex> lock(mutex_);
+    Slot& slot = slots_.emplace_back();
+    slot.callback = std::move(callback);
+    slot.sentNs = nowNs;
+    slot.type = type;
+    slot.active = true;
+    ++active_;
+    return baseId_ + slots_.size() - 1;
+}
+
+void RequestTracker::cancel(uint64_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (id < baseId_ || id - baseId_ >= slots_.size() || !slots_[id - baseId_].active) {
+        return;
+    }
+    Slot& slot = slots_[id - baseId_];
+    slot.active = false;
+    slot.callback = nullptr;
+    --active_;
+    trimLocked();
+}
+
+bool RequestTracker::complete(uint64_t id, std::string payload) {
+    const int64_t nowNs = static_cast<int64_t>(steadyClockNs());
+    CorrelatedResponse response;
+    ResponseCallback callback;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (id < baseId_ || id - baseId_ >= slots_.size() || !slots_[id - baseId_].active) {
+            return false;
+        }
+        Slot& slot = slots_[id - baseId_];
+        response.ok = true;
+        response.type = slot.type;
+        response.correlationId = id;
+        response.rttNs = nowNs - slot.sentNs;
+        callback = std::move(slot.callback);
+        slot.active = false;
+        --active_;
+        trimLocked();
+    }
+    requestRtt.record(response.type, response.rttNs);
+    metrics.add(Counter::RequestsCompleted);
+    response.payload = std::move(payload);
+    if (callback) {
+        callback(response);
+    }
+    return true;
+}
+
+size_t RequestTracker::expire(int64_t nowNs) {
+    if (timeoutNs_ <= 0) {
+        return 0;
+    }
+    std::vector<std::pair<CorrelatedResponse, ResponseCallback>> expired;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // Ids are sent in order, so the first request within its deadline ends the sweep
+        for (size_t i = 0; i < slots_.size() && slots_[i].sentNs + timeoutNs_ <= nowNs; ++i) {
+            Slot& slot = slots_[i];
+            if (!slot.active) {
+                continue;
+            }
+            CorrelatedResponse response;
+            response.type = slot.type;
+            response.correlationId = baseId_ + i;
+            expired.emplace_back(std::move(response), std::move(slot.callback));
+            slot.active = false;
+            --active_;
+        }
+        trimLocked();
+    }
+    if (!expired.empty()) {
+        metrics.add(Counter::RequestsFailed, expired.size());
+    }
+    for (auto& [response, callback] : expired) {
+        if (callback) {
+            callback(response);
+        }
+    }
+    return expired.size();
+}
+
+void RequestTracker::failAll() {
+    std::vector<std::pair<CorrelatedResponse, ResponseCallback>> failed;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < slots_.size(); ++i) {
+            Slot& slot = slots_[i];
+            if (!slot.active) {
+                continue;
+            }
+            CorrelatedResponse response;
+            response.type = slot.type;
+            response.correlationId = baseId_ + i;
+            failed.emplace_back(std::move(response), std::move(slot.callback));
+        }
+        baseId_ += slots_.size();
+        slots_.clear();
+        active_ = 0;
+    }
+    if (!failed.empty()) {
+        metrics.add(Counter::RequestsFailed, failed.size());
+    }
+    for (auto& [response, callback] : failed) {
+        if (callback) {
+            callback(response);
+        }
+    }
+}
+
+size_t RequestTracker::pending() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return active_;
+}
+
+void RequestTracker::trimLocked() {
+    // Answered requests behind a still-pending older one stay until it resolves
+    while (!slots_.empty() && !slots_.front().active) {
+        slots_.pop_front();
+        ++baseId_;
+    }
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+/**
+ * @file request_tracker.h
+ * @brief Request/response correlation and round-trip latency per message type
+ *
+ * A correlated frame carries a sender-chosen type byte and a 64-bit id in the
+ * frame header extension (see frame_header.h); the peer echoes both on its
+ * response. Each connection hands out ids sequentially, so outstanding
+ * requests sit in a ring indexed by id and the oldest is always at the
+ * front: completion is O(1) and the timeout sweep stops at the first request
+ * that is still within its deadline.
+ *
+ * Every completed round trip is recorded in requestRtt under its type.
+ */
+
+#include "latency_histogram.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+
+/**
+ * @struct CorrelatedResponse
+ * @brief Outcome of one correlated request
+ */
+struct CorrelatedResponse {
+    bool ok = false;             ///< false if the request timed out or its connection closed
+    uint8_t type = 0;            ///< Message type of the request
+    uint64_t correlationId = 0;
+    int64_t rttNs = 0;           ///< Send to response delivery (ok only)
+    std::string payload;         ///< Response payload (ok only)
+};
+
+using ResponseCallback = std::function<void(const CorrelatedResponse&)>;
+
+/**
+ * @class RoundTripHistograms
+ * @brief One latency histogram per message type, allocated on first use
+ */
+class RoundTripHistograms {
+public:
+    ~RoundTripHistograms();
+
+    /**
+     * @brief Records a round trip under type
+     */
+    void record(uint8_t type, int64_t rttNs);
+
+    /**
+     * @brief Histogram of type, or nullptr if none was recorded yet
+     */
+    const LatencyHistogram* find(uint8_t type) const {
+        return histograms_[type].load(std::memory_order_acquire);
+    }
+
+private:
+    std::array<std::atomic<LatencyHistogram*>, 256> histograms_{};
+};
+
+/**
+ * @brief Round trips of every connection, keyed by message type
+ */
+extern RoundTripHistograms requestRtt;
+
+/**
+ * @class RequestTracker
+ * @brief Outstanding correlated requests of one connection
+ *
+ * Thread safety: all methods may be called from any thread. Callbacks run
+ * without the lock held, on the thread that completed, expired or failed
+ * the request.
+ */
+class RequestTracker {
+public:
+    /**
+     * @param timeoutNs Requests without a response after this long fail (0 = never)
+     */
+    explicit RequestTracker(int64_t timeoutNs) : timeoutNs_(timeoutNs) {}
+
+    /**
+     * @brief Registers a request before it is sent; expires overdue ones first
+     *
+     * @return Correlation id to put on the frame (never 0)
+     */
+    uint64_t begin(uint8_t type, ResponseCallback callback);
+
+    /**
+     * @brief Withdraws a request whose frame could not be sent (callback not run)
+     */
+    void cancel(uint64_t id);
+
+    /**
+     * @brief Delivers the response to request id and records its round trip
+     *
+     * @return false if id is not outstanding (late, duplicate or unknown)
+     */
+    bool complete(uint64_t id, std::string payload);
+
+    /**
+     * @brief Fails requests older than the timeout
+     *
+     * @return Number of requests failed
+     */
+    size_t expire(int64_t nowNs);
+
+    /**
+     * @brief Fails every outstanding request (connection closed)
+     */
+    void failAll();
+
+    size_t pending() const;
+
+private:
+    struct Slot {
+        ResponseCallback callback;
+        int64_t sentNs = 0;
+        uint8_t type = 0;
+        bool active = false;
+    };
+
+    const int64_t timeoutNs_;
+    mutable std::mutex mutex_;    ///< Guards everything below
+    std::deque<Slot> slots_;      ///< slots_[i] holds request baseId_ + i
+    uint64_t baseId_ = 1;
+    size_t active_ = 0;
+
+    void trimLocked();
+};
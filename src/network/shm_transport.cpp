@@ -0,0 +1,449 @@
+#include "shm_transport.h"
+#include "../logging/logger.h"
+#include "../metrics/metrics.h"
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <chrono>
+#include <thread>
+#include <new>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <ctime>
+#endif
+
+const char* const SHM_ATTACH_REQUEST = "SHM ATTACH ";
+const char* const SHM_NAME_PREFIX = "/hft-gateway-";
+
+namespace {
+
+const char* const SHM_ATTACHED = "SHM ATTACHED";
+const char* const SHM_REJECTED = "SHM REJECTED";
+
+constexpr uint32_t SHM_MAGIC = 0x48465453;  // "HFTS"
+constexpr uint32_t SHM_VERSION = 1;
+constexpr size_t MIN_CAPACITY = 4096;
+
+// Spin iterations before sleeping; a few microseconds on current hardware
+constexpr int SPIN_ITERATIONS = 2000;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "shared-memory ring requires address-free 64-bit atomics");
+static_assert(std::atomic<uint32_t>::is_always_lock_free,
+              "shared-memory ring requires address-free 32-bit atomics");
+
+size_t roundUpPowerOfTwo(size_t value) {
+    size_t result = MIN_CAPACITY;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+void cpuRelax() {
+    #if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+    #elif defined(__aarch64__)
+    asm volatile("yield");
+    #endif
+}
+
+void futexWait(std::atomic<uint32_t>* word, uint32_t expected, int timeoutMs) {
+    #ifdef __linux__
+    // Shared (non-private) futex: the waker lives in another process
+    timespec timeout;
+    timeout.tv_sec = timeoutMs / 1000;
+    timeout.tv_nsec = static_cast<long>(timeoutMs % 1000) * 1000000L;
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected, &timeout, nullptr, 0);
+    #else
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (word->load(std::memory_order_acquire) == expected &&
+           std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+    #endif
+}
+
+void futexWake(std::atomic<uint32_t>* word) {
+    #ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, 1, nullptr, nullptr, 0);
+    #else
+    (void)word;
+    #endif
+}
+
+/**
+ * @brief Whether name is SHM_NAME_PREFIX followed by a plain name (no '/' or "..")
+ */
+bool validChannelName(const std::string& name) {
+    const size_t prefixLen = std::strlen(SHM_NAME_PREFIX);
+    return name.size() > prefixLen && name.size() <= 255 &&
+           name.compare(0, prefixLen, SHM_NAME_PREFIX) == 0 &&
+           name.find('/', prefixLen) == std::string::npos &&
+           name.find("..") == std::string::npos;
+}
+
+/**
+ * @brief Whether the peer of a Unix domain session runs as this process's user
+ */
+bool peerIsSameUser(int socketFd) {
+    if (!isUnixSocket(socketFd)) {
+        return false;
+    }
+    #if defined(SO_PEERCRED)
+    ucred credentials{};
+    socklen_t len = sizeof(credentials);
+    if (getsockopt(socketFd, SOL_SOCKET, SO_PEERCRED, &credentials, &len) != 0) {
+        return false;
+    }
+    return credentials.uid == geteuid();
+    #else
+    uid_t uid;
+    gid_t gid;
+    return getpeereid(socketFd, &uid, &gid) == 0 && uid == geteuid();
+    #endif
+}
+
+} // namespace
+
+/**
+ * @brief Control block of one direction; producer and consumer fields on separate cache lines
+ */
+struct ShmRing {
+    alignas(64) std::atomic<uint64_t> head;       ///< Bytes written (producer-owned)
+    alignas(64) std::atomic<uint64_t> tail;       ///< Bytes consumed (consumer-owned)
+    alignas(64) std::atomic<uint32_t> signal;     ///< Futex word bumped after each publish
+    std::atomic<uint32_t> consumerWaiting;        ///< Consumer is (about to be) asleep
+    std::atomic<uint32_t> producerClosed;         ///< Producer side destroyed
+};
+
+/**
+ * @brief Region header; ring data areas follow at offsets dataOffset and dataOffset + capacity
+ */
+struct ShmRegion {
+    std::atomic<uint32_t> magic;    ///< Written last by the creator
+    uint32_t version;
+    uint64_t capacity;              ///< Bytes per ring (power of two)
+    uint64_t dataOffset;            ///< Offset of first ring's data from region start
+    ShmRing rings[2];               ///< [0] strategy -> gateway, [1] gateway -> strategy
+};
+
+
+std::shared_ptr<ShmChannel> ShmChannel::create(const std::string& name, size_t ringCapacity) {
+    const size_t capacity = roundUpPowerOfTwo(ringCapacity);
+    const size_t dataOffset = (sizeof(ShmRegion) + 63) & ~static_cast<size_t>(63);
+    const size_t totalSize = dataOffset + 2 * capacity;
+
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        LOG_ERROR("shm_open failed: {}", strerror(errno));
+        return nullptr;
+    }
+    if (ftruncate(fd, static_cast<off_t>(totalSize)) < 0) {
+        LOG_ERROR("ftruncate failed: {}", strerror(errno));
+        close(fd);
+        shm_unlink(name.c_str());
+        return nullptr;
+    }
+
+    void* mapped = mmap(nullptr, totalSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        LOG_ERROR("mmap failed: {}", strerror(errno));
+        shm_unlink(name.c_str());
+        return nullptr;
+    }
+
+    auto* region = new (mapped) ShmRegion();
+    region->version = SHM_VERSION;
+    region->capacity = capacity;
+    region->dataOffset = dataOffset;
+    for (auto& ring : region->rings) {
+        ring.head.store(0, std::memory_order_relaxed);
+        ring.tail.store(0, std::memory_order_relaxed);
+        ring.signal.store(0, std::memory_order_relaxed);
+        ring.consumerWaiting.store(0, std::memory_order_relaxed);
+        ring.producerClosed.store(0, std::memory_order_relaxed);
+    }
+    region->magic.store(SHM_MAGIC, std::memory_order_release);
+
+    std::shared_ptr<ShmChannel> channel(new ShmChannel());
+    channel->name_ = name;
+    channel->region_ = region;
+    channel->mappedSize_ = totalSize;
+    channel->creator_ = true;
+    channel->tx_ = &region->rings[0];
+    channel->rx_ = &region->rings[1];
+    channel->txData_ = static_cast<char*>(mapped) + dataOffset;
+    channel->rxData_ = static_cast<char*>(mapped) + dataOffset + capacity;
+    channel->capacity_ = capacity;
+    channel->mask_ = capacity - 1;
+    return channel;
+}
+
+std::shared_ptr<ShmChannel> ShmChannel::attach(const std::string& name) {
+    int fd = shm_open(name.c_str(), O_RDWR, 0600);
+    if (fd < 0) {
+        LOG_ERROR("shm_open failed: {}", strerror(errno));
+        return nullptr;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) < 0 || static_cast<size_t>(info.st_size) < sizeof(ShmRegion)) {
+        close(fd);
+        return nullptr;
+    }
+
+    const size_t totalSize = static_cast<size_t>(info.st_size);
+    void* mapped = mmap(nullptr, totalSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        LOG_ERROR("mmap failed: {}", strerror(errno));
+        return nullptr;
+    }
+
+    // The peer can rewrite the header at any time: read the layout once and use only that copy
+    auto* region = static_cast<ShmRegion*>(mapped);
+    const uint64_t capacity = region->capacity;
+    const uint64_t dataOffset = region->dataOffset;
+    if (region->magic.load(std::memory_order_acquire) != SHM_MAGIC ||
+        region->version != SHM_VERSION ||
+        capacity < MIN_CAPACITY || (capacity & (capacity - 1)) != 0 ||
+        dataOffset < sizeof(ShmRegion) || dataOffset > totalSize ||
+        capacity > (totalSize - dataOffset) / 2) {
+        LOG_WARN("Rejecting shared memory {}: invalid layout", name);
+        munmap(mapped, totalSize);
+        return nullptr;
+    }
+
+    std::shared_ptr<ShmChannel> channel(new ShmChannel());
+    channel->name_ = name;
+    channel->region_ = region;
+    channel->mappedSize_ = totalSize;
+    channel->creator_ = false;
+    channel->tx_ = &region->rings[1];
+    channel->rx_ = &region->rings[0];
+    channel->txData_ = static_cast<char*>(mapped) + dataOffset + capacity;
+    channel->rxData_ = static_cast<char*>(mapped) + dataOffset;
+    channel->capacity_ = capacity;
+    channel->mask_ = capacity - 1;
+    return channel;
+}
+
+ShmChannel::~ShmChannel() {
+    if (!region_) {
+        return;
+    }
+    // Wake the peer's consumer so it observes the close promptly
+    tx_->producerClosed.store(1, std::memory_order_release);
+    tx_->signal.fetch_add(1, std::memory_order_release);
+    futexWake(&tx_->signal);
+
+    munmap(region_, mappedSize_);
+    if (creator_) {
+        shm_unlink(name_.c_str());
+    }
+}
+
+bool ShmChannel::trySend(const std::string& message) {
+    const uint64_t capacity = capacity_;
+    const uint64_t mask = mask_;
+    const uint64_t frameSize = 4 + message.size();
+
+    const uint64_t head = tx_->head.load(std::memory_order_relaxed);
+    const uint64_t tail = tx_->tail.load(std::memory_order_acquire);
+    if (head - tail > capacity) {
+        // Consumer moved tail past head: treat the ring as permanently full
+        broken_.store(true, std::memory_order_relaxed);
+        return false;
+    }
+    if (capacity - (head - tail) < frameSize) {
+        return false; // Ring full
+    }
+
+    // Same header as the TCP path: 4-byte length, network byte order
+    uint32_t length = htonl(static_cast<uint32_t>(message.size()));
+    char header[4];
+    std::memcpy(header, &length, 4);
+
+    // Copy header then payload, each split at most once at the wrap point
+    uint64_t pos = head;
+    const char* parts[2] = {header, message.data()};
+    const size_t sizes[2] = {4, message.size()};
+    for (int i = 0; i < 2; ++i) {
+        const size_t offset = static_cast<size_t>(pos & mask);
+        const size_t first = std::min<size_t>(sizes[i], capacity - offset);
+        std::memcpy(txData_ + offset, parts[i], first);
+        std::memcpy(txData_, parts[i] + first, sizes[i] - first);
+        pos += sizes[i];
+    }
+
+    tx_->head.store(head + frameSize, std::memory_order_release);
+
+    // Dekker-style handshake with the consumer's waiting flag (both seq_cst)
+    tx_->signal.fetch_add(1, std::memory_order_seq_cst);
+    if (tx_->consumerWaiting.load(std::memory_order_seq_cst)) {
+        futexWake(&tx_->signal);
+    }
+    return true;
+}
+
+bool ShmChannel::receive(std::string& message, int timeoutMs) {
+    if (broken()) {
+        return false;
+    }
+    const uint64_t capacity = capacity_;
+    const uint64_t mask = mask_;
+    const uint64_t tail = rx_->tail.load(std::memory_order_relaxed);
+
+    uint64_t head = rx_->head.load(std::memory_order_acquire);
+    for (int i = 0; head == tail && i < SPIN_ITERATIONS; ++i) {
+        cpuRelax();
+        head = rx_->head.load(std::memory_order_acquire);
+    }
+
+    if (head == tail) {
+        if (timeoutMs <= 0) {
+            return false;
+        }
+        rx_->consumerWaiting.store(1, std::memory_order_seq_cst);
+        const uint32_t signal = rx_->signal.load(std::memory_order_seq_cst);
+        head = rx_->head.load(std::memory_order_seq_cst);
+        if (head == tail) {
+            futexWait(&rx_->signal, signal, timeoutMs);
+            head = rx_->head.load(std::memory_order_acquire);
+        }
+        rx_->consumerWaiting.store(0, std::memory_order_relaxed);
+        if (head == tail) {
+            return false;
+        }
+    }
+
+    // Producer publishes whole frames; a peer that does not is treated as broken
+    const uint64_t used = head - tail;
+    if (used < 4 || used > capacity) {
+        LOG_WARN("Shared memory {}: invalid ring indices (head {}, tail {})", name_, head, tail);
+        broken_.store(true, std::memory_order_relaxed);
+        return false;
+    }
+    char header[4];
+    size_t offset = static_cast<size_t>(tail & mask);
+    size_t first = std::min<size_t>(4, capacity - offset);
+    std::memcpy(header, rxData_ + offset, first);
+    std::memcpy(header + first, rxData_, 4 - first);
+
+    uint32_t length;
+    std::memcpy(&length, header, 4);
+    length = ntohl(length);
+    if (length > MessageBuffer::MAX_PAYLOAD || 4 + static_cast<uint64_t>(length) > used) {
+        LOG_WARN("Shared memory {}: invalid frame length {}", name_, length);
+        metrics.add(Counter::FramesDropped);
+        broken_.store(true, std::memory_order_relaxed);
+        return false;
+    }
+
+    offset = static_cast<size_t>((tail + 4) & mask);
+    first = std::min<size_t>(length, capacity - offset);
+    message.resize(length);
+    std::memcpy(&message[0], rxData_ + offset, first);
+    std::memcpy(&message[0] + first, rxData_, length - first);
+
+    rx_->tail.store(tail + 4 + length, std::memory_order_release);
+    return true;
+}
+
+bool ShmChannel::peerClosed() const {
+    return broken() || rx_->producerClosed.load(std::memory_order_acquire) != 0;
+}
+
+
+bool sendFramedMessage(ShmChannel& channel, const std::string& message) {
+    if (message.empty() || message.size() > MessageBuffer::MAX_PAYLOAD ||
+        4 + message.size() > channel.capacity()) {
+        return false;
+    }
+
+    int spins = 0;
+    while (!channel.trySend(message)) {
+        if (channel.peerClosed()) {
+            return false;
+        }
+        // Spin briefly for a draining consumer, then yield the core
+        if (++spins < SPIN_ITERATIONS) {
+            cpuRelax();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    metrics.add(Counter::FramesOut);
+    metrics.add(Counter::BytesOut, message.size());
+    return true;
+}
+
+bool receiveFramedMessage(ShmChannel& channel, std::string& message, int timeoutMs) {
+    if (!channel.receive(message, timeoutMs)) {
+        return false;
+    }
+    metrics.add(Counter::FramesIn);
+    metrics.add(Counter::BytesIn, message.size());
+    return true;
+}
+
+bool requestShmUpgrade(int socketFd, MessageBuffer& buffer,
+                       std::shared_ptr<ShmChannel>& channel, int timeoutMs) {
+    static std::atomic<int> channelCounter{0};
+    const std::string name = SHM_NAME_PREFIX + std::to_string(getpid()) + "-" +
+                             std::to_string(channelCounter++);
+
+    auto created = ShmChannel::create(name);
+    if (!created) {
+        return false;
+    }
+    if (!sendFramedMessage(socketFd, SHM_ATTACH_REQUEST + name)) {
+        return false;
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    std::string reply;
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (!receiveFramedMessage(socketFd, buffer, reply)) {
+            continue;
+        }
+        if (reply == SHM_ATTACHED) {
+            channel = created;
+            return true;
+        }
+        if (reply == SHM_REJECTED) {
+            return false;
+        }
+    }
+    return false;
+}
+
+bool handleShmAttachRequest(int socketFd, const std::string& message,
+                            std::shared_ptr<ShmChannel>& channel, std::string& reply) {
+    const size_t prefixLen = std::strlen(SHM_ATTACH_REQUEST);
+    if (message.compare(0, prefixLen, SHM_ATTACH_REQUEST) != 0) {
+        return false;
+    }
+
+    const std::string name = message.substr(prefixLen);
+    if (!validChannelName(name)) {
+        LOG_WARN("Rejecting shared memory attach to {}: name outside {}", name, SHM_NAME_PREFIX);
+        channel = nullptr;
+    } else if (!peerIsSameUser(socketFd)) {
+        LOG_WARN("Rejecting shared memory attach to {}: peer is not a local session of this user", name);
+        channel = nullptr;
+    } else {
+        channel = ShmChannel::attach(name);
+    }
+    reply = channel ? SHM_ATTACHED : SHM_REJECTED;
+    return true;
+}
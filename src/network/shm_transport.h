@@ -0,0 +1,153 @@
+#pragma once
+
+/**
+ * @file shm_transport.h
+ * @brief Shared-memory framed-message transport for co-located processes
+ *
+ * A channel is a POSIX shared memory region (/dev/shm) holding one SPSC byte
+ * ring per direction. Frames use the same [4 bytes: length][N bytes: payload]
+ * format and 1MB limit as the TCP path. Consumers spin briefly, then sleep on
+ * a futex (Linux) so an idle channel does not burn a core.
+ *
+ * Sessions are established over the gateway's Unix domain socket: the strategy
+ * creates the region and sends "SHM ATTACH <name>"; the gateway maps it and
+ * replies "SHM ATTACHED". The socket then only signals liveness while data
+ * flows through the rings. Requests from TCP sessions, from another user, or
+ * naming a region outside SHM_NAME_PREFIX are rejected.
+ */
+
+#include "message.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+struct ShmRegion;
+struct ShmRing;
+
+/**
+ * @class ShmChannel
+ * @brief Bidirectional framed-message channel over shared memory
+ *
+ * Single producer and single consumer per direction: one thread may send and
+ * one (other) thread may receive on each side.
+ */
+class ShmChannel {
+public:
+    /**
+     * @brief Creates and maps a new region (strategy side)
+     *
+     * @param name Shared memory name, must start with '/'
+     * @param ringCapacity Bytes per direction, rounded up to a power of two
+     * @return nullptr on error (e.g. name already exists)
+     */
+    static std::shared_ptr<ShmChannel> create(const std::string& name,
+                                              size_t ringCapacity = 4 * 1024 * 1024);
+
+    /**
+     * @brief Maps an existing region created by the peer (gateway side)
+     */
+    static std::shared_ptr<ShmChannel> attach(const std::string& name);
+
+    /**
+     * @brief Marks this side closed, unmaps, and unlinks the region if creator
+     */
+    ~ShmChannel();
+
+    ShmChannel(const ShmChannel&) = delete;
+    ShmChannel& operator=(const ShmChannel&) = delete;
+
+    /**
+     * @brief Writes one frame if the ring has room (never blocks)
+     */
+    bool trySend(const std::string& message);
+
+    /**
+     * @brief Reads one frame, spinning then sleeping up to timeoutMs for data
+     *
+     * Ring indices and frame lengths are written by the peer and validated
+     * before anything is copied; a violation marks the channel broken.
+     */
+    bool receive(std::string& message, int timeoutMs = 1);
+
+    /**
+     * @brief True once the peer has destroyed its side of the channel, or the channel is broken
+     */
+    bool peerClosed() const;
+
+    /**
+     * @brief True if the peer published an inconsistent ring (the session should be closed)
+     */
+    bool broken() const { return broken_.load(std::memory_order_relaxed); }
+
+    const std::string& name() const { return name_; }
+    size_t capacity() const { return capacity_; }  ///< Bytes per ring; larger frames can never be sent
+
+private:
+    ShmChannel() = default;
+
+    std::string name_;          ///< Shared memory object name
+    ShmRegion* region_ = nullptr;  ///< Mapped region
+    size_t mappedSize_ = 0;     ///< Bytes mapped
+    bool creator_ = false;      ///< Unlinks region on destruction
+    ShmRing* tx_ = nullptr;     ///< Ring this side produces into
+    ShmRing* rx_ = nullptr;     ///< Ring this side consumes from
+    char* txData_ = nullptr;    ///< Data area of tx_
+    char* rxData_ = nullptr;    ///< Data area of rx_
+    uint64_t capacity_ = 0;     ///< Bytes per ring, fixed when mapped (never re-read from the region)
+    uint64_t mask_ = 0;         ///< capacity_ - 1
+    std::atomic<bool> broken_{false};  ///< Peer wrote an invalid index or length
+};
+
+/**
+ * @brief Sends length-prefixed message over a shared-memory channel
+ *
+ * Waits (spin, then yield) while the ring is full. Fails if the peer closed,
+ * or at once if the frame could never fit the ring.
+ */
+bool sendFramedMessage(ShmChannel& channel, const std::string& message);
+
+/**
+ * @brief Receives one framed message (1ms wait by default, matching the socket path)
+ *
+ * @param timeoutMs 0 only spins briefly, for callers that must not block (event loops)
+ */
+bool receiveFramedMessage(ShmChannel& channel, std::string& message, int timeoutMs = 1);
+
+/**
+ * @brief Prefix of attach requests: "SHM ATTACH <name>"
+ */
+extern const char* const SHM_ATTACH_REQUEST;
+
+/**
+ * @brief Every channel name starts with this; the gateway maps nothing else
+ */
+extern const char* const SHM_NAME_PREFIX;
+
+/**
+ * @brief Creates a channel and asks the gateway to attach to it (strategy side)
+ *
+ * Sends the attach request over socketFd and waits up to timeoutMs for the reply.
+ *
+ * @param channel Output: the attached channel on success
+ * @return true if the gateway attached
+ */
+bool requestShmUpgrade(int socketFd, MessageBuffer& buffer,
+                       std::shared_ptr<ShmChannel>& channel, int timeoutMs = 1000);
+
+/**
+ * @brief Serves an attach request received on a server session
+ *
+ * Attaches only for Unix domain sessions whose peer runs as the gateway's
+ * user (SO_PEERCRED / getpeereid), and only to a name of the form
+ * SHM_NAME_PREFIX followed by no '/' or "..". Does not write to the
+ * session; the caller sends reply over the socket (before switching the
+ * data path), so it is tracked like every other frame.
+ *
+ * @param socketFd Session socket, for the peer credential check
+ * @param channel Output: the attached channel on success
+ * @param reply Output: "SHM ATTACHED" or "SHM REJECTED"
+ * @return true if message was an attach request (handled), false otherwise
+ */
+bool handleShmAttachRequest(int socketFd, const std::string& message,
+                            std::shared_ptr<ShmChannel>& channel, std::string& reply);
@@ -1,13 +1,23 @@
 #include "socket_utils.h"
+#include "../logging/logger.h"
 #include <cstring>
 #include <cerrno>
 #include <netinet/in.h>
+#include <sys/poll.h>
 #include <netinet/tcp.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 #include <fcntl.h>
 #include <arpa/inet.h>
 #include <unistd.h>
-#include <iostream>
+#include <sys/ioctl.h>
+#ifdef __linux__
+#include <linux/net_tstamp.h>
+#include <linux/sockios.h>
+#endif
+
+const char* const DEFAULT_UNIX_SOCKET_PATH = "/tmp/hft-gateway.sock";
 
 bool makeNonBlocking(int fd) {
     int flags = fcntl(fd, F_GETFL, 0);
@@ -17,10 +27,19 @@ bool makeNonBlocking(int fd) {
     return fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
 }
 
-SocketPtr startServer() {
+SocketPtr startServer(uint16_t port, const std::string& bindAddress, int bufferBytes) {
+    sockaddr_in serverAddress{};
+    serverAddress.sin_family = AF_INET;
+    serverAddress.sin_port = htons(port);
+    serverAddress.sin_addr.s_addr = INADDR_ANY;
+    if (!bindAddress.empty() && inet_pton(AF_INET, bindAddress.c_str(), &serverAddress.sin_addr) != 1) {
+        LOG_ERROR("Invalid bind address: {}", bindAddress);
+        return nullptr;
+    }
+
     int serverSocketFd = socket(AF_INET, SOCK_STREAM, 0);
     if (serverSocketFd < 0) {
-        std::cerr << "Socket creation failed: " << strerror(errno) << std::endl;
+        LOG_ERROR("Socket creation failed: {}", strerror(errno));
         return nullptr;
     }
 
@@ -37,31 +56,25 @@ SocketPtr startServer() {
     opt = 1;
     setsockopt(serverSocketFd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
     
-    // 64KB buffers reduce syscalls and improve throughput
-    int bufferSize = 64 * 1024;
-    setsockopt(serverSocketFd, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
-    setsockopt(serverSocketFd, SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize));
-
-    sockaddr_in serverAddress;
-    serverAddress.sin_family = AF_INET;
-    serverAddress.sin_port = htons(8080);
-    serverAddress.sin_addr.s_addr = INADDR_ANY;
+    // Large buffers (64KB default) reduce syscalls and improve throughput
+    setsockopt(serverSocketFd, SOL_SOCKET, SO_RCVBUF, &bufferBytes, sizeof(bufferBytes));
+    setsockopt(serverSocketFd, SOL_SOCKET, SO_SNDBUF, &bufferBytes, sizeof(bufferBytes));
 
     if (bind(serverSocketFd, (struct sockaddr*)&serverAddress, sizeof(serverAddress)) < 0) {
-        std::cerr << "Bind failed: " << strerror(errno) << std::endl;
+        LOG_ERROR("Bind failed: {}", strerror(errno));
         close(serverSocketFd);
         return nullptr;
     }
     
     // Backlog of 128 helps handle burst connection traffic
     if (listen(serverSocketFd, 128) < 0) {
-        std::cerr << "Listen failed: " << strerror(errno) << std::endl;
+        LOG_ERROR("Listen failed: {}", strerror(errno));
         close(serverSocketFd);
         return nullptr;
     }
     
     if (!makeNonBlocking(serverSocketFd)) {
-        std::cerr << "Failed to make server socket non-blocking: " << strerror(errno) << std::endl;
+        LOG_ERROR("Failed to make server socket non-blocking: {}", strerror(errno));
         close(serverSocketFd);
         return nullptr;
     }
@@ -74,21 +87,164 @@ SocketPtr startServer() {
     });
 }
 
-SocketPtr startClient() {
-    int clientSocket = socket(AF_INET, SOCK_STREAM, 0);
+namespace {
+
+/**
+ * @brief Makes path bindable: true if nothing is there or a stale socket file was removed
+ *
+ * A socket file is only stale if connecting to it is refused. One that
+ * answers belongs to a live process (another gateway's listener, admin or
+ * handoff socket) and is left alone, as is anything that is not a socket.
+ */
+bool claimUnixPath(const sockaddr_un& address, const std::string& path) {
+    struct stat info{};
+    if (lstat(path.c_str(), &info) < 0) {
+        if (errno == ENOENT) {
+            return true;
+        }
+        LOG_ERROR("Cannot inspect {}: {}", path, strerror(errno));
+        return false;
+    }
+    if (!S_ISSOCK(info.st_mode)) {
+        LOG_ERROR("{} exists and is not a socket", path);
+        return false;
+    }
+
+    // Non-blocking, so a listener with a full backlog reports EAGAIN instead of stalling startup
+    int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (probe < 0) {
+        LOG_ERROR("Socket creation failed: {}", strerror(errno));
+        return false;
+    }
+    const int result = connect(probe, reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+    const int error = errno;
+    close(probe);
+    if (result == 0 || error == EAGAIN || error == EINPROGRESS) {
+        LOG_ERROR("{} is in use by another process", path);
+        return false;
+    }
+    if (error != ECONNREFUSED && error != ENOENT) {
+        LOG_ERROR("Cannot probe {}: {}", path, strerror(error));
+        return false;
+    }
+    if (error == ECONNREFUSED && unlink(path.c_str()) < 0 && errno != ENOENT) {
+        LOG_ERROR("Cannot remove stale socket file {}: {}", path, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+SocketPtr startUnixServer(const std::string& path, int bufferBytes) {
+    sockaddr_un serverAddress{};
+    if (path.size() >= sizeof(serverAddress.sun_path)) {
+        LOG_ERROR("Unix socket path too long: {}", path);
+        return nullptr;
+    }
+    
+    int serverSocketFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (serverSocketFd < 0) {
+        LOG_ERROR("Socket creation failed: {}", strerror(errno));
+        return nullptr;
+    }
+    
+    // Buffers as for the TCP listener (no Nagle or SIGPIPE options apply to AF_UNIX)
+    setsockopt(serverSocketFd, SOL_SOCKET, SO_RCVBUF, &bufferBytes, sizeof(bufferBytes));
+    setsockopt(serverSocketFd, SOL_SOCKET, SO_SNDBUF, &bufferBytes, sizeof(bufferBytes));
+    
+    serverAddress.sun_family = AF_UNIX;
+    std::memcpy(serverAddress.sun_path, path.c_str(), path.size() + 1);
+    
+    // Remove a socket file left behind by a previous run (equivalent of SO_REUSEADDR), never a live one
+    if (!claimUnixPath(serverAddress, path)) {
+        close(serverSocketFd);
+        return nullptr;
+    }
+    
+    if (bind(serverSocketFd, (struct sockaddr*)&serverAddress, sizeof(serverAddress)) < 0) {
+        LOG_ERROR("Bind failed: {}", strerror(errno));
+        close(serverSocketFd);
+        return nullptr;
+    }
+    
+    if (listen(serverSocketFd, 128) < 0) {
+        LOG_ERROR("Listen failed: {}", strerror(errno));
+        close(serverSocketFd);
+        unlink(path.c_str());
+        return nullptr;
+    }
+    
+    if (!makeNonBlocking(serverSocketFd)) {
+        LOG_ERROR("Failed to make server socket non-blocking: {}", strerror(errno));
+        close(serverSocketFd);
+        unlink(path.c_str());
+        return nullptr;
+    }
+    
+    return SocketPtr(new int(serverSocketFd), [path](int* s){
+        if (s && *s >= 0) {
+            close(*s);
+            unlink(path.c_str());
+        }
+        delete s;
+    });
+}
+
+SocketPtr startUnixClient(const std::string& path) {
+    sockaddr_un serverAddress{};
+    if (path.size() >= sizeof(serverAddress.sun_path)) {
+        LOG_ERROR("Unix socket path too long: {}", path);
+        return nullptr;
+    }
+    
+    int clientSocket = socket(AF_UNIX, SOCK_STREAM, 0);
     if (clientSocket < 0) {
-        std::cerr << "Socket creation failed: " << strerror(errno) << std::endl;
+        LOG_ERROR("Socket creation failed: {}", strerror(errno));
         return nullptr;
     }
+    
+    serverAddress.sun_family = AF_UNIX;
+    std::memcpy(serverAddress.sun_path, path.c_str(), path.size() + 1);
+    
+    if (connect(clientSocket, (struct sockaddr *)&serverAddress, sizeof(serverAddress)) < 0) {
+        LOG_ERROR("Connect failed: {}", strerror(errno));
+        close(clientSocket);
+        return nullptr;
+    }
+    
+    return SocketPtr(new int(clientSocket), [](int* s){
+        if (s && *s >= 0) {
+            close(*s);
+        }
+        delete s;
+    });
+}
+
+bool isUnixSocket(int fd) {
+    sockaddr_storage address{};
+    socklen_t len = sizeof(address);
+    return getsockname(fd, (struct sockaddr*)&address, &len) == 0 && address.ss_family == AF_UNIX;
+}
 
-    sockaddr_in serverAddress;
+SocketPtr startClient(const std::string& host, uint16_t port) {
+    sockaddr_in serverAddress{};
     serverAddress.sin_family = AF_INET;
-    serverAddress.sin_port = htons(8080);
-    serverAddress.sin_addr.s_addr = INADDR_ANY;
+    serverAddress.sin_port = htons(port);
+    if (inet_pton(AF_INET, host.c_str(), &serverAddress.sin_addr) != 1) {
+        LOG_ERROR("Invalid server address: {}", host);
+        return nullptr;
+    }
+
+    int clientSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if (clientSocket < 0) {
+        LOG_ERROR("Socket creation failed: {}", strerror(errno));
+        return nullptr;
+    }
 
     // Blocking connect - use clientConnectThread() for non-blocking with timeout
     if (connect(clientSocket, (struct sockaddr *)&serverAddress, sizeof(serverAddress)) < 0) {
-        std::cerr << "Connect failed: " << strerror(errno) << std::endl;
+        LOG_ERROR("Connect failed: {}", strerror(errno));
         close(clientSocket);
         return nullptr;
     }
@@ -100,3 +256,114 @@ SocketPtr startClient() {
         delete s;
     });
 }
+
+bool socketPeerClosed(int fd) {
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    
+    if (poll(&pfd, 1, 0) < 0 || (pfd.revents & (POLLHUP | POLLNVAL))) {
+        return true;
+    }
+    if (pfd.revents & POLLERR) {
+        // POLLERR alone may only mean queued TX timestamps/zerocopy notifications
+        int error = 0;
+        socklen_t len = sizeof(error);
+        if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len) < 0 || error != 0) {
+            return true;
+        }
+    }
+    if (pfd.revents & POLLIN) {
+        // Readable with zero bytes available means orderly shutdown by peer
+        char byte;
+        const ssize_t peeked = recv(fd, &byte, 1, MSG_PEEK);
+        return peeked == 0 || (peeked < 0 && errno != EAGAIN && errno != EWOULDBLOCK);
+    }
+    return false;
+}
+
+bool configureKeepalive(int fd, int idleSec, int intervalSec, int count, int userTimeoutMs) {
+    bool ok = true;
+    if (idleSec > 0) {
+        int opt = 1;
+        ok &= setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &opt, sizeof(opt)) == 0;
+        #if defined(TCP_KEEPIDLE)
+        ok &= setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &idleSec, sizeof(idleSec)) == 0;
+        #elif defined(TCP_KEEPALIVE)
+        ok &= setsockopt(fd, IPPROTO_TCP, TCP_KEEPALIVE, &idleSec, sizeof(idleSec)) == 0;
+        #endif
+        #ifdef TCP_KEEPINTVL
+        ok &= setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &intervalSec, sizeof(intervalSec)) == 0;
+        #endif
+        #ifdef TCP_KEEPCNT
+        ok &= setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &count, sizeof(count)) == 0;
+        #endif
+    }
+    if (userTimeoutMs > 0) {
+        #ifdef TCP_USER_TIMEOUT
+        unsigned int timeout = static_cast<unsigned int>(userTimeoutMs);
+        ok &= setsockopt(fd, IPPROTO_TCP, TCP_USER_TIMEOUT, &timeout, sizeof(timeout)) == 0;
+        #else
+        ok = false;
+        #endif
+    }
+    if (!ok) {
+        LOG_WARN("Keepalive options rejected on fd {}: {}", fd, strerror(errno));
+    }
+    return ok;
+}
+
+bool enableRxTimestamps(int fd) {
+    #if defined(SO_TIMESTAMPING) && defined(SOF_TIMESTAMPING_RX_SOFTWARE)
+    int flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE |
+                SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE;
+    if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) == 0) {
+        return true;
+    }
+    #endif
+    #ifdef SO_TIMESTAMPNS
+    int opt = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &opt, sizeof(opt)) == 0) {
+        return true;
+    }
+    #endif
+    (void)fd;
+    return false;
+}
+
+size_t unacknowledgedBytes(int fd) {
+    int bytes = 0;
+    #if defined(SIOCOUTQ)
+    if (ioctl(fd, SIOCOUTQ, &bytes) < 0) {
+        return 0;
+    }
+    #elif defined(SO_NWRITE)
+    socklen_t len = sizeof(bytes);
+    if (getsockopt(fd, SOL_SOCKET, SO_NWRITE, &bytes, &len) < 0) {
+        return 0;
+    }
+    #else
+    (void)fd;
+    #endif
+    return bytes > 0 ? static_cast<size_t>(bytes) : 0;
+}
+
+int64_t tcpSmoothedRttNs(int fd) {
+    #if defined(__linux__) && defined(TCP_INFO)
+    tcp_info info{};
+    socklen_t len = sizeof(info);
+    if (getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &len) == 0) {
+        return static_cast<int64_t>(info.tcpi_rtt) * 1000;
+    }
+    #elif defined(TCP_CONNECTION_INFO)
+    tcp_connection_info info{};
+    socklen_t len = sizeof(info);
+    if (getsockopt(fd, IPPROTO_TCP, TCP_CONNECTION_INFO, &info, &len) == 0) {
+        return static_cast<int64_t>(info.tcpi_srtt) * 1000000;
+    }
+    #else
+    (void)fd;
+    #endif
+    return -1;
+}
@@ -8,6 +8,8 @@
  * TCP_NODELAY, optimized buffer sizes, and non-blocking I/O.
  */
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <string>
 
@@ -27,19 +29,96 @@ using SocketPtr = std::shared_ptr<int>;
 bool makeNonBlocking(int fd);
 
 /**
- * @brief Creates and configures TCP server socket on port 8080
+ * @brief Creates and configures TCP server socket (default: port 8080, all interfaces)
  * 
- * Configures: SO_REUSEADDR, TCP_NODELAY, 64KB buffers, backlog 128, non-blocking.
+ * Configures: SO_REUSEADDR, TCP_NODELAY, buffers (64KB default), backlog 128, non-blocking.
  * 
+ * @param port Listening port
+ * @param bindAddress IPv4 address to bind (empty for INADDR_ANY)
+ * @param bufferBytes SO_RCVBUF/SO_SNDBUF size (inherited by accepted sockets)
  * @return SocketPtr on success, nullptr on error
  */
-SocketPtr startServer();
+SocketPtr startServer(uint16_t port = 8080, const std::string& bindAddress = "", int bufferBytes = 64 * 1024);
 
 /**
- * @brief Creates TCP client socket and connects to localhost:8080
+ * @brief Default path of the gateway's Unix domain socket listener
+ */
+extern const char* const DEFAULT_UNIX_SOCKET_PATH;
+
+/**
+ * @brief Creates Unix domain (AF_UNIX, SOCK_STREAM) server socket at path
+ * 
+ * Removes a stale socket file first (one that refuses connections); fails
+ * if a process still listens on path or path is not a socket. Configures:
+ * buffers (64KB default), backlog 128, non-blocking. The socket file is
+ * unlinked when the last reference is released.
+ * 
+ * @return SocketPtr on success, nullptr on error
+ */
+SocketPtr startUnixServer(const std::string& path = DEFAULT_UNIX_SOCKET_PATH, int bufferBytes = 64 * 1024);
+
+/**
+ * @brief Creates Unix domain client socket and connects to path
+ * 
+ * Blocking connect; the socket is left in blocking mode.
+ * 
+ * @return SocketPtr on success, nullptr on error
+ */
+SocketPtr startUnixClient(const std::string& path = DEFAULT_UNIX_SOCKET_PATH);
+
+/**
+ * @brief True if fd is an AF_UNIX socket (TCP-level options do not apply)
+ */
+bool isUnixSocket(int fd);
+
+/**
+ * @brief Creates TCP client socket and connects to host:port (IPv4 address)
  * 
  * Blocking connect. For non-blocking with timeout, use clientConnectThread().
  * 
  * @return SocketPtr on success, nullptr on error
  */
-SocketPtr startClient();
+SocketPtr startClient(const std::string& host = "127.0.0.1", uint16_t port = 8080);
+
+/**
+ * @brief Enables kernel receive timestamps on a connected socket
+ * 
+ * Linux: SO_TIMESTAMPING with software and raw hardware RX stamps (hardware
+ * stamps also need NIC configuration via SIOCSHWTSTAMP). Falls back to
+ * SO_TIMESTAMPNS. Timestamps are read by receiveFramedMessage(..., RxTimestamp*).
+ * 
+ * @return true if any timestamping option was accepted
+ */
+bool enableRxTimestamps(int fd);
+
+/**
+ * @brief Applies TCP keepalive and TCP_USER_TIMEOUT so the kernel drops dead peers
+ * 
+ * idleSec = 0 leaves keepalive off; userTimeoutMs = 0 leaves TCP_USER_TIMEOUT
+ * at the kernel default (Linux only). With both set, a peer that vanished is
+ * detected within idleSec + intervalSec * count seconds while idle, or
+ * userTimeoutMs while sent data goes unacknowledged.
+ * 
+ * @return false if any requested option was rejected
+ */
+bool configureKeepalive(int fd, int idleSec, int intervalSec, int count, int userTimeoutMs);
+
+/**
+ * @brief Non-blocking check whether the peer has closed or reset the connection
+ * 
+ * Peeks one byte when readable so pending data is left in place. POLLERR only
+ * counts when SO_ERROR is set, since error-queue notifications also raise it.
+ */
+bool socketPeerClosed(int fd);
+
+/**
+ * @brief Bytes written to fd that the peer has not acknowledged yet
+ * 
+ * Linux: SIOCOUTQ; BSD/macOS: SO_NWRITE. Returns 0 where neither exists.
+ */
+size_t unacknowledgedBytes(int fd);
+
+/**
+ * @brief The kernel's smoothed round-trip time for a TCP socket (ns), or -1 if unavailable
+ */
+int64_t tcpSmoothedRttNs(int fd);
@@ -0,0 +1,268 @@
+#include "subscriptions.h"
+#include "../config/config.h"
+#include "../logging/logger.h"
+#include <algorithm>
+#include <cstring>
+
+const char* const SUBSCRIBE_REQUEST = "SUBSCRIBE ";
+const char* const UNSUBSCRIBE_REQUEST = "UNSUBSCRIBE ";
+
+SubscriptionIndex subscriptions;
+
+namespace {
+
+constexpr size_t MAX_SYMBOL_LENGTH = 32;
+
+/**
+ * @brief Splits "A,B, C" into symbols, skipping empty entries
+ */
+std::vector<std::string> splitSymbols(const std::string& list) {
+    std::vector<std::string> symbols;
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+        size_t first = list.find_first_not_of(' ', start);
+        size_t last = list.find_last_not_of(' ', end - 1);
+        if (first < end && last != std::string::npos && last >= first) {
+            symbols.push_back(list.substr(first, last - first + 1));
+        }
+        start = end + 1;
+    }
+    return symbols;
+}
+
+} // namespace
+
+uint32_t SubscriptionIndex::internLocked(const std::string& symbol) {
+    auto it = ids_.find(symbol);
+    if (it != ids_.end()) {
+        return it->second;
+    }
+    uint32_t id;
+    if (!freeIds_.empty()) {
+        id = freeIds_.back();
+        freeIds_.pop_back();
+        topics_[id] = {symbol, std::make_shared<const Subscribers>()};
+    } else {
+        id = static_cast<uint32_t>(topics_.size());
+        topics_.push_back({symbol, std::make_shared<const Subscribers>()});
+    }
+    ids_.emplace(symbol, id);
+    return id;
+}
+
+uint32_t SubscriptionIndex::find(const std::string& symbol) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = ids_.find(symbol);
+    return it == ids_.end() ? NO_SYMBOL : it->second;
+}
+
+SubscriptionIndex::SubscribeResult SubscriptionIndex::subscribe(const ClientConnectionPtr& conn,
+                                                                const std::string& symbol) {
+    if (!conn || symbol.empty() || symbol.size() > MAX_SYMBOL_LENGTH) {
+        return SubscribeResult::Invalid;
+    }
+    const GatewayConfig& config = gatewayConfig();
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto connIt = byConnection_.find(conn.get());
+    if (connIt != byConnection_.end() && connIt->second.conn.expired()) {
+        // A session freed without unsubscribeAll(); this one reuses its slot
+        dropOwnedLocked(conn.get());
+        connIt = byConnection_.end();
+    }
+    auto idIt = ids_.find(symbol);
+    if (connIt != byConnection_.end() && idIt != ids_.end()) {
+        const std::vector<uint32_t>& owned = connIt->second.ids;
+        if (std::find(owned.begin(), owned.end(), idIt->second) != owned.end()) {
+            return SubscribeResult::Subscribed;
+        }
+    }
+    if (connIt != byConnection_.end() && connIt->second.ids.size() >= config.maxSubscriptionsPerSession) {
+        return SubscribeResult::SessionLimit;
+    }
+    if (idIt == ids_.end() && ids_.size() >= config.maxSymbols) {
+        return SubscribeResult::SymbolLimit;
+    }
+
+    const uint32_t id = internLocked(symbol);
+    Owned& owned = byConnection_[conn.get()];
+    owned.conn = conn;
+    owned.ids.push_back(id);
+
+    // Copy-on-write: publishers holding the old list keep a consistent snapshot
+    auto updated = std::make_shared<Subscribers>(*topics_[id].subscribers);
+    updated->push_back(conn);
+    topics_[id].subscribers = std::move(updated);
+    ++subscriptionCount_;
+    return SubscribeResult::Subscribed;
+}
+
+void SubscriptionIndex::removeLocked(uint32_t id, const ClientConnection* conn) {
+    const Subscribers& current = *topics_[id].subscribers;
+    auto updated = std::make_shared<Subscribers>();
+    updated->reserve(current.size());
+    for (const auto& weak : current) {
+        auto subscriber = weak.lock();
+        if (subscriber && subscriber.get() != conn) {
+            updated->push_back(weak);
+        }
+    }
+    // Expired entries pruned here count as removed too
+    subscriptionCount_ -= current.size() - updated->size();
+
+    if (updated->empty()) {
+        // Last subscriber gone: retire the symbol so its id can be reused
+        ids_.erase(topics_[id].symbol);
+        topics_[id].symbol.clear();
+        freeIds_.push_back(id);
+    }
+    topics_[id].subscribers = std::move(updated);
+}
+
+void SubscriptionIndex::dropOwnedLocked(const ClientConnection* conn) {
+    auto connIt = byConnection_.find(conn);
+    if (connIt == byConnection_.end()) {
+        return;
+    }
+    for (uint32_t id : connIt->second.ids) {
+        // Already retired if every subscriber left; the id may since belong to another symbol
+        if (!topics_[id].symbol.empty()) {
+            removeLocked(id, conn);
+        }
+    }
+    byConnection_.erase(connIt);
+}
+
+bool SubscriptionIndex::unsubscribe(const ClientConnectionPtr& conn, const std::string& symbol) {
+    if (!conn) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto idIt = ids_.find(symbol);
+    auto connIt = byConnection_.find(conn.get());
+    if (idIt == ids_.end() || connIt == byConnection_.end()) {
+        return false;
+    }
+    std::vector<uint32_t>& owned = connIt->second.ids;
+    auto owns = std::find(owned.begin(), owned.end(), idIt->second);
+    if (owns == owned.end()) {
+        return false;
+    }
+    owned.erase(owns);
+    removeLocked(idIt->second, conn.get());
+    if (owned.empty()) {
+        byConnection_.erase(connIt);
+    }
+    return true;
+}
+
+void SubscriptionIndex::unsubscribeAll(const ClientConnection* conn) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    dropOwnedLocked(conn);
+}
+
+std::vector<std::string> SubscriptionIndex::symbolsOf(const ClientConnection* conn) const {
+    std::vector<std::string> symbols;
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto connIt = byConnection_.find(conn);
+    if (connIt != byConnection_.end() && !connIt->second.conn.expired()) {
+        for (uint32_t id : connIt->second.ids) {
+            symbols.push_back(topics_[id].symbol);
+        }
+    }
+    return symbols;
+}
+
+size_t SubscriptionIndex::publish(const std::string& symbol, const std::string& update) {
+    std::shared_ptr<const Subscribers> subscribers;
+    uint32_t id;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = ids_.find(symbol);
+        if (it == ids_.end()) {
+            return 0;
+        }
+        id = it->second;
+        subscribers = topics_[id].subscribers;
+    }
+    if (subscribers->empty()) {
+        return 0;
+    }
+
+    // One frame shared by every subscriber
+    auto frame = std::make_shared<const std::string>(symbol + " " + update);
+    size_t sent = 0;
+    for (const auto& weak : *subscribers) {
+        auto conn = weak.lock();
+        if (!conn || !conn->connected) {
+            continue;
+        }
+        if (conn->conflation) {
+            // Slow subscribers keep only the newest update; fast ones get it right away
+            conn->conflation->offer(id, frame);
+            flushConflated(conn);
+            ++sent;
+        } else if (sendToConnection(conn, frame)) {
+            ++sent;
+        }
+    }
+    return sent;
+}
+
+size_t SubscriptionIndex::symbolCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ids_.size();
+}
+
+size_t SubscriptionIndex::subscriptionCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return subscriptionCount_;
+}
+
+bool handleSubscriptionRequest(const ClientConnectionPtr& conn, const std::string& message,
+                               SessionReplies& replies) {
+    const bool subscribe = message.compare(0, std::strlen(SUBSCRIBE_REQUEST), SUBSCRIBE_REQUEST) == 0;
+    if (!subscribe && message.compare(0, std::strlen(UNSUBSCRIBE_REQUEST), UNSUBSCRIBE_REQUEST) != 0) {
+        return false;
+    }
+    const size_t prefixLen = std::strlen(subscribe ? SUBSCRIBE_REQUEST : UNSUBSCRIBE_REQUEST);
+
+    std::string applied;
+    std::string rejected;
+    for (const std::string& symbol : splitSymbols(message.substr(prefixLen))) {
+        if (!subscribe) {
+            if (subscriptions.unsubscribe(conn, symbol)) {
+                applied += applied.empty() ? symbol : "," + symbol;
+            }
+            continue;
+        }
+        switch (subscriptions.subscribe(conn, symbol)) {
+            case SubscriptionIndex::SubscribeResult::Subscribed:
+                applied += applied.empty() ? symbol : "," + symbol;
+                break;
+            case SubscriptionIndex::SubscribeResult::Invalid:
+                break;
+            case SubscriptionIndex::SubscribeResult::SessionLimit:
+            case SubscriptionIndex::SubscribeResult::SymbolLimit:
+                rejected += rejected.empty() ? symbol : "," + symbol;
+                break;
+        }
+    }
+    LOG_INFO("Session {} {} [{}]", conn->id, subscribe ? "subscribed" : "unsubscribed", applied);
+    if (!rejected.empty()) {
+        LOG_WARN("Session {} over subscription limits; rejected [{}]", conn->id, rejected);
+    }
+
+    // Acknowledge with the symbols that took effect (may be empty) and those refused by a limit
+    std::string text = std::string(subscribe ? "SUBSCRIBED " : "UNSUBSCRIBED ") + applied;
+    if (!rejected.empty()) {
+        text += " REJECTED " + rejected;
+    }
+    SessionReply reply;
+    reply.message = std::make_shared<const std::string>(std::move(text));
+    replies.push_back(std::move(reply));
+    return true;
+}
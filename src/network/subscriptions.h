@@ -0,0 +1,135 @@
+#pragma once
+
+/**
+ * @file subscriptions.h
+ * @brief Symbol-based publish/subscribe routing for server sessions
+ *
+ * Clients subscribe over the framing protocol with
+ * "SUBSCRIBE <sym>[,<sym>...]" and "UNSUBSCRIBE <sym>[,<sym>...]"; the
+ * server acknowledges with "SUBSCRIBED <syms>" / "UNSUBSCRIBED <syms>".
+ * Symbols refused by the limits below are listed after " REJECTED ".
+ * A publish for a symbol goes only to the sessions subscribed to it, as a
+ * frame "<symbol> <update>".
+ *
+ * Symbols are interned to dense ids; each id maps to an immutable subscriber
+ * list replaced on (un)subscribe, so a publish holds the lock only long
+ * enough to copy one shared_ptr and sends without it. A symbol whose last
+ * subscriber leaves is retired and its id reused, so the index stays within
+ * HFT_MAX_SYMBOLS however many names clients try.
+ */
+
+#include "connection.h"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Prefix of subscribe requests: "SUBSCRIBE <sym>[,<sym>...]"
+ */
+extern const char* const SUBSCRIBE_REQUEST;
+
+/**
+ * @brief Prefix of unsubscribe requests: "UNSUBSCRIBE <sym>[,<sym>...]"
+ */
+extern const char* const UNSUBSCRIBE_REQUEST;
+
+/**
+ * @class SubscriptionIndex
+ * @brief Symbol-to-subscriber index
+ *
+ * Thread safety: all methods may be called concurrently (receive threads
+ * subscribe, the main thread publishes).
+ */
+class SubscriptionIndex {
+public:
+    static constexpr uint32_t NO_SYMBOL = UINT32_MAX;
+
+    enum class SubscribeResult {
+        Subscribed,    ///< Added, or already subscribed
+        Invalid,       ///< Empty or too long
+        SessionLimit,  ///< conn already holds HFT_MAX_SUBSCRIPTIONS symbols
+        SymbolLimit    ///< New symbol, but HFT_MAX_SYMBOLS are already in use
+    };
+
+    /**
+     * @brief Interned id of symbol, or NO_SYMBOL if it has no subscribers
+     */
+    uint32_t find(const std::string& symbol) const;
+
+    /**
+     * @brief Adds conn to symbol's subscribers (no-op if already subscribed)
+     */
+    SubscribeResult subscribe(const ClientConnectionPtr& conn, const std::string& symbol);
+
+    /**
+     * @return false if conn was not subscribed to symbol
+     */
+    bool unsubscribe(const ClientConnectionPtr& conn, const std::string& symbol);
+
+    /**
+     * @brief Drops every subscription of conn (call when the session ends)
+     */
+    void unsubscribeAll(const ClientConnection* conn);
+
+    /**
+     * @brief Symbols conn is subscribed to, in subscription order
+     */
+    std::vector<std::string> symbolsOf(const ClientConnection* conn) const;
+
+    /**
+     * @brief Sends "<symbol> <update>" to each connected subscriber of symbol
+     *
+     * Conflating sessions get the update through their ConflationQueue: it is
+     * sent now if the socket is writable, otherwise it replaces any unsent
+     * update for the symbol.
+     *
+     * @return Number of sessions the update was sent or queued to
+     */
+    size_t publish(const std::string& symbol, const std::string& update);
+
+    size_t symbolCount() const;        ///< Symbols with at least one subscriber
+    size_t subscriptionCount() const;  ///< Entries across all subscriber lists
+
+private:
+    using Subscribers = std::vector<std::weak_ptr<ClientConnection>>;
+
+    struct Topic {
+        std::string symbol;                              ///< Empty once retired
+        std::shared_ptr<const Subscribers> subscribers;  ///< Replaced, never mutated
+    };
+
+    struct Owned {
+        std::weak_ptr<ClientConnection> conn;  ///< Tells a live session from a freed one at the same address
+        std::vector<uint32_t> ids;             ///< In subscription order
+    };
+
+    mutable std::mutex mutex_;                              ///< Guards everything below
+    std::unordered_map<std::string, uint32_t> ids_;         ///< Live symbol -> index into topics_
+    std::vector<Topic> topics_;                             ///< Indexed by symbol id
+    std::vector<uint32_t> freeIds_;                         ///< Retired ids, reused before topics_ grows
+    std::unordered_map<const ClientConnection*, Owned> byConnection_;  ///< For unsubscribeAll
+    size_t subscriptionCount_ = 0;
+
+    uint32_t internLocked(const std::string& symbol);
+    void removeLocked(uint32_t id, const ClientConnection* conn);
+    void dropOwnedLocked(const ClientConnection* conn);
+};
+
+/**
+ * @brief Global index used by server sessions and option 3
+ */
+extern SubscriptionIndex subscriptions;
+
+/**
+ * @brief Serves a subscribe/unsubscribe request received on a server session
+ *
+ * Appends the SUBSCRIBED/UNSUBSCRIBED acknowledgement to replies; the
+ * session sends it.
+ *
+ * @return true if message was a subscription request (handled), false otherwise
+ */
+bool handleSubscriptionRequest(const ClientConnectionPtr& conn, const std::string& message,
+                               SessionReplies& replies);
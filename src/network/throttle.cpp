@@ -0,0 +1,128 @@
+#include "throttle.h"
+#include "../util/tsc_clock.h"
+#include <algorithm>
+#include <strings.h>
+
+const char* const THROTTLED_NOTICE = "THROTTLED";
+
+namespace {
+constexpr double BURST_SECONDS = 0.1;  // Bucket holds 100ms of traffic
+}
+
+ThrottlePolicy throttlePolicyFromString(const std::string& name) {
+    if (strcasecmp(name.c_str(), "delay") == 0) {
+        return ThrottlePolicy::Delay;
+    }
+    if (strcasecmp(name.c_str(), "disconnect") == 0) {
+        return ThrottlePolicy::Disconnect;
+    }
+    return ThrottlePolicy::Reject;
+}
+
+void TokenBucket::configure(double ratePerSecond, double burst) {
+    if (ratePerSecond <= 0) {
+        tokensPerTick_ = 0;
+        return;
+    }
+    tokensPerTick_ = ratePerSecond / (tscTicksPerNs() * 1e9);
+    capacity_ = std::max(burst, 1.0);
+    tokens_ = capacity_;
+    lastTsc_ = readTsc();
+}
+
+void TokenBucket::refill(uint64_t nowTsc) {
+    if (nowTsc > lastTsc_) {
+        tokens_ = std::min(capacity_, tokens_ + static_cast<double>(nowTsc - lastTsc_) * tokensPerTick_);
+        lastTsc_ = nowTsc;
+    }
+}
+
+bool TokenBucket::available(uint64_t nowTsc, double cost) {
+    refill(nowTsc);
+    return tokens_ >= std::min(cost, capacity_);
+}
+
+uint64_t TokenBucket::ticksUntilClear(uint64_t nowTsc) {
+    refill(nowTsc);
+    return tokens_ < 0 ? static_cast<uint64_t>(-tokens_ / tokensPerTick_) + 1 : 0;
+}
+
+void SessionThrottle::configure(double messagesPerSecond, double bytesPerSecond, ThrottlePolicy policy) {
+    messages_.configure(messagesPerSecond, messagesPerSecond * BURST_SECONDS);
+    bytes_.configure(bytesPerSecond, bytesPerSecond * BURST_SECONDS);
+    policy_ = policy;
+    enabled_ = messages_.limited() || bytes_.limited();
+}
+
+SessionThrottle::Verdict SessionThrottle::admit(size_t bytes, bool& notify) {
+    notify = false;
+    if (!enabled_) {
+        accepted_.fetch_add(1, std::memory_order_relaxed);
+        return Verdict::Accept;
+    }
+
+    const uint64_t now = readTsc();
+    const double cost = static_cast<double>(bytes);
+    const bool withinRate = (!messages_.limited() || messages_.available(now, 1.0)) &&
+                            (!bytes_.limited() || bytes_.available(now, cost));
+
+    if (!withinRate) {
+        switch (policy_) {
+            case ThrottlePolicy::Reject:
+                rejected_.fetch_add(1, std::memory_order_relaxed);
+                notify = !rejecting_;
+                rejecting_ = true;
+                return Verdict::Reject;
+            case ThrottlePolicy::Disconnect:
+                disconnected_.store(true, std::memory_order_relaxed);
+                return Verdict::Disconnect;
+            case ThrottlePolicy::Delay:
+                // Accept into debt; readDelayNs() holds off the next read until repaid
+                delayed_.fetch_add(1, std::memory_order_relaxed);
+                break;
+        }
+    }
+
+    if (messages_.limited()) {
+        messages_.consume(1.0);
+    }
+    if (bytes_.limited()) {
+        bytes_.consume(cost);
+    }
+    rejecting_ = false;
+    accepted_.fetch_add(1, std::memory_order_relaxed);
+    return Verdict::Accept;
+}
+
+int64_t SessionThrottle::readDelayNs() {
+    if (!enabled_ || policy_ != ThrottlePolicy::Delay) {
+        return 0;
+    }
+    const uint64_t now = readTsc();
+    const uint64_t ticks = std::max(messages_.limited() ? messages_.ticksUntilClear(now) : 0,
+                                    bytes_.limited() ? bytes_.ticksUntilClear(now) : 0);
+    if (ticks == 0) {
+        return 0;
+    }
+    return std::max<int64_t>(tscToNs(static_cast<int64_t>(ticks)), 1);
+}
+
+std::string SessionThrottle::summary() const {
+    if (!enabled_) {
+        return "off";
+    }
+    std::string result = std::to_string(accepted()) + " accepted";
+    switch (policy_) {
+        case ThrottlePolicy::Reject:
+            result += ", " + std::to_string(rejected()) + " rejected";
+            break;
+        case ThrottlePolicy::Delay:
+            result += ", " + std::to_string(delayed()) + " over rate, read delayed " +
+                      std::to_string(delayedNs() / 1000000) + "ms";
+            break;
+        case ThrottlePolicy::Disconnect:
+            result += disconnected() ? ", disconnected for rate" : "";
+            break;
+    }
+    return result;
+}
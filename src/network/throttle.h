@@ -0,0 +1,138 @@
+#pragma once
+
+/**
+ * @file throttle.h
+ * @brief Per-session inbound rate limiting with token buckets
+ * 
+ * Each session can be limited in messages/sec and bytes/sec. Buckets refill
+ * continuously from TSC time (no timers, no syscalls) and hold 100ms of
+ * burst. The receive thread calls admit() for every inbound frame; what
+ * happens to frames over the limit depends on the policy.
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief What to do with a session that exceeds its rate
+ */
+enum class ThrottlePolicy {
+    Reject,     ///< Drop the frame and tell the sender ("THROTTLED"), once per burst
+    Delay,      ///< Accept the frame, then stop reading until the debt is repaid (TCP backpressure)
+    Disconnect  ///< Close the session
+};
+
+/**
+ * @brief Parses "reject", "delay" or "disconnect" (defaults to Reject)
+ */
+ThrottlePolicy throttlePolicyFromString(const std::string& name);
+
+/**
+ * @brief Notification sent to a sender whose frames are rejected
+ */
+extern const char* const THROTTLED_NOTICE;
+
+/**
+ * @class TokenBucket
+ * @brief Continuous-refill token bucket on TSC ticks (single thread)
+ */
+class TokenBucket {
+public:
+    /**
+     * @param ratePerSecond Tokens added per second (0 = unlimited)
+     * @param burst Bucket capacity in tokens
+     */
+    void configure(double ratePerSecond, double burst);
+
+    bool limited() const { return tokensPerTick_ > 0; }
+
+    /**
+     * @brief Refills to nowTsc, then reports whether cost fits
+     * 
+     * A cost larger than the whole bucket fits once the bucket is full.
+     */
+    bool available(uint64_t nowTsc, double cost);
+
+    /**
+     * @brief Removes cost; the balance may go negative (debt)
+     */
+    void consume(double cost) { tokens_ -= cost; }
+
+    /**
+     * @brief Ticks until the balance is back to zero (0 if not in debt)
+     */
+    uint64_t ticksUntilClear(uint64_t nowTsc);
+
+private:
+    double tokens_ = 0;
+    double capacity_ = 0;
+    double tokensPerTick_ = 0;
+    uint64_t lastTsc_ = 0;
+
+    void refill(uint64_t nowTsc);
+};
+
+/**
+ * @class SessionThrottle
+ * @brief Message and byte buckets for one session, plus counters for stats
+ * 
+ * admit() and readDelayNs() are called by the session's receive thread only;
+ * counters may be read from any thread.
+ */
+class SessionThrottle {
+public:
+    enum class Verdict {
+        Accept,
+        Reject,         ///< Drop the frame; notify the sender if notify is set
+        Disconnect
+    };
+
+    /**
+     * @brief Applies limits (0 = unlimited); both zero disables the throttle
+     */
+    void configure(double messagesPerSecond, double bytesPerSecond, ThrottlePolicy policy);
+
+    bool enabled() const { return enabled_; }
+    ThrottlePolicy policy() const { return policy_; }
+
+    /**
+     * @brief Charges one inbound frame of the given size
+     * 
+     * @param notify Output: true on the first rejection after an accepted frame
+     */
+    Verdict admit(size_t bytes, bool& notify);
+
+    /**
+     * @brief Delay policy: nanoseconds to wait before reading more (0 = read now)
+     */
+    int64_t readDelayNs();
+
+    /**
+     * @brief Adds time the receive thread actually spent waiting
+     */
+    void recordDelay(int64_t ns) { delayedNs_.fetch_add(static_cast<uint64_t>(ns), std::memory_order_relaxed); }
+
+    uint64_t accepted() const { return accepted_.load(std::memory_order_relaxed); }
+    uint64_t rejected() const { return rejected_.load(std::memory_order_relaxed); }
+    uint64_t delayed() const { return delayed_.load(std::memory_order_relaxed); }
+    uint64_t delayedNs() const { return delayedNs_.load(std::memory_order_relaxed); }
+    bool disconnected() const { return disconnected_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief One-line summary of counters for the stats view
+     */
+    std::string summary() const;
+
+private:
+    bool enabled_ = false;
+    ThrottlePolicy policy_ = ThrottlePolicy::Reject;
+    TokenBucket messages_;
+    TokenBucket bytes_;
+    bool rejecting_ = false;                    ///< In a run of rejections (already notified)
+    std::atomic<uint64_t> accepted_{0};         ///< Frames admitted
+    std::atomic<uint64_t> rejected_{0};         ///< Frames dropped (Reject)
+    std::atomic<uint64_t> delayed_{0};          ///< Frames that put the session in debt (Delay)
+    std::atomic<uint64_t> delayedNs_{0};        ///< Time spent not reading (Delay)
+    std::atomic<bool> disconnected_{false};     ///< Session closed for exceeding its rate
+};
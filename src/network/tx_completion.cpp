@@ -0,0 +1,296 @@
+#include "tx_completion.h"
+#include "socket_utils.h"
+#include "../logging/logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <sys/poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#ifdef __linux__
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#endif
+
+TxCompletionReader txCompletionReader;
+
+TxCompletionTracker::TxCompletionTracker(int socketFd) : socketFd_(socketFd) {}
+
+bool TxCompletionTracker::enableTimestamps() {
+    #ifdef __linux__
+    if (isUnixSocket(socketFd_)) {
+        return false; // AF_UNIX has no transmit path to stamp
+    }
+    // OPT_ID keys each stamp by byte offset; OPT_TSONLY avoids echoing payload back
+    int flags = SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE |
+                SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY;
+    timestampsEnabled_ = setsockopt(socketFd_, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) == 0;
+    #endif
+    return timestampsEnabled_;
+}
+
+bool TxCompletionTracker::enableZeroCopy() {
+    #if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+    if (isUnixSocket(socketFd_)) {
+        return false;
+    }
+    int opt = 1;
+    zeroCopyEnabled_ = setsockopt(socketFd_, SOL_SOCKET, SO_ZEROCOPY, &opt, sizeof(opt)) == 0;
+    #endif
+    return zeroCopyEnabled_;
+}
+
+void TxCompletionTracker::resume(uint32_t bytesSent, uint32_t zeroCopyCalls) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bytesQueued_ = bytesSent;
+    zeroCopyNextCall_ = zeroCopyCalls;
+    zeroCopyDoneThrough_ = zeroCopyCalls - 1;  // The previous owner's calls count as done
+    zeroCopyOutOfOrder_.clear();
+    hasEarlyStamp_ = false;  // Anything read before now belongs to the previous owner
+}
+
+uint32_t TxCompletionTracker::bytesSent() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytesQueued_;
+}
+
+uint32_t TxCompletionTracker::zeroCopyCalls() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return zeroCopyNextCall_;
+}
+
+void disableTxTimestamps(int socketFd) {
+    #ifdef __linux__
+    int flags = 0;
+    setsockopt(socketFd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags));
+    #else
+    (void)socketFd;
+    #endif
+}
+
+void TxCompletionTracker::recordSend(size_t bytes, int64_t userNs) {
+    if (!timestampsEnabled_ || bytes == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    bytesQueued_ += static_cast<uint32_t>(bytes);
+    pending_.push_back({bytesQueued_ - 1, userNs});
+    if (!hasEarlyStamp_) {
+        return;
+    }
+    // A stamp can beat the recordSend() of its own frame, never that of the next one
+    hasEarlyStamp_ = false;
+    if (static_cast<int32_t>(earlyKey_ - (bytesQueued_ - 1)) > 0) {
+        if (untrackedStamps_.fetch_add(1, std::memory_order_relaxed) == 0) {
+            LOG_WARN("TX stamp key {} on fd {} is past the {} bytes recorded: untracked write on a tracked socket",
+                     earlyKey_, socketFd_, bytesQueued_);
+        }
+        // Recorded frames all ended before the key but their timings are unreliable; resync to the kernel
+        pending_.clear();
+        bytesQueued_ = earlyKey_ + 1;
+        return;
+    }
+    completeThroughLocked(earlyKey_, earlyKernelNs_);
+}
+
+void TxCompletionTracker::pinZeroCopy(uint32_t calls, std::shared_ptr<const void> buffers) {
+    if (calls == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    zeroCopyNextCall_ += calls;
+    pinned_.push_back({zeroCopyNextCall_ - 1, std::move(buffers)});
+    
+    // Completion may have raced ahead of this registration
+    while (!pinned_.empty() &&
+           static_cast<int32_t>(zeroCopyDoneThrough_ - pinned_.front().lastCall) >= 0) {
+        pinned_.pop_front();
+    }
+}
+
+size_t TxCompletionTracker::pinnedBuffers() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pinned_.size();
+}
+
+void TxCompletionTracker::completeZeroCopy(uint32_t first, uint32_t last, bool copied) {
+    const uint64_t calls = static_cast<uint32_t>(last - first) + 1ULL;
+    zeroCopyCompleted_.fetch_add(calls, std::memory_order_relaxed);
+    if (copied) {
+        zeroCopyCopied_.fetch_add(calls, std::memory_order_relaxed);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (static_cast<int32_t>(last - zeroCopyDoneThrough_) <= 0) {
+        return;  // Already done: calls of a previous owner of the socket
+    }
+    // Ranges normally arrive in order; hold any that skip ahead until the hole fills
+    zeroCopyOutOfOrder_.emplace_back(first, last);
+    bool advanced = true;
+    while (advanced) {
+        advanced = false;
+        for (auto it = zeroCopyOutOfOrder_.begin(); it != zeroCopyOutOfOrder_.end(); ++it) {
+            if (it->first == zeroCopyDoneThrough_ + 1) {
+                zeroCopyDoneThrough_ = it->second;
+                zeroCopyOutOfOrder_.erase(it);
+                advanced = true;
+                break;
+            }
+        }
+    }
+
+    while (!pinned_.empty() &&
+           static_cast<int32_t>(zeroCopyDoneThrough_ - pinned_.front().lastCall) >= 0) {
+        pinned_.pop_front();
+    }
+}
+
+size_t TxCompletionTracker::pendingFrames() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pending_.size();
+}
+
+void TxCompletionTracker::completeThrough(uint32_t key, int64_t kernelNs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (static_cast<int32_t>(key - (bytesQueued_ - 1)) > 0) {
+        // Past the last recorded byte: the frame's recordSend() may still be on its way
+        earlyKey_ = key;
+        earlyKernelNs_ = kernelNs;
+        hasEarlyStamp_ = true;
+        return;
+    }
+    completeThroughLocked(key, kernelNs);
+}
+
+void TxCompletionTracker::completeThroughLocked(uint32_t key, int64_t kernelNs) {
+    // Bytes go out in order: every frame ending at or before key has left (serial-number compare)
+    while (!pending_.empty() && static_cast<int32_t>(key - pending_.front().lastByteKey) >= 0) {
+        sendToWire_.record(kernelNs - pending_.front().userNs);
+        pending_.pop_front();
+    }
+}
+
+bool TxCompletionTracker::processErrorQueue() {
+    #ifdef __linux__
+    for (;;) {
+        char data[64];
+        alignas(cmsghdr) char control[512];
+        iovec iov{data, sizeof(data)};
+        msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        if (recvmsg(socketFd_, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // Queue drained; POLLERR without queued entries means a real socket error
+                int error = 0;
+                socklen_t len = sizeof(error);
+                return getsockopt(socketFd_, SOL_SOCKET, SO_ERROR, &error, &len) == 0 && error == 0;
+            }
+            return false;
+        }
+
+        int64_t kernelNs = 0;
+        const sock_extended_err* extendedErr = nullptr;
+        for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPING) {
+                timespec stamps[3];
+                std::memcpy(stamps, CMSG_DATA(cmsg), sizeof(stamps));
+                kernelNs = static_cast<int64_t>(stamps[0].tv_sec) * 1000000000LL + stamps[0].tv_nsec;
+            } else if ((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) ||
+                       (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)) {
+                extendedErr = reinterpret_cast<const sock_extended_err*>(CMSG_DATA(cmsg));
+            }
+        }
+
+        if (extendedErr && extendedErr->ee_origin == SO_EE_ORIGIN_TIMESTAMPING &&
+            extendedErr->ee_info == SCM_TSTAMP_SND && kernelNs != 0) {
+            completeThrough(extendedErr->ee_data, kernelNs);
+        }
+        #ifdef SO_EE_ORIGIN_ZEROCOPY
+        if (extendedErr && extendedErr->ee_origin == SO_EE_ORIGIN_ZEROCOPY) {
+            // ee_info..ee_data: inclusive range of completed zerocopy call IDs
+            completeZeroCopy(extendedErr->ee_info, extendedErr->ee_data,
+                             (extendedErr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0);
+        }
+        #endif
+    }
+    #else
+    return true;
+    #endif
+}
+
+
+TxCompletionReader::~TxCompletionReader() {
+    stop();
+}
+
+void TxCompletionReader::add(const TxCompletionTrackerPtr& tracker) {
+    if (!tracker) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    trackers_.push_back(tracker);
+    if (!running_.exchange(true)) {
+        thread_ = std::thread(&TxCompletionReader::run, this);
+    }
+}
+
+void TxCompletionReader::remove(const TxCompletionTracker* tracker) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    trackers_.erase(
+        std::remove_if(trackers_.begin(), trackers_.end(),
+            [tracker](const std::weak_ptr<TxCompletionTracker>& entry) {
+                auto locked = entry.lock();
+                return !locked || locked.get() == tracker;
+            }),
+        trackers_.end());
+}
+
+void TxCompletionReader::stop() {
+    running_ = false;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void TxCompletionReader::run() {
+    std::vector<TxCompletionTrackerPtr> active;
+    std::vector<struct pollfd> pfds;
+
+    while (running_) {
+        active.clear();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (const auto& entry : trackers_) {
+                if (auto tracker = entry.lock()) {
+                    active.push_back(tracker);
+                }
+            }
+        }
+
+        // events = 0: error queue readiness is always reported as POLLERR
+        pfds.resize(active.size());
+        for (size_t i = 0; i < active.size(); ++i) {
+            pfds[i].fd = active[i]->socketFd();
+            pfds[i].events = 0;
+            pfds[i].revents = 0;
+        }
+
+        // 1ms timeout keeps registration changes and shutdown responsive
+        if (poll(pfds.data(), pfds.size(), 1) <= 0) {
+            continue;
+        }
+
+        for (size_t i = 0; i < active.size(); ++i) {
+            if (pfds[i].revents & (POLLNVAL | POLLHUP)) {
+                remove(active[i].get());
+            } else if ((pfds[i].revents & POLLERR) && !active[i]->processErrorQueue()) {
+                remove(active[i].get());
+            }
+        }
+    }
+}
@@ -0,0 +1,210 @@
+#pragma once
+
+/**
+ * @file tx_completion.h
+ * @brief Kernel TX completion tracking via the socket error queue
+ *
+ * With SO_TIMESTAMPING TX software stamps enabled, the kernel queues a
+ * notification on the socket error queue when the last byte of each send()
+ * is handed to the driver. A background reader drains the error queues of
+ * all registered sockets and matches notifications to the frames that
+ * produced them, giving a per-connection userspace-send to kernel-transmit
+ * latency distribution. Growth in that latency indicates queuing in the
+ * socket send buffer.
+ *
+ * The same queue carries MSG_ZEROCOPY completions: buffers passed to
+ * zerocopy sends stay pinned here until the kernel reports it no longer
+ * references their pages.
+ */
+
+#include "latency_histogram.h"
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @class TxCompletionTracker
+ * @brief Per-socket record of sent frames awaiting kernel completion
+ *
+ * Thread safety: recordSend() is called by sending threads while
+ * processErrorQueue() runs on the reader thread; both take mutex_.
+ */
+class TxCompletionTracker {
+public:
+    explicit TxCompletionTracker(int socketFd);
+
+    /**
+     * @brief Enables SO_TIMESTAMPING TX software stamps with byte-offset IDs
+     *
+     * Must be called before the first send on the socket so offsets line up.
+     * @return false if unsupported (non-Linux, or not a TCP socket)
+     */
+    bool enableTimestamps();
+
+    /**
+     * @brief Enables SO_ZEROCOPY so sends may use MSG_ZEROCOPY
+     * 
+     * @return false if unsupported by the kernel or socket type
+     */
+    bool enableZeroCopy();
+
+    /**
+     * @brief Continues the kernel's counters of a socket inherited from another process
+     *
+     * SO_TIMESTAMPING keeps its OPT_ID byte key and SO_ZEROCOPY its call id
+     * when the socket changes hands, so a fresh tracker starting at 0 would
+     * mismatch every completion. Call before the first send, with the values
+     * bytesSent() and zeroCopyCalls() had in the previous owner.
+     */
+    void resume(uint32_t bytesSent, uint32_t zeroCopyCalls);
+
+    uint32_t bytesSent() const;      ///< Timestamp key of the next byte sent (wraps)
+    uint32_t zeroCopyCalls() const;  ///< Zerocopy id of the next MSG_ZEROCOPY call (wraps)
+
+    /**
+     * @brief Records a frame whose bytes were all copied into the socket at/after userNs
+     *
+     * @param bytes Bytes written to the socket by this frame (header + payload)
+     * @param userNs CLOCK_REALTIME before the first send() of the frame
+     */
+    void recordSend(size_t bytes, int64_t userNs);
+
+    /**
+     * @brief Keeps buffers alive until the kernel completes the next `calls` zerocopy sends
+     * 
+     * @param calls Number of successful MSG_ZEROCOPY send calls made for these buffers
+     * @param buffers Owner of every byte range passed to those calls
+     */
+    void pinZeroCopy(uint32_t calls, std::shared_ptr<const void> buffers);
+
+    /**
+     * @brief Drains the error queue and completes matching frames
+     *
+     * @return false if the socket reported a real error (stop tracking)
+     */
+    bool processErrorQueue();
+
+    int socketFd() const { return socketFd_; }
+    bool timestampsEnabled() const { return timestampsEnabled_; }
+    bool zeroCopyEnabled() const { return zeroCopyEnabled_; }
+
+    /**
+     * @brief Zerocopy buffers still referenced by the kernel
+     */
+    size_t pinnedBuffers() const;
+
+    uint64_t zeroCopyCompleted() const { return zeroCopyCompleted_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Zerocopy calls the kernel completed by copying instead (e.g. loopback)
+     */
+    uint64_t zeroCopyCopied() const { return zeroCopyCopied_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Userspace send to kernel transmit delay (ns)
+     */
+    const LatencyHistogram& sendToWire() const { return sendToWire_; }
+
+    /**
+     * @brief Frames sent but not yet completed by the kernel
+     */
+    size_t pendingFrames() const;
+
+    /**
+     * @brief Stamps keyed past every byte recorded by recordSend()
+     *
+     * Non-zero means something wrote to the socket without recordSend()
+     * (bypassing sendToConnection/sendCorrelated). A stamp past the recorded
+     * bytes is held until the next recordSend(), since it may belong to the
+     * frame whose send just returned; if it is still ahead then, it is
+     * counted here and the byte offset resynchronizes to the kernel's key.
+     */
+    uint64_t untrackedStamps() const { return untrackedStamps_.load(std::memory_order_relaxed); }
+
+private:
+    struct PendingFrame {
+        uint32_t lastByteKey;   ///< Timestamp key (byte offset) of the frame's last byte
+        int64_t userNs;         ///< When the frame was handed to send()
+    };
+
+    struct PinnedBuffers {
+        uint32_t lastCall;                      ///< Last zerocopy call ID that references the buffers
+        std::shared_ptr<const void> buffers;    ///< Released once lastCall completes
+    };
+
+    int socketFd_;
+    bool timestampsEnabled_ = false;
+    bool zeroCopyEnabled_ = false;
+    uint32_t bytesQueued_ = 0;              ///< Byte offset of next send (wraps like the kernel key)
+    std::deque<PendingFrame> pending_;      ///< Frames in send order
+    uint32_t zeroCopyNextCall_ = 0;         ///< ID the kernel assigns to the next zerocopy call
+    uint32_t zeroCopyDoneThrough_ = UINT32_MAX;  ///< Highest contiguous completed call ID
+    std::vector<std::pair<uint32_t, uint32_t>> zeroCopyOutOfOrder_;  ///< Completed ranges past a hole
+    std::deque<PinnedBuffers> pinned_;      ///< Buffers in call order
+    std::atomic<uint64_t> zeroCopyCompleted_{0};  ///< Zerocopy calls completed
+    std::atomic<uint64_t> zeroCopyCopied_{0};     ///< ... of which the kernel copied anyway
+    std::atomic<uint64_t> untrackedStamps_{0};    ///< Stamps past bytesQueued_ (untracked writes)
+    bool hasEarlyStamp_ = false;            ///< A stamp arrived past bytesQueued_ (checked at the next recordSend)
+    uint32_t earlyKey_ = 0;                 ///< ... its key
+    int64_t earlyKernelNs_ = 0;             ///< ... and kernel time
+    mutable std::mutex mutex_;
+    LatencyHistogram sendToWire_;
+
+    void completeThrough(uint32_t key, int64_t kernelNs);
+    void completeThroughLocked(uint32_t key, int64_t kernelNs);
+    void completeZeroCopy(uint32_t first, uint32_t last, bool copied);
+};
+
+using TxCompletionTrackerPtr = std::shared_ptr<TxCompletionTracker>;
+
+/**
+ * @brief Turns TX timestamping off on a socket this process will not track
+ *
+ * An inherited socket keeps the previous owner's SO_TIMESTAMPING; with no
+ * reader draining it, its error queue would only grow.
+ */
+void disableTxTimestamps(int socketFd);
+
+/**
+ * @class TxCompletionReader
+ * @brief Background thread draining error queues of registered trackers
+ *
+ * Polls every registered socket for POLLERR with a 1ms timeout, so hot send
+ * paths never read the error queue themselves.
+ */
+class TxCompletionReader {
+public:
+    ~TxCompletionReader();
+
+    /**
+     * @brief Starts tracking a socket; launches the reader thread on first use
+     */
+    void add(const TxCompletionTrackerPtr& tracker);
+
+    /**
+     * @brief Stops tracking a socket (call before closing it)
+     */
+    void remove(const TxCompletionTracker* tracker);
+
+    /**
+     * @brief Stops and joins the reader thread
+     */
+    void stop();
+
+private:
+    std::vector<std::weak_ptr<TxCompletionTracker>> trackers_;  ///< Registered sockets
+    std::mutex mutex_;                                          ///< Guards trackers_
+    std::thread thread_;                                        ///< Reader thread
+    std::atomic<bool> running_{false};                          ///< Reader should continue
+
+    void run();
+};
+
+/**
+ * @brief Global reader - sessions register their trackers, main thread stops it on exit
+ */
+extern TxCompletionReader txCompletionReader;
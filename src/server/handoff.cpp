@@ -0,0 +1,474 @@
+#include "handoff.h"
+#include "../network/subscriptions.h"
+#include "../logging/logger.h"
+#include "../util/tsc_clock.h"
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+constexpr uint32_t HANDOFF_MAGIC = 0x48465432;         ///< "HFT2": changes whenever HandoffRecord does
+constexpr int HANDOFF_IO_TIMEOUT_MS = 5000;            ///< Per send/receive on the handoff connection
+constexpr int64_t MAGIC_TIMEOUT_NS = 100000000;        ///< A connecting successor's magic must arrive within this (read on the main loop)
+constexpr int64_t SESSION_STOP_TIMEOUT_NS = 200000000;  ///< Coroutine sessions notice running=false within 50ms
+constexpr char HANDOFF_ACK = 'A';
+
+enum class RecordKind : uint32_t {
+    Listener = 1,
+    Session = 2,
+    End = 3
+};
+
+struct HandoffRecord {
+    RecordKind kind;
+    int32_t id;             ///< Session id, or the next client id in the End record
+    uint32_t unreadBytes;
+    uint32_t symbolBytes;
+    uint32_t txBytes;        ///< Kernel counters the successor's TxCompletionTracker resumes from
+    uint32_t zeroCopyCalls;
+};
+
+/**
+ * @brief Blocking I/O with timeouts: the handoff is a short control exchange off the data path
+ */
+bool configureHandoffSocket(int fd) {
+    const int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags & ~O_NONBLOCK) < 0) {
+        return false;
+    }
+    timeval timeout{HANDOFF_IO_TIMEOUT_MS / 1000, (HANDOFF_IO_TIMEOUT_MS % 1000) * 1000};
+    return setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) == 0 &&
+           setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)) == 0;
+}
+
+bool sendAll(int fd, const void* data, size_t len) {
+    const char* bytes = static_cast<const char*>(data);
+    while (len > 0) {
+        const ssize_t sent = send(fd, bytes, len, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            if (sent < 0 && errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        bytes += sent;
+        len -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+bool receiveAll(int fd, void* data, size_t len) {
+    char* bytes = static_cast<char*>(data);
+    while (len > 0) {
+        const ssize_t received = recv(fd, bytes, len, 0);
+        if (received <= 0) {
+            if (received < 0 && errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        bytes += received;
+        len -= static_cast<size_t>(received);
+    }
+    return true;
+}
+
+/**
+ * @brief receiveAll() bounded by timeoutNs in total, for reads the main loop waits on
+ */
+bool receiveWithin(int fd, void* data, size_t len, int64_t timeoutNs) {
+    char* bytes = static_cast<char*>(data);
+    const int64_t deadlineNs = static_cast<int64_t>(steadyClockNs()) + timeoutNs;
+    while (len > 0) {
+        const int64_t remainingNs = deadlineNs - static_cast<int64_t>(steadyClockNs());
+        if (remainingNs <= 0) {
+            return false;
+        }
+        pollfd pfd{fd, POLLIN, 0};
+        const int ready = poll(&pfd, 1, static_cast<int>((remainingNs + 999999) / 1000000));
+        if (ready < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ready <= 0) {
+            return false;
+        }
+        const ssize_t received = recv(fd, bytes, len, MSG_DONTWAIT);
+        if (received < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) {
+            continue;
+        }
+        if (received <= 0) {
+            return false;
+        }
+        bytes += received;
+        len -= static_cast<size_t>(received);
+    }
+    return true;
+}
+
+/**
+ * @brief Sends a record with passedFd attached (if >= 0), then its payload
+ */
+bool sendRecord(int fd, const HandoffRecord& record, int passedFd, const std::string& payload) {
+    iovec iov{const_cast<HandoffRecord*>(&record), sizeof(record)};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+    if (passedFd >= 0) {
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        std::memcpy(CMSG_DATA(cmsg), &passedFd, sizeof(int));
+    }
+    ssize_t sent;
+    do {
+        sent = sendmsg(fd, &msg, MSG_NOSIGNAL);
+    } while (sent < 0 && errno == EINTR);
+    if (sent < 0) {
+        return false;
+    }
+    // The fd travels with the first byte; the rest of the header may follow separately
+    const char* rest = reinterpret_cast<const char*>(&record) + sent;
+    return sendAll(fd, rest, sizeof(record) - static_cast<size_t>(sent)) &&
+           sendAll(fd, payload.data(), payload.size());
+}
+
+/**
+ * @brief Receives a record header and its attached fd (-1 if none)
+ */
+bool receiveRecord(int fd, HandoffRecord& record, int& passedFd) {
+    passedFd = -1;
+    iovec iov{&record, sizeof(record)};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    ssize_t received;
+    do {
+        #ifdef MSG_CMSG_CLOEXEC
+        received = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+        #else
+        received = recvmsg(fd, &msg, 0);
+        #endif
+    } while (received < 0 && errno == EINTR);
+    if (received <= 0) {
+        return false;
+    }
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            std::memcpy(&passedFd, CMSG_DATA(cmsg), sizeof(int));
+        }
+    }
+    char* rest = reinterpret_cast<char*>(&record) + received;
+    if (!receiveAll(fd, rest, sizeof(record) - static_cast<size_t>(received))) {
+        if (passedFd >= 0) {
+            close(passedFd);
+            passedFd = -1;
+        }
+        return false;
+    }
+    return true;
+}
+
+SocketPtr wrapSocket(int fd) {
+    return SocketPtr(new int(fd), [](int* s){
+        if (s && *s >= 0) {
+            close(*s);
+        }
+        delete s;
+    });
+}
+
+/**
+ * @brief Wraps an inherited Unix listener so it removes its socket file on close, like startUnixServer()
+ */
+SocketPtr wrapUnixListener(int fd) {
+    sockaddr_un address{};
+    socklen_t length = sizeof(address);
+    std::string path;
+    if (getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length) == 0 && address.sun_path[0]) {
+        path = address.sun_path;
+    }
+    return SocketPtr(new int(fd), [path](int* s){
+        if (s && *s >= 0) {
+            close(*s);
+            if (!path.empty()) {
+                unlink(path.c_str());
+            }
+        }
+        delete s;
+    });
+}
+
+/**
+ * @brief Closes this process's descriptor without running the owner's cleanup (unlink)
+ */
+void releaseSocket(SocketPtr& socket) {
+    if (socket && *socket >= 0) {
+        close(*socket);
+        *socket = -1;
+    }
+    socket.reset();
+}
+
+std::vector<std::string> splitSymbols(const std::string& list) {
+    std::vector<std::string> symbols;
+    size_t start = 0;
+    while (start < list.size()) {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+        if (end > start) {
+            symbols.push_back(list.substr(start, end - start));
+        }
+        start = end + 1;
+    }
+    return symbols;
+}
+
+} // namespace
+
+bool HandoffListener::start(const std::string& path) {
+    if (socket_) {
+        return true;
+    }
+    socket_ = startUnixServer(path);
+    if (!socket_) {
+        LOG_ERROR("Cannot listen for hot restart on {}", path);
+        return false;
+    }
+    LOG_INFO("Hot restart handoff listening on {}", path);
+    return true;
+}
+
+void HandoffListener::stop() {
+    socket_.reset();
+}
+
+SocketPtr HandoffListener::acceptSuccessor() {
+    if (!socket_ || *socket_ < 0) {
+        return nullptr;
+    }
+    const int fd = accept(*socket_, nullptr, nullptr);
+    if (fd < 0) {
+        return nullptr;
+    }
+    SocketPtr successor = wrapSocket(fd);
+    uint32_t magic = 0;
+    // Not the 5s SO_RCVTIMEO: a silent connect must not stall the main loop
+    if (!configureHandoffSocket(fd) || !receiveWithin(fd, &magic, sizeof(magic), MAGIC_TIMEOUT_NS) ||
+        magic != HANDOFF_MAGIC) {
+        LOG_WARN("Ignoring invalid hot restart request");
+        return nullptr;
+    }
+
+    // Leave the socket file for the successor to bind
+    releaseSocket(socket_);
+    LOG_INFO("Successor connected for hot restart");
+    return successor;
+}
+
+std::vector<HandoffSession> detachSessions(std::vector<ClientConnectionPtr>& sessions) {
+    std::vector<ClientConnectionPtr> kept;
+    std::vector<ClientConnectionPtr> moving;
+    std::vector<std::vector<std::string>> symbols;
+
+    // Subscriptions first: receive loops drop them as they exit
+    for (auto& conn : sessions) {
+        if (conn->shmAttached || !conn->connected || !conn->socket || *conn->socket < 0) {
+            kept.push_back(conn);
+            continue;
+        }
+        symbols.push_back(subscriptions.symbolsOf(conn.get()));
+        moving.push_back(conn);
+        conn->running = false;
+    }
+
+    std::vector<HandoffSession> detached;
+    const int64_t deadlineNs = static_cast<int64_t>(steadyClockNs()) + SESSION_STOP_TIMEOUT_NS;
+    for (size_t i = 0; i < moving.size(); ++i) {
+        const ClientConnectionPtr& conn = moving[i];
+        if (conn->receiveThread.joinable()) {
+            conn->receiveThread.join();
+        } else {
+            // Coroutine sessions clear connected as their loop exits
+            while (conn->connected && static_cast<int64_t>(steadyClockNs()) < deadlineNs) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            if (conn->connected) {
+                kept.push_back(conn);
+                continue;
+            }
+        }
+
+        flushConflated(conn);  // Latest values still queued would otherwise be lost
+        HandoffSession record;
+        record.id = conn->id;
+        record.unread = conn->buffer.unread();
+        record.symbols = std::move(symbols[i]);
+        if (conn->txTracker) {
+            txCompletionReader.remove(conn->txTracker.get());
+            record.txBytes = conn->txTracker->bytesSent();
+            record.zeroCopyCalls = conn->txTracker->zeroCopyCalls();
+            conn->txTracker.reset();
+        }
+        record.socket = std::move(conn->socket);  // ~ClientConnection must not shut it down
+        detached.push_back(std::move(record));
+    }
+    sessions.swap(kept);
+    return detached;
+}
+
+std::vector<ClientConnectionPtr> adoptSessions(std::vector<HandoffSession>& sessions, const ListenerSet& listeners) {
+    std::vector<ClientConnectionPtr> adopted;
+    adopted.reserve(sessions.size());
+    for (auto& record : sessions) {
+        if (!record.socket || *record.socket < 0) {
+            continue;
+        }
+        const ServerListener* listener = listeners.find(*record.socket);
+        auto conn = createServerSession(std::move(record.socket), record.id, listener ? listener->slab : nullptr);
+        // The socket's timestamp key and zerocopy ids kept counting in the old process
+        if (conn->txTracker) {
+            conn->txTracker->resume(record.txBytes, record.zeroCopyCalls);
+        }
+        if (!conn->txTracker || !conn->txTracker->timestampsEnabled()) {
+            disableTxTimestamps(*conn->socket);
+        }
+        if (!record.unread.empty()) {
+            conn->buffer.addData(record.unread.data(), record.unread.size());
+        }
+        for (const auto& symbol : record.symbols) {
+            subscriptions.subscribe(conn, symbol);
+        }
+        if (listener) {
+            conn->listener = listener->index;
+        }
+        startServerSession(conn, listener ? listener->loops : nullptr);
+        adopted.push_back(conn);
+        LOG_INFO("Session {} adopted ({} unread bytes, {} subscriptions)",
+                 conn->id, record.unread.size(), record.symbols.size());
+    }
+    sessions.clear();
+    return adopted;
+}
+
+bool sendHandoff(int successorFd, const HandoffState& state) {
+    for (const SocketPtr& listener : state.listeners) {
+        if (listener && *listener >= 0 &&
+            !sendRecord(successorFd, {RecordKind::Listener, 0, 0, 0, 0, 0}, *listener, {})) {
+            LOG_ERROR("Hot restart: sending listener failed: {}", strerror(errno));
+            return false;
+        }
+    }
+    for (const auto& session : state.sessions) {
+        std::string symbols;
+        for (const auto& symbol : session.symbols) {
+            symbols += (symbols.empty() ? "" : ",") + symbol;
+        }
+        const HandoffRecord record{RecordKind::Session, session.id,
+                                   static_cast<uint32_t>(session.unread.size()),
+                                   static_cast<uint32_t>(symbols.size()),
+                                   session.txBytes, session.zeroCopyCalls};
+        if (!sendRecord(successorFd, record, *session.socket, session.unread + symbols)) {
+            LOG_ERROR("Hot restart: sending session {} failed: {}", session.id, strerror(errno));
+            return false;
+        }
+    }
+    char ack = 0;
+    if (!sendRecord(successorFd, {RecordKind::End, state.nextClientId, 0, 0, 0, 0}, -1, {}) ||
+        !receiveAll(successorFd, &ack, sizeof(ack)) || ack != HANDOFF_ACK) {
+        LOG_ERROR("Hot restart: successor did not acknowledge");
+        return false;
+    }
+    LOG_INFO("Hot restart: handed off listeners and {} sessions", state.sessions.size());
+    return true;
+}
+
+bool receiveHandoff(const std::string& path, HandoffState& state) {
+    SocketPtr owner = startUnixClient(path);
+    if (!owner) {
+        LOG_INFO("Hot restart: no gateway on {}", path);
+        return false;
+    }
+    const uint32_t magic = HANDOFF_MAGIC;
+    if (!configureHandoffSocket(*owner) || !sendAll(*owner, &magic, sizeof(magic))) {
+        return false;
+    }
+
+    HandoffState received;
+    while (true) {
+        HandoffRecord record{};
+        int fd = -1;
+        if (!receiveRecord(*owner, record, fd)) {
+            LOG_ERROR("Hot restart: transfer from {} broke off", path);
+            return false;  // Received sockets close; the owner keeps its own copies
+        }
+        if (record.kind == RecordKind::End) {
+            received.nextClientId = std::max(record.id, 1);
+            break;
+        }
+        if (fd < 0) {
+            LOG_ERROR("Hot restart: record without a descriptor");
+            return false;
+        }
+        if (record.kind == RecordKind::Listener) {
+            // Plain wrapper until acknowledged: a broken transfer must not remove the owner's socket file
+            received.listeners.push_back(wrapSocket(fd));
+            continue;
+        }
+        HandoffSession session;
+        session.socket = wrapSocket(fd);
+        session.id = record.id;
+        session.txBytes = record.txBytes;
+        session.zeroCopyCalls = record.zeroCopyCalls;
+        std::string payload(static_cast<size_t>(record.unreadBytes) + record.symbolBytes, '\0');
+        if (!receiveAll(*owner, payload.data(), payload.size())) {
+            return false;
+        }
+        session.unread = payload.substr(0, record.unreadBytes);
+        session.symbols = splitSymbols(payload.substr(record.unreadBytes));
+        received.sessions.push_back(std::move(session));
+    }
+
+    const char ack = HANDOFF_ACK;
+    if (!sendAll(*owner, &ack, sizeof(ack))) {
+        return false;
+    }
+    for (auto& listener : received.listeners) {
+        if (isUnixSocket(*listener)) {
+            const int fd = *listener;
+            *listener = -1;
+            listener = wrapUnixListener(fd);
+        }
+    }
+    state = std::move(received);
+    LOG_INFO("Hot restart: took over {} listeners and {} sessions", state.listeners.size(), state.sessions.size());
+    return true;
+}
+
+void releaseHandoff(HandoffState& state) {
+    for (auto& listener : state.listeners) {
+        releaseSocket(listener);
+    }
+    state.listeners.clear();
+    for (auto& session : state.sessions) {
+        releaseSocket(session.socket);
+    }
+    state.sessions.clear();
+}
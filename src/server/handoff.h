@@ -0,0 +1,126 @@
+#pragma once
+
+/**
+ * @file handoff.h
+ * @brief Hot restart: hands the listening sockets (and optionally live sessions) to a new process
+ *
+ * While its server runs, the gateway listens on HFT_HANDOFF_SOCKET. A new
+ * binary started with HFT_TAKEOVER=1 connects there from option 1 instead of
+ * binding, and receives every listener over SCM_RIGHTS (matched to its
+ * HFT_LISTENERS entry by bound address). The listeners are never closed,
+ * so connects arriving during the upgrade wait in the kernel backlog
+ * instead of being refused. With HFT_HANDOFF_SESSIONS=1
+ * established sessions move too, with their unread bytes and symbol
+ * subscriptions; the old process logs out whatever it keeps and exits.
+ *
+ * Protocol (AF_UNIX stream, same host, native byte order):
+ * - successor -> owner: uint32 HANDOFF_MAGIC
+ * - owner -> successor: one HandoffRecord per listener and session, each
+ *   carrying its fd as SCM_RIGHTS and followed by the session's unread bytes
+ *   and comma-separated symbols, then an End record with the next client id.
+ *   Session records also carry the TX timestamp key and zerocopy id the
+ *   kernel will use next on that socket; neither counter resets on transfer
+ * - successor -> owner: one ack byte once everything arrived
+ *
+ * Without the ack the owner keeps its listeners and sessions and resumes.
+ */
+
+#include "../network/socket_utils.h"
+#include "../network/connection.h"
+#include "server.h"
+#include <string>
+#include <vector>
+
+/**
+ * @struct HandoffSession
+ * @brief A live session in transit between processes
+ */
+struct HandoffSession {
+    SocketPtr socket;
+    int id = 0;
+    std::string unread;                 ///< Bytes received but not yet framed
+    std::vector<std::string> symbols;   ///< Symbol subscriptions to restore
+    uint32_t txBytes = 0;               ///< Bytes sent so far: the socket's SO_TIMESTAMPING OPT_ID key
+    uint32_t zeroCopyCalls = 0;         ///< MSG_ZEROCOPY calls so far: the socket's next zerocopy id
+};
+
+/**
+ * @struct HandoffState
+ * @brief Everything one gateway passes to its successor
+ */
+struct HandoffState {
+    std::vector<SocketPtr> listeners;
+    std::vector<HandoffSession> sessions;
+    int nextClientId = 1;               ///< Session ids keep counting across the restart
+};
+
+/**
+ * @class HandoffListener
+ * @brief Rendezvous socket a successor connects to, polled by the main loop
+ */
+class HandoffListener {
+public:
+    /**
+     * @brief Listens on path (replacing a stale socket file)
+     */
+    bool start(const std::string& path);
+
+    /**
+     * @brief Closes the listener and removes its socket file
+     */
+    void stop();
+
+    bool running() const { return socket_ != nullptr; }
+
+    /**
+     * @brief Non-blocking: returns a successor that sent a valid request, or nullptr
+     *
+     * On success the listener is closed without removing its socket file, so
+     * the successor can bind the same path for the next upgrade.
+     */
+    SocketPtr acceptSuccessor();
+
+private:
+    SocketPtr socket_;
+};
+
+/**
+ * @brief Stops sessions and moves their sockets into handoff records
+ *
+ * Subscriptions are read first, then every receive loop is stopped and
+ * waited for. Sessions that cannot move (shared-memory transport, already
+ * disconnected, or a loop that did not stop in time) stay in sessions;
+ * the rest are removed from it and no longer own their socket.
+ */
+std::vector<HandoffSession> detachSessions(std::vector<ClientConnectionPtr>& sessions);
+
+/**
+ * @brief Restarts handed-off sessions in this process
+ *
+ * Each session is attributed to the listener whose address it was accepted
+ * on, and runs on that listener's loops. Used by the successor, and by the
+ * owner to resume after a failed handoff.
+ */
+std::vector<ClientConnectionPtr> adoptSessions(std::vector<HandoffSession>& sessions, const ListenerSet& listeners);
+
+/**
+ * @brief Sends state to a successor returned by acceptSuccessor()
+ *
+ * @return true once the successor acknowledged; the caller then releases its copies
+ */
+bool sendHandoff(int successorFd, const HandoffState& state);
+
+/**
+ * @brief Takes over from the gateway listening on path
+ *
+ * @return false if no gateway answered or the transfer broke off
+ */
+bool receiveHandoff(const std::string& path, HandoffState& state);
+
+/**
+ * @brief Closes this process's copies of handed-off sockets
+ *
+ * Neither shuts the connections down nor removes the Unix socket file: the
+ * successor now owns them.
+ */
+void releaseHandoff(HandoffState& state);
@@ -1,11 +1,232 @@
 #include "server.h"
 #include "../network/socket_utils.h"
+#include "../network/multicast.h"
+#include "../network/subscriptions.h"
+#include "../network/idle_reaper.h"
+#include "../network/async_io.h"
+#include "../config/config.h"
+#include "../logging/logger.h"
+#include "../metrics/metrics.h"
+#include "../util/tsc_clock.h"
 #include <sys/socket.h>
 #include <sys/poll.h>
+#include <netinet/in.h>
 #include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/un.h>
 #include <cerrno>
+#include <cstring>
 #include <unistd.h>
 #include <algorithm>
+#include <cstdio>
+#include <chrono>
+#include <thread>
+
+const char* const LOGOUT_NOTICE = "LOGOUT";
+const char* const ACK_RESPONSE = "ACK";
+
+namespace {
+
+constexpr int64_t SHUTDOWN_CHECK_NS = 50000000;  ///< Coroutine sessions re-check running/connected at least this often
+constexpr int64_t SHM_POLL_NS = 1000000;         ///< Shared-memory ring poll interval for coroutine sessions
+
+/**
+ * @brief Charges an inbound frame to the session's throttle
+ * 
+ * A THROTTLED notice for the peer is appended to replies.
+ * 
+ * @return false if the frame must be dropped (rejected, or session closed for rate)
+ */
+bool admitFrame(const ClientConnectionPtr& clientConn, const std::string& message, SessionReplies& replies) {
+    // Any frame counts as activity for the idle timeout, even one the throttle drops
+    if (gatewayConfig().idleTimeoutMs > 0) {
+        clientConn->lastActivityNs.store(static_cast<int64_t>(steadyClockNs()), std::memory_order_relaxed);
+    }
+    
+    bool notify = false;
+    switch (clientConn->throttle.admit(message.size(), notify)) {
+        case SessionThrottle::Verdict::Accept:
+            return true;
+        case SessionThrottle::Verdict::Reject:
+            metrics.add(Counter::ThrottleRejected);
+            if (notify) {
+                // Once per run of rejections, so the notice itself cannot flood the peer
+                static const auto notice = std::make_shared<const std::string>(THROTTLED_NOTICE);
+                LOG_WARN("Session {} over rate; rejecting frames", clientConn->id);
+                replies.push_back({notice, 0, 0, nullptr});
+            }
+            return false;
+        case SessionThrottle::Verdict::Disconnect:
+            LOG_WARN("Session {} over rate; disconnecting", clientConn->id);
+            metrics.add(Counter::ThrottleRejected);
+            metrics.add(Counter::SessionsClosed);
+            shutdown(*clientConn->socket, SHUT_RDWR);
+            clientConn->connected = false;
+            clientConn->running = false;
+            receivedMessages.push("System", "Client " + std::to_string(clientConn->id) +
+                                  " disconnected: rate limit exceeded", clientConn->id);
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Handles one frame received over the session's socket
+ * 
+ * Answers control requests (retransmit, subscription, shm attach) and
+ * queues everything else for the main thread. Correlated messages are
+ * acknowledged with an ACK frame echoing their type and correlation id.
+ * Answers go to replies for the caller to send.
+ */
+void dispatchSocketFrame(const ClientConnectionPtr& clientConn, const std::string& message,
+                         const RxTimestamp* rxTimestamp, SessionReplies& replies) {
+    const uint64_t correlationId = clientConn->buffer.correlationId();
+    const uint8_t type = clientConn->buffer.frameType();
+    LOG_INFO("Session {} received {} bytes", clientConn->id, message.size());
+    clientConn->traffic.recordIn(message.size());
+    if (rxTimestamp && rxTimestamp->kernelNs) {
+        clientConn->rxWakeup.record(rxTimestamp->wakeupDelayNs());
+    }
+    if (!admitFrame(clientConn, message, replies)) {
+        return;
+    }
+    
+    // Multicast gap recovery requests are answered on this session
+    std::vector<std::string> packets;
+    if (handleRetransmitRequest(message, packets)) {
+        for (auto& packet : packets) {
+            replies.push_back({std::make_shared<const std::string>(std::move(packet)), 0, 0, nullptr});
+        }
+        return;
+    }
+    
+    // Symbol subscriptions route option 3 publishes to this session
+    if (handleSubscriptionRequest(clientConn, message, replies)) {
+        return;
+    }
+    
+    // Co-located strategies upgrade their data path to shared memory
+    std::shared_ptr<ShmChannel> shm;
+    std::string reply;
+    if (handleShmAttachRequest(*clientConn->socket, message, shm, reply)) {
+        // Reply goes over the socket: the data path switches only after it is sent
+        replies.push_back({std::make_shared<const std::string>(std::move(reply)), 0, 0, shm});
+        return;
+    }
+    std::string formattedMsg = "[SERVER] receives [CLIENT" + 
+                               std::to_string(clientConn->id) + 
+                               "] message [\"" + message + "\"]";
+    receivedMessages.push("Server", formattedMsg, clientConn->id);
+    if (correlationId) {
+        static const auto ack = std::make_shared<const std::string>(ACK_RESPONSE);
+        replies.push_back({ack, type, correlationId, nullptr});
+    }
+}
+
+/**
+ * @brief Handles one frame received over the session's shared-memory channel
+ */
+void dispatchShmFrame(const ClientConnectionPtr& clientConn, const std::string& message, SessionReplies& replies) {
+    LOG_INFO("Session {} received {} bytes (shm)", clientConn->id, message.size());
+    clientConn->traffic.recordIn(message.size());
+    if (!admitFrame(clientConn, message, replies)) {
+        return;
+    }
+    if (handleSubscriptionRequest(clientConn, message, replies)) {
+        return;
+    }
+    std::string formattedMsg = "[SERVER] receives [CLIENT" + 
+                               std::to_string(clientConn->id) + 
+                               "] message [\"" + message + "\"]";
+    receivedMessages.push("Server", formattedMsg, clientConn->id);
+}
+
+/**
+ * @brief Runs once reply is on the wire: an shm attach reply switches the data path
+ */
+void replySent(const ClientConnectionPtr& clientConn, const SessionReply& reply) {
+    if (!reply.attach) {
+        return;
+    }
+    clientConn->shm = reply.attach;
+    clientConn->shmAttached = true;
+    LOG_INFO("Session {} attached shared memory {}", clientConn->id, reply.attach->name());
+    receivedMessages.push("System", "Client " + std::to_string(clientConn->id) +
+                          " switched to shared memory transport", clientConn->id);
+}
+
+void replyFailed(const ClientConnectionPtr& clientConn, const SessionReply& reply) {
+    if (reply.correlationId) {
+        LOG_WARN("Session {} could not acknowledge request {}", clientConn->id, reply.correlationId);
+    } else {
+        LOG_WARN("Session {} could not send a reply", clientConn->id);
+    }
+}
+
+/**
+ * @brief Sends replies in order from a receive thread; stops at the first failure
+ */
+void sendReplies(const ClientConnectionPtr& clientConn, SessionReplies& replies) {
+    for (const SessionReply& reply : replies) {
+        if (!sendReply(clientConn, reply)) {
+            replyFailed(clientConn, reply);
+            break;
+        }
+        replySent(clientConn, reply);
+    }
+    replies.clear();
+}
+
+/**
+ * @brief sendReplies() for coroutine sessions: suspends instead of blocking the loop
+ */
+Task<void> asyncSendReplies(EventLoop& loop, const ClientConnectionPtr& clientConn, SessionReplies& replies) {
+    for (const SessionReply& reply : replies) {
+        if (!co_await asyncSendReply(loop, clientConn, reply)) {
+            replyFailed(clientConn, reply);
+            break;
+        }
+        replySent(clientConn, reply);
+    }
+    replies.clear();
+}
+
+/**
+ * @brief Marks the session closed by its peer (or by the idle timeout)
+ */
+void sessionDisconnected(const ClientConnectionPtr& clientConn) {
+    clientConn->connected = false;
+    metrics.add(Counter::SessionsClosed);
+    if (clientConn->idleReaped) {
+        // Let the accept thread drop the connection so its socket and buffers go too
+        recordReapedSession(*clientConn);
+        clientConn->running = false;
+        return;
+    }
+    LOG_INFO("Session {} disconnected", clientConn->id);
+    receivedMessages.push("System", "Client disconnected", clientConn->id);
+}
+
+/**
+ * @brief Idle timeout of a coroutine session, kept on its loop's timer wheel
+ */
+struct SessionIdleTimer {
+    EventLoop& loop;
+    ClientConnection& conn;
+    int64_t timeoutNs;
+    TimerNode timer{&SessionIdleTimer::expired, this};
+
+    static void expired(void* context) {
+        auto* self = static_cast<SessionIdleTimer*>(context);
+        const int64_t nextCheckNs = checkIdleSession(self->conn, static_cast<int64_t>(steadyClockNs()),
+                                                     self->timeoutNs);
+        if (nextCheckNs) {
+            self->loop.timers().schedule(self->timer, nextCheckNs);
+        }
+    }
+};
+
+} // namespace
 
 void serverReceiveThread(ClientConnectionPtr clientConn) {
     if (!clientConn || !clientConn->socket || *clientConn->socket < 0) {
@@ -14,42 +235,324 @@ void serverReceiveThread(ClientConnectionPtr clientConn) {
     
     clientConn->connected = true;
     std::string message;
+    SessionReplies replies;
+    RxTimestamp rxTimestamp;
+    RxTimestamp* rxTimestampOut = gatewayConfig().rxTimestamps ? &rxTimestamp : nullptr;
     
     while (clientConn->running && clientConn->connected && 
            clientConn->socket && *clientConn->socket >= 0) {
-        if (receiveFramedMessage(*clientConn->socket, clientConn->buffer, message)) {
-            std::string formattedMsg = "[SERVER] receives [CLIENT" + 
-                                       std::to_string(clientConn->id) + 
-                                       "] message [\"" + message + "\"]";
-            receivedMessages.push("Server", formattedMsg);
+        // Conflated updates left behind when the socket was last full
+        flushConflated(clientConn);
+        
+        // Delay policy: stop reading while over rate so TCP pushes back on the sender
+        if (const int64_t delayNs = clientConn->throttle.readDelayNs()) {
+            const int64_t waitNs = std::min<int64_t>(delayNs, 1000000);  // Stay responsive to shutdown
+            std::this_thread::sleep_for(std::chrono::nanoseconds(waitNs));
+            clientConn->throttle.recordDelay(waitNs);
+            continue;
+        }
+        
+        if (clientConn->shmAttached) {
+            // Data flows over shared memory; the socket only signals liveness
+            if (receiveFramedMessage(*clientConn->shm, message)) {
+                dispatchShmFrame(clientConn, message, replies);
+                sendReplies(clientConn, replies);
+            } else if (clientConn->shm->peerClosed() || socketPeerClosed(*clientConn->socket)) {
+                sessionDisconnected(clientConn);
+                break;
+            }
+            continue;
+        }
+        
+        if (receiveFramedMessage(*clientConn->socket, clientConn->buffer, message, rxTimestampOut)) {
+            dispatchSocketFrame(clientConn, message, rxTimestampOut, replies);
+            sendReplies(clientConn, replies);
         } else {
-            // Check if connection was closed
-            struct pollfd pfd;
-            pfd.fd = *clientConn->socket;
-            pfd.events = POLLIN;
-            pfd.revents = 0;
-            
-            if (poll(&pfd, 1, 0) < 0 || (pfd.revents & (POLLERR | POLLHUP))) {
-                clientConn->connected = false;
-                receivedMessages.push("System", "Client disconnected");
+            // Check if connection was closed (EOF, reset, or socket error)
+            if (socketPeerClosed(*clientConn->socket)) {
+                sessionDisconnected(clientConn);
+                break;
+            }
+        }
+    }
+    
+    clientConn->connected = false;
+    subscriptions.unsubscribeAll(clientConn.get());
+}
+
+Task<void> serverSessionTask(EventLoop& loop, ClientConnectionPtr clientConn) {
+    if (!clientConn || !clientConn->socket || *clientConn->socket < 0) {
+        co_return;
+    }
+    
+    clientConn->connected = true;
+    const int fd = *clientConn->socket;
+    std::string message;
+    SessionReplies replies;
+    RxTimestamp rxTimestamp;
+    RxTimestamp* rxTimestampOut = gatewayConfig().rxTimestamps ? &rxTimestamp : nullptr;
+    bool woken = false;  // Last wait reported the socket readable
+    
+    // Reaping shuts the socket down, which ends the wait below with EOF
+    SessionIdleTimer idleTimer{loop, *clientConn, gatewayConfig().idleTimeoutMs * 1000000};
+    if (idleTimer.timeoutNs > 0) {
+        loop.timers().schedule(idleTimer.timer,
+                               clientConn->lastActivityNs.load(std::memory_order_relaxed) + idleTimer.timeoutNs);
+    }
+    
+    while (clientConn->running && clientConn->connected) {
+        // Conflated leftovers are retried on the next 1ms wakeup
+        co_await asyncFlushConflated(loop, clientConn);
+        const bool flushPending = clientConn->conflation && clientConn->conflation->pending();
+        
+        // Delay policy: stop reading while over rate so TCP pushes back on the sender
+        if (const int64_t delayNs = clientConn->throttle.readDelayNs()) {
+            const int64_t waitNs = std::min<int64_t>(delayNs, SHUTDOWN_CHECK_NS);
+            co_await loop.sleepFor(waitNs);
+            clientConn->throttle.recordDelay(waitNs);
+            continue;
+        }
+        
+        if (clientConn->shmAttached) {
+            // Ring has no descriptor to wait on: drain it, then check back in 1ms
+            bool received = false;
+            while (receiveFramedMessage(*clientConn->shm, message, 0)) {
+                dispatchShmFrame(clientConn, message, replies);
+                if (!replies.empty()) {
+                    co_await asyncSendReplies(loop, clientConn, replies);
+                }
+                received = true;
+            }
+            if (!received && (clientConn->shm->peerClosed() || socketPeerClosed(fd))) {
+                sessionDisconnected(clientConn);
                 break;
             }
+            co_await loop.sleepFor(SHM_POLL_NS);
+            continue;
+        }
+        
+        // Drain everything the socket holds without waiting
+        bool received = false;
+        while (clientConn->running && clientConn->connected &&
+               receiveFramedMessage(fd, clientConn->buffer, message, rxTimestampOut, 0)) {
+            dispatchSocketFrame(clientConn, message, rxTimestampOut, replies);
+            if (!replies.empty()) {
+                co_await asyncSendReplies(loop, clientConn, replies);
+            }
+            received = true;
+            if (clientConn->shmAttached || clientConn->throttle.readDelayNs()) {
+                break;  // Re-check throttle and transport before reading on
+            }
+        }
+        if (received) {
+            woken = false;
+            continue;
+        }
+        
+        // Woken but nothing to read: EOF, reset, or only part of a frame
+        if (woken && socketPeerClosed(fd)) {
+            sessionDisconnected(clientConn);
+            break;
         }
+        
+        const IoStatus status = co_await loop.readable(fd, flushPending ? SHM_POLL_NS : SHUTDOWN_CHECK_NS);
+        if (status == IoStatus::Error) {
+            sessionDisconnected(clientConn);
+            break;
+        }
+        woken = status == IoStatus::Ready;
     }
     
     clientConn->connected = false;
+    subscriptions.unsubscribeAll(clientConn.get());
+}
+
+ClientConnectionPtr createServerSession(SocketPtr socket, int clientId, const ConnectionSlabPtr& slab) {
+    const GatewayConfig& config = gatewayConfig();
+    auto clientConn = makeClientConnection(clientId, slab);
+    clientConn->socket = std::move(socket);
+    enableTxTracking(clientConn);
+    clientConn->lastActivityNs = static_cast<int64_t>(steadyClockNs());
+    clientConn->throttle.configure(config.throttleMessagesPerSec, config.throttleBytesPerSec,
+                                   throttlePolicyFromString(config.throttlePolicy));
+    if (config.conflate) {
+        clientConn->conflation = std::make_unique<ConflationQueue>();
+    }
+    return clientConn;
+}
+
+void startServerSession(const ClientConnectionPtr& clientConn, EventLoopPool* loops) {
+    clientConn->running = true;
+    EventLoopPool& pool = (loops && loops->running()) ? *loops : eventLoops;
+    if (gatewayConfig().coroutines && pool.running()) {
+        EventLoop& loop = pool.next();
+        loop.spawn(serverSessionTask(loop, clientConn));
+    } else {
+        idleReaper.watch(clientConn);  // No-op unless HFT_IDLE_TIMEOUT_MS is set
+        clientConn->receiveThread = std::thread(serverReceiveThread, clientConn);
+    }
+}
+
+namespace {
+
+/**
+ * @brief True if fd's local address is the one config describes
+ * 
+ * Listening sockets must match exactly; a session accepted on a wildcard
+ * listener has a concrete local address, so only its port is compared.
+ */
+bool boundTo(int fd, const ListenerConfig& config, bool listening) {
+    sockaddr_storage address{};
+    socklen_t length = sizeof(address);
+    if (getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+        return false;
+    }
+    if (address.ss_family == AF_UNIX) {
+        return !config.unixPath.empty() &&
+               config.unixPath == reinterpret_cast<const sockaddr_un*>(&address)->sun_path;
+    }
+    if (address.ss_family != AF_INET || config.port == 0) {
+        return false;
+    }
+    const auto* inet = reinterpret_cast<const sockaddr_in*>(&address);
+    if (ntohs(inet->sin_port) != config.port) {
+        return false;
+    }
+    in_addr wanted{};
+    wanted.s_addr = INADDR_ANY;
+    if (!config.bindAddress.empty() && inet_pton(AF_INET, config.bindAddress.c_str(), &wanted) != 1) {
+        return false;
+    }
+    return (!listening && config.bindAddress.empty()) || inet->sin_addr.s_addr == wanted.s_addr;
+}
+
+} // namespace
+
+std::string listenerAddress(const ListenerConfig& config) {
+    if (!config.unixPath.empty()) {
+        return config.unixPath;
+    }
+    return (config.bindAddress.empty() ? "*" : config.bindAddress) + ":" + std::to_string(config.port);
+}
+
+ListenerSet::~ListenerSet() {
+    close();
+    stopLoops();
+}
+
+size_t ListenerSet::open(const std::vector<ListenerConfig>& table, std::vector<SocketPtr> inherited) {
+    close();
+    for (size_t i = 0; i < table.size(); ++i) {
+        ServerListener listener;
+        listener.index = i;
+        listener.config = table[i];
+        listener.slab = std::make_shared<ConnectionSlab>();
+        auto match = std::find_if(inherited.begin(), inherited.end(), [&](const SocketPtr& socket) {
+            return socket && *socket >= 0 && boundTo(*socket, table[i], true);
+        });
+        if (match != inherited.end()) {
+            listener.socket = *match;
+            inherited.erase(match);
+            LOG_INFO("Listener {} inherited on {}", table[i].name, listenerAddress(table[i]));
+        } else if (table[i].unixPath.empty()) {
+            listener.socket = startServer(table[i].port, table[i].bindAddress, table[i].bufferBytes);
+        } else {
+            listener.socket = startUnixServer(table[i].unixPath, table[i].bufferBytes);
+        }
+        if (!listener.socket) {
+            LOG_ERROR("Listener {} on {} could not be opened", table[i].name, listenerAddress(table[i]));
+            continue;
+        }
+        listeners_.push_back(std::move(listener));
+    }
+    for (const auto& socket : inherited) {
+        if (socket && *socket >= 0) {
+            LOG_WARN("Closing inherited listener fd {}: not in the listener table", *socket);
+        }
+    }
+    return listeners_.size();
+}
+
+void ListenerSet::startAccepting(std::vector<ClientConnectionPtr>& clients, std::mutex& clientsMutex,
+                                 std::atomic<int>& nextClientId) {
+    stopAccepting();
+    accepting_ = true;
+    for (auto& listener : listeners_) {
+        // Own reactor threads, so a burst on this listener cannot delay the others' sessions
+        if (gatewayConfig().coroutines && listener.config.loopThreads > 0) {
+            if (loops_.size() <= listener.index) {
+                loops_.resize(listener.index + 1);
+            }
+            auto& pool = loops_[listener.index];
+            if (!pool) {
+                pool = std::make_unique<EventLoopPool>();
+                if (!pool->start(listener.config.loopThreads)) {
+                    LOG_ERROR("Listener {}: event loops failed to start; using the shared pool",
+                              listener.config.name);
+                    pool.reset();
+                }
+            }
+            listener.loops = pool.get();
+        }
+        acceptThreads_.emplace_back(serverAcceptThread, std::cref(listener), std::ref(accepting_),
+                                    std::ref(clients), std::ref(clientsMutex), std::ref(nextClientId));
+    }
+}
+
+void ListenerSet::stopAccepting() {
+    accepting_ = false;
+    for (auto& thread : acceptThreads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    acceptThreads_.clear();
+}
+
+void ListenerSet::close() {
+    stopAccepting();
+    listeners_.clear();
+}
+
+void ListenerSet::stopLoops() {
+    for (auto& pool : loops_) {
+        if (pool) {
+            pool->stop();
+        }
+    }
+    loops_.clear();
+}
+
+std::vector<SocketPtr> ListenerSet::sockets() const {
+    std::vector<SocketPtr> sockets;
+    for (const auto& listener : listeners_) {
+        sockets.push_back(listener.socket);
+    }
+    return sockets;
 }
 
-void serverAcceptThread(SocketPtr serverSocket, 
+const ServerListener* ListenerSet::find(int sessionFd) const {
+    for (const auto& listener : listeners_) {
+        if (boundTo(sessionFd, listener.config, false)) {
+            return &listener;
+        }
+    }
+    return nullptr;
+}
+
+void serverAcceptThread(const ServerListener& listener,
                         std::atomic<bool>& running, 
                         std::vector<ClientConnectionPtr>& clients,
                         std::mutex& clientsMutex, 
-                        std::atomic<int>& nextClientId,
-                        size_t maxConnections) {
+                        std::atomic<int>& nextClientId) {
+    const SocketPtr serverSocket = listener.socket;
     if (!serverSocket || *serverSocket < 0) {
         return;
     }
     
+    // Unix domain listeners feed the same sessions; only TCP options differ
+    const bool unixListener = isUnixSocket(*serverSocket);
+    
     while (running && serverSocket && *serverSocket >= 0) {
         struct pollfd pfd;
         pfd.fd = *serverSocket;
@@ -76,11 +579,17 @@ void serverAcceptThread(SocketPtr serverSocket,
                     }),
                 clients.end());
             
-            if (clients.size() >= maxConnections) {
+            // Each listener has its own limit, so one class of traffic cannot crowd out the others
+            const size_t listenerSessions = static_cast<size_t>(std::count_if(clients.begin(), clients.end(),
+                [&](const ClientConnectionPtr& conn) { return conn->listener == listener.index; }));
+            if (listenerSessions >= listener.config.maxConnections) {
                 // Accept and immediately close to prevent queue buildup
                 int tempFd = accept(*serverSocket, nullptr, nullptr);
                 if (tempFd >= 0) {
                     close(tempFd);
+                    metrics.add(Counter::SessionsRejected);
+                    LOG_WARN("Connection rejected: {} sessions open on listener {}",
+                             listenerSessions, listener.config.name);
                     receivedMessages.push("System", "Connection rejected: maximum connections reached");
                 }
                 continue;
@@ -96,32 +605,200 @@ void serverAcceptThread(SocketPtr serverSocket,
             setsockopt(clientSocketFd, SOL_SOCKET, SO_NOSIGPIPE, &opt, sizeof(opt));
             #endif
             
-            // TCP_NODELAY for low latency, 64KB buffers for throughput
-            opt = 1;
-            setsockopt(clientSocketFd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
-            int bufferSize = 64 * 1024;
+            // TCP_NODELAY for low latency, the listener's buffer size for throughput
+            if (!unixListener) {
+                opt = 1;
+                setsockopt(clientSocketFd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+            }
+            const int bufferSize = listener.config.bufferBytes;
             setsockopt(clientSocketFd, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
             setsockopt(clientSocketFd, SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize));
+            if (gatewayConfig().rxTimestamps) {
+                enableRxTimestamps(clientSocketFd);
+            }
+            const GatewayConfig& config = gatewayConfig();
+            if (!unixListener) {
+                configureKeepalive(clientSocketFd, config.tcpKeepaliveIdle, config.tcpKeepaliveInterval,
+                                   config.tcpKeepaliveCount, config.tcpUserTimeoutMs);
+            }
             
             int clientId = nextClientId++;
-            auto clientConn = std::make_shared<ClientConnection>(clientId);
-            clientConn->socket = SocketPtr(new int(clientSocketFd), [](int* s){
+            auto clientConn = createServerSession(SocketPtr(new int(clientSocketFd), [](int* s){
                 if (s && *s >= 0) {
                     close(*s);
                 }
                 delete s;
-            });
-            clientConn->running = true;
-            clientConn->receiveThread = std::thread(serverReceiveThread, clientConn);
+            }), clientId, listener.slab);
+            clientConn->listener = listener.index;
+            startServerSession(clientConn, listener.loops);
             
             {
                 std::lock_guard<std::mutex> lock(clientsMutex);
                 clients.push_back(clientConn);
             }
             
-            receivedMessages.push("System", "Client " + std::to_string(clientId) + " connected");
+            metrics.add(Counter::SessionsAccepted);
+            LOG_INFO("Session {} connected (fd {}, listener {})", clientId, clientSocketFd, listener.config.name);
+            receivedMessages.push("System", "Client " + std::to_string(clientId) + " connected" +
+                                  (unixListener ? " (unix socket)" : ""), clientId);
         } else if (clientSocketFd < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            LOG_ERROR("Accept failed: {}", strerror(errno));
             break;
         }
     }
 }
+
+namespace {
+
+constexpr size_t SESSIONS_PER_DRAIN_WORKER = 64;
+constexpr int64_t DRAIN_POLL_NS = 10000000;  ///< Longest single wait for a full socket while draining
+constexpr int64_t SHM_RETRY_NS = 100000;     ///< Pause between attempts on a full shared-memory ring
+
+/**
+ * @brief Waits until fd accepts data, for at most min(deadline, DRAIN_POLL_NS)
+ */
+bool writableBefore(int fd, int64_t deadlineNs) {
+    const int64_t remainingNs = std::min(deadlineNs - static_cast<int64_t>(steadyClockNs()), DRAIN_POLL_NS);
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLOUT;
+    pfd.revents = 0;
+    const int timeoutMs = remainingNs > 0 ? static_cast<int>((remainingNs + 999999) / 1000000) : 0;
+    return poll(&pfd, 1, timeoutMs) > 0 && (pfd.revents & POLLOUT);
+}
+
+/**
+ * @brief Writes message to a shared-memory session, retrying a full ring until deadlineNs
+ *
+ * sendFramedMessage(ShmChannel&) waits for as long as the consumer takes;
+ * a client that stopped reading would hold the drain worker forever.
+ */
+bool sendShmBefore(const ClientConnectionPtr& conn, const std::string& message, int64_t deadlineNs) {
+    const ShmChannel& channel = *conn->shm;
+    if (4 + message.size() > channel.capacity()) {
+        return false;
+    }
+    // A writer stuck on the full ring holds sendMutex too, so the lock is only tried
+    while (!trySendShm(conn, message)) {
+        if (channel.broken() || channel.peerClosed() ||
+            static_cast<int64_t>(steadyClockNs()) >= deadlineNs) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::nanoseconds(SHM_RETRY_NS));
+    }
+    return true;
+}
+
+/**
+ * @brief Flushes a shared-memory session's dirty symbols, each send bounded by deadlineNs
+ */
+void flushShmBefore(const ClientConnectionPtr& conn, int64_t deadlineNs, DrainReport& tally) {
+    ConflationQueue& queue = *conn->conflation;
+    std::lock_guard<std::mutex> flushing(queue.flushMutex);  // Other flushers never wait on a shm ring
+    uint32_t symbolId;
+    ConflationQueue::Frame frame;
+    while (queue.pop(symbolId, frame)) {
+        if (!sendShmBefore(conn, *frame, deadlineNs)) {
+            queue.restore(symbolId, std::move(frame));
+            break;
+        }
+        ++tally.framesFlushed;
+    }
+}
+
+/**
+ * @brief Flushes, logs out and shuts down one session (see drainSessions)
+ */
+void drainSession(const ClientConnectionPtr& conn, int64_t deadlineNs, DrainReport& tally) {
+    const bool wasConnected = conn->connected;
+    conn->running = false;  // Receive loop exits; the drain owns the socket from here
+    const int fd = conn->socket ? *conn->socket : -1;
+    
+    if (wasConnected && fd >= 0) {
+        if (conn->conflation && conn->shmAttached) {
+            flushShmBefore(conn, deadlineNs, tally);
+        } else if (conn->conflation) {
+            while (conn->conflation->pending() > 0) {
+                tally.framesFlushed += flushConflated(conn);
+                if (conn->conflation->pending() == 0 ||
+                    static_cast<int64_t>(steadyClockNs()) >= deadlineNs) {
+                    break;
+                }
+                writableBefore(fd, deadlineNs);
+            }
+        }
+        if (conn->conflation && conn->conflation->pending() > 0) {
+            ++tally.unflushed;
+        }
+        
+        // Only when it cannot block: a peer that stopped reading gets no logout
+        static const auto logout = std::make_shared<const std::string>(LOGOUT_NOTICE);
+        const bool loggedOut = conn->shmAttached ? sendShmBefore(conn, *logout, deadlineNs)
+                                                 : writableBefore(fd, deadlineNs) && sendToConnection(conn, logout);
+        if (loggedOut) {
+            ++tally.loggedOut;
+        }
+        
+        // FIN follows the queued data; the fd itself closes with the last reference
+        shutdown(fd, SHUT_WR);
+    }
+    conn->connected = false;
+    if (conn->receiveThread.joinable()) {
+        conn->receiveThread.join();
+    }
+}
+
+} // namespace
+
+DrainReport drainSessions(std::vector<ClientConnectionPtr> sessions, int64_t timeoutNs) {
+    const int64_t startNs = static_cast<int64_t>(steadyClockNs());
+    const int64_t deadlineNs = startNs + timeoutNs;
+    
+    // A few workers so one slow peer does not hold up the rest
+    const size_t hardwareThreads = std::max<unsigned>(std::thread::hardware_concurrency(), 1);
+    const size_t workerCount = std::min(hardwareThreads,
+        (sessions.size() + SESSIONS_PER_DRAIN_WORKER - 1) / SESSIONS_PER_DRAIN_WORKER);
+    std::vector<DrainReport> tallies(std::max<size_t>(workerCount, 1));
+    auto drainSlice = [&](size_t worker) {
+        for (size_t i = worker; i < sessions.size(); i += tallies.size()) {
+            drainSession(sessions[i], deadlineNs, tallies[worker]);
+        }
+    };
+    
+    if (tallies.size() == 1) {
+        drainSlice(0);
+    } else {
+        std::vector<std::thread> workers;
+        for (size_t w = 0; w < tallies.size(); ++w) {
+            workers.emplace_back(drainSlice, w);
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+    
+    DrainReport report;
+    report.sessions = sessions.size();
+    for (const auto& tally : tallies) {
+        report.loggedOut += tally.loggedOut;
+        report.framesFlushed += tally.framesFlushed;
+        report.unflushed += tally.unflushed;
+    }
+    sessions.clear();
+    report.elapsedNs = static_cast<int64_t>(steadyClockNs()) - startNs;
+    LOG_INFO("Drained {} sessions in {}us: {} logged out, {} updates flushed, {} unflushed",
+             report.sessions, report.elapsedNs / 1000, report.loggedOut, report.framesFlushed, report.unflushed);
+    return report;
+}
+
+std::string formatDrainReport(const DrainReport& report) {
+    char elapsed[32];
+    std::snprintf(elapsed, sizeof(elapsed), "%.1f", static_cast<double>(report.elapsedNs) / 1e6);
+    std::string text = "Server drained " + std::to_string(report.sessions) + " session(s) in " + elapsed +
+                       " ms: " + std::to_string(report.loggedOut) + " logged out, " +
+                       std::to_string(report.framesFlushed) + " queued updates flushed";
+    if (report.unflushed) {
+        text += ", " + std::to_string(report.unflushed) + " left unflushed at the deadline";
+    }
+    return text;
+}
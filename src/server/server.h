@@ -8,26 +8,178 @@
 #include "../network/socket_utils.h"
 #include "../network/connection.h"
 #include "../network/message.h"
+#include "../async/event_loop.h"
+#include "../config/config.h"
 #include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
 #include <vector>
 #include <mutex>
 
+/**
+ * @brief Frame sent to each session when the server drains: "LOGOUT"
+ */
+extern const char* const LOGOUT_NOTICE;
+
+/**
+ * @brief Response to a correlated message, echoing its type and id: "ACK"
+ */
+extern const char* const ACK_RESPONSE;
+
+/**
+ * @struct DrainReport
+ * @brief Outcome of drainSessions()
+ */
+struct DrainReport {
+    size_t sessions = 0;        ///< Sessions drained
+    size_t loggedOut = 0;       ///< Sessions that were sent LOGOUT
+    size_t framesFlushed = 0;   ///< Queued (conflated) updates sent during the drain
+    size_t unflushed = 0;       ///< Sessions whose queue was still not empty at the deadline
+    int64_t elapsedNs = 0;      ///< Wall time from start to the last socket closed
+};
+
+/**
+ * @brief Gracefully ends sessions that no longer receive new connections
+ * 
+ * For each session, in parallel across a few worker threads: stop its
+ * receive loop, flush its outbound queue while the socket stays writable
+ * (until the deadline), send LOGOUT, and shut the socket down for writing so
+ * the peer sees EOF after the last frame. Receive threads are joined by the
+ * workers; no lock is held. Sessions must already be removed from the
+ * shared clients vector. The fds close when the last reference is dropped.
+ * 
+ * @param timeoutNs Deadline for flushing and logout, from the start of the drain
+ */
+DrainReport drainSessions(std::vector<ClientConnectionPtr> sessions, int64_t timeoutNs);
+
+/**
+ * @brief One-line summary of a drain for the console and log
+ */
+std::string formatDrainReport(const DrainReport& report);
+
 /**
  * @brief Receives messages from client connection (runs in dedicated thread)
  * 
  * Pushes messages to receivedMessages queue. Detects disconnections via poll().
+ * Answers multicast retransmit, symbol subscription and shared-memory attach
+ * requests inline and acknowledges correlated messages; after an attach,
+ * receives from the session's ShmChannel instead of the socket. Flushes conflated updates once the socket drains.
+ * Drops the session's subscriptions on exit.
  */
 void serverReceiveThread(ClientConnectionPtr clientConn);
 
 /**
- * @brief Accepts new client connections (runs in dedicated thread)
+ * @brief Coroutine version of serverReceiveThread (runs on an event loop)
+ * 
+ * Same protocol handling, but suspends on socket readiness instead of
+ * polling, so one loop thread serves many sessions. Used by the accept
+ * thread when HFT_COROUTINES is set.
+ */
+Task<void> serverSessionTask(EventLoop& loop, ClientConnectionPtr clientConn);
+
+/**
+ * @brief Creates a session for an accepted (or inherited) socket
+ * 
+ * Applies per-session settings (TX tracking, throttle, conflation) but does
+ * not start receiving, so the caller can seed the buffer or subscriptions.
+ * The connection object comes from slab (the accepting listener's) if given.
+ */
+ClientConnectionPtr createServerSession(SocketPtr socket, int clientId, const ConnectionSlabPtr& slab = nullptr);
+
+/**
+ * @brief Starts the session's receive thread, or its coroutine when HFT_COROUTINES is set
+ * 
+ * @param loops The accepting listener's dedicated loops (null for the shared eventLoops)
+ */
+void startServerSession(const ClientConnectionPtr& clientConn, EventLoopPool* loops = nullptr);
+
+/**
+ * @struct ServerListener
+ * @brief One open entry of the listener table
+ */
+struct ServerListener {
+    size_t index = 0;                 ///< Position in the table (ClientConnection::listener)
+    ListenerConfig config;
+    SocketPtr socket;
+    EventLoopPool* loops = nullptr;   ///< Dedicated event loops, or null for the shared eventLoops
+    ConnectionSlabPtr slab;           ///< Storage for the sessions this listener accepts
+};
+
+/**
+ * @brief "10.0.0.5:8080", "*:8080" or the Unix socket path, for logs and the console
+ */
+std::string listenerAddress(const ListenerConfig& config);
+
+/**
+ * @class ListenerSet
+ * @brief The server's listeners, each with its own accept thread and limits
+ * 
+ * Dedicated event loops are created on first use and kept until stopLoops(),
+ * so sessions still draining after close() keep their loop.
+ */
+class ListenerSet {
+public:
+    ~ListenerSet();
+
+    /**
+     * @brief Opens every listener in table
+     * 
+     * A socket in inherited (hot restart) bound to an entry's address is used
+     * instead of binding; inherited sockets matching no entry are closed.
+     * 
+     * @return Number of listeners open (entries that fail to bind are skipped)
+     */
+    size_t open(const std::vector<ListenerConfig>& table, std::vector<SocketPtr> inherited = {});
+
+    /**
+     * @brief Starts one accept thread per listener; all feed the same clients vector and ID counter
+     */
+    void startAccepting(std::vector<ClientConnectionPtr>& clients, std::mutex& clientsMutex,
+                        std::atomic<int>& nextClientId);
+
+    /**
+     * @brief Stops and joins the accept threads; listeners stay open (connects queue in the backlog)
+     */
+    void stopAccepting();
+
+    /**
+     * @brief Stops accepting and closes every listener
+     */
+    void close();
+
+    /**
+     * @brief Stops the dedicated event loops (after the sessions on them ended)
+     */
+    void stopLoops();
+
+    bool empty() const { return listeners_.empty(); }
+    const std::vector<ServerListener>& listeners() const { return listeners_; }
+    std::vector<SocketPtr> sockets() const;
+
+    /**
+     * @brief Listener a session socket was accepted on (by its local address), or null
+     */
+    const ServerListener* find(int sessionFd) const;
+
+private:
+    std::vector<ServerListener> listeners_;
+    std::vector<std::thread> acceptThreads_;
+    std::atomic<bool> accepting_{false};
+    std::vector<std::unique_ptr<EventLoopPool>> loops_;   ///< Indexed like the table
+};
+
+/**
+ * @brief Accepts new client connections on one listener (runs in dedicated thread)
  * 
  * Non-blocking accept loop with 1ms poll timeout. Configures sockets for low latency.
- * Cleans up disconnected clients and enforces connection limits.
+ * Cleans up disconnected clients and enforces the listener's connection limit.
+ * Works for TCP and Unix domain listeners; several accept threads may share
+ * one clients vector and ID counter. Sessions get their own receive thread,
+ * or a coroutine on the listener's loops (or eventLoops) when HFT_COROUTINES is set.
  */
-void serverAcceptThread(SocketPtr serverSocket, 
+void serverAcceptThread(const ServerListener& listener,
                         std::atomic<bool>& running, 
                         std::vector<ClientConnectionPtr>& clients,
                         std::mutex& clientsMutex, 
-                        std::atomic<int>& nextClientId,
-                        size_t maxConnections = 1000);
+                        std::atomic<int>& nextClientId);
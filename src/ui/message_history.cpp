@@ -0,0 +1,234 @@
+#include "message_history.h"
+#include "../logging/logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+constexpr uint64_t HISTORY_MAGIC = 0x48465448495354ULL;  // "HFTHIST"
+constexpr uint32_t HISTORY_VERSION = 2;
+constexpr size_t HEADER_SIZE = 256;
+}
+
+struct MessageHistory::Header {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t slotSize;
+    uint64_t capacity;
+    uint64_t appended;      ///< Entries ever appended; newest is appended - 1
+    int64_t newestNs;       ///< Timestamp of the newest entry
+    uint64_t arenaSize;
+    uint64_t arenaWritten;  ///< Text bytes ever written; the next text starts here
+    uint64_t oldest;        ///< Sequence of the oldest entry whose text is still in the arena
+};
+
+struct MessageHistory::Slot {
+    int64_t timestampNs;
+    int32_t session;
+    uint32_t length;        ///< Original text length (may exceed stored)
+    char source[16];        ///< NUL-padded
+    uint64_t textPosition;  ///< Arena position (arenaWritten when stored) of the text
+    uint32_t stored;        ///< Text bytes in the arena
+    uint32_t reserved;
+};
+
+MessageHistory::MessageHistory(size_t capacity, const std::string& filePath)
+    : capacity_(std::max<size_t>(capacity, 1)),
+      arenaSize_(std::max(capacity_ * TEXT_BYTES_PER_ENTRY, MIN_ARENA_BYTES)) {
+    static_assert(HEADER_SIZE >= sizeof(Header), "header does not fit");
+    static_assert(sizeof(Slot) == SLOT_SIZE, "slot layout must match SLOT_SIZE");
+    if (!filePath.empty() && mapFile(filePath)) {
+        persistent_ = true;
+    } else if (!mapAnonymous()) {
+        capacity_ = 0;
+    }
+}
+
+MessageHistory::~MessageHistory() {
+    if (mapping_) {
+        munmap(mapping_, mappedSize_);
+    }
+}
+
+void MessageHistory::initHeader() {
+    std::memset(header_, 0, HEADER_SIZE);
+    header_->magic = HISTORY_MAGIC;
+    header_->version = HISTORY_VERSION;
+    header_->slotSize = sizeof(Slot);
+    header_->capacity = capacity_;
+    header_->arenaSize = arenaSize_;
+}
+
+void MessageHistory::setPointers() {
+    header_ = static_cast<Header*>(mapping_);
+    slots_ = reinterpret_cast<Slot*>(static_cast<char*>(mapping_) + HEADER_SIZE);
+    arena_ = reinterpret_cast<char*>(slots_ + capacity_);
+}
+
+bool MessageHistory::mapAnonymous() {
+    mappedSize_ = HEADER_SIZE + capacity_ * sizeof(Slot) + arenaSize_;
+    // Untouched pages cost nothing, so large capacities only pay for what fills
+    void* mapping = mmap(nullptr, mappedSize_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        LOG_ERROR("History mmap failed: {}", strerror(errno));
+        return false;
+    }
+    mapping_ = mapping;
+    setPointers();
+    initHeader();
+    return true;
+}
+
+bool MessageHistory::mapFile(const std::string& filePath) {
+    int fd = open(filePath.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        LOG_ERROR("History file open failed: {}: {}", filePath, strerror(errno));
+        return false;
+    }
+
+    const size_t size = HEADER_SIZE + capacity_ * sizeof(Slot) + arenaSize_;
+    struct stat st;
+    const bool reuse = fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) == size;
+    if (!reuse && (ftruncate(fd, 0) != 0 || ftruncate(fd, static_cast<off_t>(size)) != 0)) {
+        LOG_ERROR("History file ftruncate failed: {}", strerror(errno));
+        close(fd);
+        return false;
+    }
+
+    void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);  // Mapping keeps the file referenced
+    if (mapping == MAP_FAILED) {
+        LOG_ERROR("History file mmap failed: {}", strerror(errno));
+        return false;
+    }
+
+    mapping_ = mapping;
+    mappedSize_ = size;
+    setPointers();
+
+    if (!reuse || header_->magic != HISTORY_MAGIC || header_->version != HISTORY_VERSION ||
+        header_->slotSize != sizeof(Slot) || header_->capacity != capacity_ ||
+        header_->arenaSize != arenaSize_ || header_->oldest > header_->appended) {
+        initHeader();
+    } else {
+        LOG_INFO("History reopened {} with {} entries", filePath, header_->appended);
+    }
+    return true;
+}
+
+void MessageHistory::append(int64_t timestampNs, const std::string& source, int session, const std::string& text) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!header_) {
+        return;
+    }
+
+    const uint64_t sequence = header_->appended;
+    if (sequence > 0 && timestampNs < header_->newestNs) {
+        timestampNs = header_->newestNs;  // Clock stepped back; keep the ring sorted
+    }
+
+    // Retire entries whose slot or text this one overwrites (oldest first)
+    const size_t stored = std::min(text.size(), arenaSize_);
+    const uint64_t position = header_->arenaWritten;
+    const uint64_t textEnd = position + stored;
+    uint64_t oldest = header_->oldest;
+    while (oldest < sequence &&
+           (sequence - oldest >= capacity_ || slotAt(oldest).textPosition + arenaSize_ < textEnd)) {
+        ++oldest;
+    }
+
+    Slot& slot = slots_[sequence % capacity_];
+    slot.timestampNs = timestampNs;
+    slot.session = session;
+    slot.length = static_cast<uint32_t>(std::min<size_t>(text.size(), UINT32_MAX));
+    std::memset(slot.source, 0, sizeof(slot.source));
+    std::memcpy(slot.source, source.data(), std::min(source.size(), sizeof(slot.source)));
+    slot.textPosition = position;
+    slot.stored = static_cast<uint32_t>(stored);
+    copyText(position, text.data(), stored);
+
+    header_->oldest = oldest;
+    header_->arenaWritten = textEnd;
+    header_->newestNs = timestampNs;
+    header_->appended = sequence + 1;
+}
+
+void MessageHistory::copyText(uint64_t position, const char* text, size_t length) {
+    const size_t offset = static_cast<size_t>(position % arenaSize_);
+    const size_t first = std::min(length, arenaSize_ - offset);
+    std::memcpy(arena_ + offset, text, first);
+    std::memcpy(arena_, text + first, length - first);  // Wrapped tail
+}
+
+std::string MessageHistory::readText(uint64_t position, size_t length) const {
+    const size_t offset = static_cast<size_t>(position % arenaSize_);
+    const size_t first = std::min(length, arenaSize_ - offset);
+    std::string text(arena_ + offset, first);
+    text.append(arena_, length - first);
+    return text;
+}
+
+size_t MessageHistory::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return header_ ? static_cast<size_t>(header_->appended - header_->oldest) : 0;
+}
+
+const MessageHistory::Slot& MessageHistory::slotAt(uint64_t sequence) const {
+    return slots_[sequence % capacity_];
+}
+
+uint64_t MessageHistory::lowerBound(uint64_t first, uint64_t last, int64_t timestampNs) const {
+    while (first < last) {
+        const uint64_t mid = first + (last - first) / 2;
+        if (slotAt(mid).timestampNs < timestampNs) {
+            first = mid + 1;
+        } else {
+            last = mid;
+        }
+    }
+    return first;
+}
+
+std::vector<HistoryEntry> MessageHistory::query(const HistoryQuery& query, size_t* matched) const {
+    std::vector<HistoryEntry> entries;
+    size_t matches = 0;
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (header_ && header_->appended > 0 && query.fromNs <= query.toNs) {
+        const uint64_t newest = header_->appended;
+        const uint64_t oldest = header_->oldest;
+
+        // Sequences [begin, end) fall inside the time range
+        const uint64_t begin = lowerBound(oldest, newest, query.fromNs);
+        const uint64_t end = query.toNs == std::numeric_limits<int64_t>::max()
+                                 ? newest : lowerBound(begin, newest, query.toNs + 1);
+
+        // Walk back from the newest so the limit keeps the most recent matches
+        for (uint64_t sequence = end; sequence > begin; --sequence) {
+            const Slot& slot = slotAt(sequence - 1);
+            if (query.session >= 0 && slot.session != query.session) {
+                continue;
+            }
+            ++matches;
+            if (entries.size() < query.limit) {
+                HistoryEntry entry;
+                entry.timestampNs = slot.timestampNs;
+                entry.session = slot.session;
+                entry.source.assign(slot.source, strnlen(slot.source, sizeof(slot.source)));
+                entry.text = readText(slot.textPosition, slot.stored);
+                entry.truncated = slot.length > slot.stored;
+                entries.push_back(std::move(entry));
+            }
+        }
+        std::reverse(entries.begin(), entries.end());
+    }
+
+    if (matched) {
+        *matched = matches;
+    }
+    return entries;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+/**
+ * @file message_history.h
+ * @brief Bounded store of received messages for the history viewer
+ *
+ * A circular buffer of fixed-size slots plus a circular byte arena for the
+ * message text, both in one mapping: appending overwrites the oldest slot
+ * and the oldest text in O(1) with no allocation or shifting. Slots hold
+ * only metadata and the text's arena position, so entries keep their full
+ * text whatever its length. The arena is sized for TEXT_BYTES_PER_ENTRY on
+ * average; a run of long messages retires the oldest entries before the
+ * slot ring is full. Capacity can run to millions of entries; the mapping is
+ * anonymous (pages are only touched as slots fill) or, when a file is given,
+ * a shared file mapping that survives restarts.
+ *
+ * Entries are kept in timestamp order, so time ranges are found by binary
+ * search; session filters scan only the selected range.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @struct HistoryEntry
+ * @brief Copy of one stored message returned by queries
+ */
+struct HistoryEntry {
+    int64_t timestampNs;    ///< CLOCK_REALTIME when the message was received
+    int session;            ///< Connection ID (0 = not tied to a session)
+    std::string source;     ///< "Server", "Client", "System", "MarketData"
+    std::string text;       ///< Message text (possibly truncated)
+    bool truncated;         ///< Original was longer than the whole arena
+};
+
+/**
+ * @struct HistoryQuery
+ * @brief Filter for MessageHistory::query()
+ */
+struct HistoryQuery {
+    int64_t fromNs = std::numeric_limits<int64_t>::min();  ///< Inclusive
+    int64_t toNs = std::numeric_limits<int64_t>::max();    ///< Inclusive
+    int session = -1;                                      ///< -1 = any session
+    size_t limit = 1000;                                   ///< Most recent matches returned
+};
+
+/**
+ * @class MessageHistory
+ * @brief Fixed-capacity ring of message slots and text arena, optionally file-backed
+ *
+ * Thread-safe (internal mutex); in practice only the main thread uses it.
+ */
+class MessageHistory {
+public:
+    static constexpr size_t SLOT_SIZE = 48;                ///< Metadata bytes per entry
+    static constexpr size_t TEXT_BYTES_PER_ENTRY = 256;    ///< Arena bytes reserved per entry of capacity
+    static constexpr size_t MIN_ARENA_BYTES = 1 << 20;     ///< Arena floor; longer messages are truncated
+
+    /**
+     * @brief Maps storage for capacity entries
+     *
+     * @param filePath Backing file; empty for anonymous memory. An existing file
+     *                 with the same capacity is reopened with its entries intact.
+     * Falls back to anonymous memory if the file cannot be mapped.
+     */
+    explicit MessageHistory(size_t capacity, const std::string& filePath = "");
+    ~MessageHistory();
+
+    MessageHistory(const MessageHistory&) = delete;
+    MessageHistory& operator=(const MessageHistory&) = delete;
+
+    /**
+     * @brief Stores a message, overwriting the oldest once full (O(1) per retired entry)
+     *
+     * Timestamps earlier than the newest entry are raised to it, keeping the
+     * ring ordered for range queries.
+     */
+    void append(int64_t timestampNs, const std::string& source, int session, const std::string& text);
+
+    /**
+     * @brief Returns matching entries, oldest first (at most query.limit, the most recent)
+     *
+     * @param matched Output (optional): total matches before the limit was applied
+     */
+    std::vector<HistoryEntry> query(const HistoryQuery& query, size_t* matched = nullptr) const;
+
+    size_t size() const;
+    size_t capacity() const { return capacity_; }
+
+    /**
+     * @brief True if backed by a file rather than anonymous memory
+     */
+    bool persistent() const { return persistent_; }
+
+private:
+    struct Header;
+    struct Slot;
+
+    size_t capacity_;
+    bool persistent_ = false;
+    size_t arenaSize_;
+    void* mapping_ = nullptr;       ///< Header, capacity_ slots, then arenaSize_ text bytes
+    size_t mappedSize_ = 0;
+    Header* header_ = nullptr;
+    Slot* slots_ = nullptr;
+    char* arena_ = nullptr;
+    mutable std::mutex mutex_;
+
+    bool mapFile(const std::string& filePath);
+    bool mapAnonymous();
+    void initHeader();
+    void setPointers();
+    const Slot& slotAt(uint64_t sequence) const;
+    void copyText(uint64_t position, const char* text, size_t length);
+    std::string readText(uint64_t position, size_t length) const;
+    uint64_t lowerBound(uint64_t first, uint64_t last, int64_t timestampNs) const;
+};
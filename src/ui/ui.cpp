@@ -1,17 +1,21 @@
 #include "ui.h"
+#include "../util/tsc_clock.h"
 #include <iostream>
+#include <string>
+#include <ctime>
 #include <sys/poll.h>
 #include <unistd.h>
 
-void displayMenu(SocketPtr serverSocket, 
+void displayMenu(bool serverRunning, 
                  const std::vector<ClientConnectionPtr>& serverClients,
-                 const std::vector<ClientConnectionPtr>& clientConnections) {
+                 const std::vector<ClientConnectionPtr>& clientConnections,
+                 const ConnectionPool& connectionPool) {
     std::cout << "\n========================================\n";
     std::cout << "     HFT Gateway Control Menu\n";
     std::cout << "========================================\n";
     
-    std::cout << "  Server: " << (serverSocket ? "Listening" : "Not running");
-    if (serverSocket && !serverClients.empty()) {
+    std::cout << "  Server: " << (serverRunning ? "Listening" : "Not running");
+    if (serverRunning && !serverClients.empty()) {
         std::cout << " (" << serverClients.size() << " client(s) connected)";
     }
     std::cout << "\n";
@@ -58,6 +62,11 @@ void displayMenu(SocketPtr serverSocket,
     }
     std::cout << "\n";
     
+    if (connectionPool.running()) {
+        std::cout << "  Pool: " << connectionPool.healthyMembers() << " of "
+                  << connectionPool.members().size() << " healthy\n";
+    }
+    
     std::cout << "========================================\n";
     std::cout << "  1. Create server socket\n";
     std::cout << "  2. Connect to server\n";
@@ -66,8 +75,148 @@ void displayMenu(SocketPtr serverSocket,
     std::cout << "  5. Stop server connection\n";
     std::cout << "  6. Stop client connection\n";
     std::cout << "  7. View received messages\n";
+    std::cout << "  8. Publish market data (multicast)\n";
+    std::cout << "  9. Join/leave market data feed\n";
+    std::cout << " 10. View connection statistics\n";
+    std::cout << " 11. Start/stop connection pool\n";
+    std::cout << " 12. Send message (connection pool)\n";
+    std::cout << "========================================\n";
+    std::cout << "Enter your choice (1-12): ";
+}
+
+void displayConnectionStats(const std::vector<ClientConnectionPtr>& serverClients,
+                            const std::vector<ClientConnectionPtr>& clientConnections,
+                            const std::vector<PoolMemberPtr>& poolMembers) {
+    std::cout << "\n[Connection Statistics]\n";
+    std::cout << "========================================\n";
+    
+    auto printConnections = [](const char* label, const std::vector<ClientConnectionPtr>& connections) {
+        std::cout << label << ":\n";
+        if (connections.empty()) {
+            std::cout << "  (none)\n";
+            return;
+        }
+        for (const auto& conn : connections) {
+            std::cout << "  Client " << conn->id << (conn->connected ? "" : " (disconnected)") << "\n";
+            if (conn->rxWakeup.count() > 0) {
+                std::cout << "    RX wakeup: " << conn->rxWakeup.summary() << "\n";
+            } else {
+                std::cout << "    RX wakeup: no samples (set HFT_RX_TIMESTAMPS=1)\n";
+            }
+            if (conn->txTracker) {
+                std::cout << "    TX send->wire: " << conn->txTracker->sendToWire().summary()
+                          << " (pending " << conn->txTracker->pendingFrames() << ")\n";
+                if (const uint64_t untracked = conn->txTracker->untrackedStamps()) {
+                    std::cout << "    TX stamps past recorded bytes: " << untracked << " (resynchronized)\n";
+                }
+            } else {
+                std::cout << "    TX send->wire: not tracked (set HFT_TX_TIMESTAMPS=1)\n";
+            }
+            if (conn->throttle.enabled()) {
+                std::cout << "    Throttle: " << conn->throttle.summary() << "\n";
+            }
+            if (conn->conflation) {
+                std::cout << "    Conflation: " << conn->conflation->conflated() << " updates conflated, "
+                          << conn->conflation->dirtySymbols() << " symbols pending\n";
+            }
+            if (conn->requests) {
+                std::cout << "    Requests: " << conn->requests->pending() << " awaiting response\n";
+            }
+            if (conn->txTracker && conn->txTracker->zeroCopyEnabled()) {
+                std::cout << "    Zerocopy: " << conn->txTracker->zeroCopyCompleted() << " completed, "
+                          << conn->txTracker->zeroCopyCopied() << " copied by kernel, "
+                          << conn->txTracker->pinnedBuffers() << " pinned\n";
+            }
+        }
+    };
+    
+    printConnections("Server sessions", serverClients);
+    printConnections("Client connections", clientConnections);
+    
+    if (!poolMembers.empty()) {
+        std::cout << "Connection pool:\n";
+        for (const auto& member : poolMembers) {
+            std::cout << "  Member " << member->id << " -> " << member->target.name << " ("
+                      << poolMemberStateName(member->state()) << ", " << member->outstandingBytes()
+                      << " bytes outstanding, " << member->connects.load() << " connects, "
+                      << member->failures.load() << " failures)\n";
+            std::cout << "    Frames: " << member->traffic.framesOut.load() << " out, "
+                      << member->traffic.framesIn.load() << " in\n";
+            if (member->connectLatency.count() > 0) {
+                std::cout << "    Connect: " << member->connectLatency.summary() << "\n";
+            }
+            if (member->queueLatency.count() > 0) {
+                std::cout << "    Queue->socket: " << member->queueLatency.summary() << "\n";
+            }
+            const int64_t rttNs = member->tcpRttNs();
+            if (rttNs >= 0) {
+                std::cout << "    TCP RTT (kernel smoothed): " << rttNs / 1000 << "us\n";
+            }
+        }
+    }
+    
+    bool rttHeader = false;
+    for (int type = 0; type < 256; ++type) {
+        const LatencyHistogram* rtt = requestRtt.find(static_cast<uint8_t>(type));
+        if (!rtt || rtt->count() == 0) {
+            continue;
+        }
+        if (!rttHeader) {
+            std::cout << "Request round trip by type:\n";
+            rttHeader = true;
+        }
+        std::cout << "  Type " << type << ": " << rtt->summary() << "\n";
+    }
+    std::cout << "========================================\n";
+}
+
+void displayMessageHistory(const MessageHistory& history) {
+    std::cout << "\n[Action] Show (a)ll, (t)ime window in seconds, or (s)ession ID [a]: ";
+    std::string filter;
+    std::getline(std::cin, filter);
+    
+    HistoryQuery query;
+    if (!filter.empty() && (filter[0] == 't' || filter[0] == 's')) {
+        std::cout << (filter[0] == 't' ? "Seconds: " : "Session ID: ");
+        std::string valueStr;
+        std::getline(std::cin, valueStr);
+        long value = 0;
+        try {
+            value = std::stol(valueStr);
+        } catch (...) {
+            std::cout << "[Error] Invalid value.\n";
+            return;
+        }
+        if (filter[0] == 't') {
+            query.fromNs = realtimeNs() - static_cast<int64_t>(value) * 1000000000LL;
+        } else {
+            query.session = static_cast<int>(value);
+        }
+    }
+    
+    size_t matched = 0;
+    auto entries = history.query(query, &matched);
+    
+    std::cout << "\n[Received Messages]\n";
+    std::cout << "========================================\n";
+    if (entries.empty()) {
+        std::cout << "No messages received yet.\n";
+    } else {
+        for (const auto& entry : entries) {
+            const time_t seconds = static_cast<time_t>(entry.timestampNs / 1000000000LL);
+            tm local;
+            localtime_r(&seconds, &local);
+            char when[16];
+            std::strftime(when, sizeof(when), "%H:%M:%S", &local);
+            std::cout << when << " " << entry.text << (entry.truncated ? "..." : "") << "\n";
+        }
+        if (matched > entries.size()) {
+            std::cout << "(showing last " << entries.size() << " of " << matched << ")\n";
+        }
+    }
     std::cout << "========================================\n";
-    std::cout << "Enter your choice (1-7): ";
+    std::cout << history.size() << " of " << history.capacity() << " entries stored"
+              << (history.persistent() ? " (file-backed)" : "") << "\n";
 }
 
 bool hasInput() {
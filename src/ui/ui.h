@@ -7,15 +7,35 @@
 
 #include "../network/socket_utils.h"
 #include "../network/connection.h"
+#include "../client/connection_pool.h"
+#include "message_history.h"
 #include <vector>
 #include <atomic>
 
 /**
  * @brief Displays main control menu with current server/client status
  */
-void displayMenu(SocketPtr serverSocket, 
+void displayMenu(bool serverRunning, 
                  const std::vector<ClientConnectionPtr>& serverClients,
-                 const std::vector<ClientConnectionPtr>& clientConnections);
+                 const std::vector<ClientConnectionPtr>& clientConnections,
+                 const ConnectionPool& connectionPool);
+
+/**
+ * @brief Displays per-connection statistics (RX wakeup, TX send-to-wire latency, throttle counters)
+ * 
+ * Pool members show their state, outstanding bytes, connect and queueing
+ * latency, and the kernel's smoothed RTT.
+ */
+void displayConnectionStats(const std::vector<ClientConnectionPtr>& serverClients,
+                            const std::vector<ClientConnectionPtr>& clientConnections,
+                            const std::vector<PoolMemberPtr>& poolMembers);
+
+/**
+ * @brief Prompts for a history filter (all, last N seconds, or session) and prints matches
+ * 
+ * Shows at most the 1000 most recent matches.
+ */
+void displayMessageHistory(const MessageHistory& history);
 
 /**
  * @brief Non-blocking check for stdin input availability
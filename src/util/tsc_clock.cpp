@@ -0,0 +1,28 @@
+#include "tsc_clock.h"
+#include <chrono>
+#include <ctime>
+#include <thread>
+
+uint64_t steadyClockNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+int64_t realtimeNs() {
+    timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return static_cast<int64_t>(now.tv_sec) * 1000000000LL + now.tv_nsec;
+}
+
+double tscTicksPerNs() {
+    // Function-local static: calibrated once, thread-safe
+    static const double ticksPerNs = [] {
+        const uint64_t startNs = steadyClockNs();
+        const uint64_t startTicks = readTsc();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        const uint64_t elapsedNs = steadyClockNs() - startNs;
+        const uint64_t elapsedTicks = readTsc() - startTicks;
+        return elapsedNs ? static_cast<double>(elapsedTicks) / static_cast<double>(elapsedNs) : 1.0;
+    }();
+    return ticksPerNs;
+}
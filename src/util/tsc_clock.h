@@ -0,0 +1,57 @@
+#pragma once
+
+/**
+ * @file tsc_clock.h
+ * @brief Cheap cycle-counter timestamps for hot paths
+ * 
+ * readTsc() is a single rdtsc (x86) or cntvct_el0 (arm64) read, falling back
+ * to steady_clock elsewhere. Conversion to nanoseconds uses a rate calibrated
+ * once against steady_clock (~10ms on first use). Assumes an invariant TSC,
+ * which all current server CPUs provide.
+ */
+
+#include <cstdint>
+
+/**
+ * @brief Monotonic nanoseconds from steady_clock
+ */
+uint64_t steadyClockNs();
+
+/**
+ * @brief Wall-clock nanoseconds (CLOCK_REALTIME), the clock kernel packet timestamps use
+ */
+int64_t realtimeNs();
+
+/**
+ * @brief Reads the cycle counter (not serializing; ordering is not needed for timestamps)
+ */
+inline uint64_t readTsc() {
+    #if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+    #elif defined(__aarch64__)
+    uint64_t value;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(value));
+    return value;
+    #else
+    return steadyClockNs();
+    #endif
+}
+
+/**
+ * @brief Counter ticks per nanosecond (calibrated on first call)
+ */
+double tscTicksPerNs();
+
+/**
+ * @brief Converts a tick delta to nanoseconds
+ */
+inline int64_t tscToNs(int64_t ticks) {
+    return static_cast<int64_t>(static_cast<double>(ticks) / tscTicksPerNs());
+}
+
+/**
+ * @brief Converts nanoseconds to ticks
+ */
+inline uint64_t nsToTsc(uint64_t ns) {
+    return static_cast<uint64_t>(static_cast<double>(ns) * tscTicksPerNs());
+}